@@ -1,69 +1,421 @@
-#include <stdio.h>
-#include "pico/stdlib.h"
-#include "pico/binary_info.h"
-#include "ens160_i2c.h"
-
-int main()
-{
-    stdio_init_all();
-    // This example will use I2C0 on the default SDA and SCL pins (4, 5 on a Pico)
-    i2c_init(i2c_default, 400 * 1000);
-    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
-    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
-    // Make the I2C pins available to picotool
-    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
-    printf("Initialisation complete!\n");
-    ENS160 myENS(i2c_default, ENS160_ADDRESS_HIGH);
-
-    bool printedCompensation = false; 
-    int ensStatus; 
-
-    if (!myENS.init())
-    {
-        printf("Hello, ENS160! Reading raw data from registers...\n");
-        while(1);
-    }
-    if( myENS.setOperatingMode(SFE_ENS160_RESET) )
-        printf("Ready.\n");
-    sleep_ms(100);
-    myENS.setOperatingMode(SFE_ENS160_IDLE);
-    sleep_ms(500);
-    myENS.setOperatingMode(SFE_ENS160_STANDARD);
-    ensStatus = myENS.getFlags();
-    printf("Gas Sensor Status Flag: ");
-    printf("%d\n", ensStatus);
-    while (1)
-    {
-        if( myENS.checkDataStatus() )
-        {
-            if( printedCompensation == false)
-            {
-                printf("---------------------------\n");
-                printf("Compensation Temperature: ");
-                printf("%f\n", myENS.getTempCelsius());
-                printf("---------------------------");
-                printf("Compensation Relative Humidity: ");
-                printf("%f\n", myENS.getRH());
-                printf("---------------------------\n");
-                printedCompensation = true;
-                sleep_ms(500);
-            }
-
-            printf("Air Quality Index (1-5) : ");
-            printf("%d\n", myENS.getAQI());
-
-            printf("Total Volatile Organic Compounds: ");
-            printf("%d", myENS.getTVOC());
-            printf("ppb\n");
-
-            printf("CO2 concentration: ");
-            printf("%d", myENS.getECO2());
-            printf("ppm\n");
-
-        }
-        sleep_ms(100);
-    }
-    return 0;
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "ens160_i2c.h"
+#include "ens160_latency.h"
+#include "ens160_events.h"
+#include "ens160_poll.h"
+#include "ens160_command.h"
+#include "ens160_format.h"
+
+// Calibrated bus clocks are kept in the last flash sector, one per I2C block
+#define BUS_PROFILE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define BUS_PROFILE_MAGIC  0x45C5C160
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t baudrate[2];
+} bus_profile_t;
+
+#if ENS160_DUAL_CORE
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "ens160_queue.h"
+
+// Sample handed from the acquisition core to the output core
+typedef struct
+{
+    ens160_frame_t frame;
+    uint32_t timeToValid;
+    uint64_t updateUs; // estimated time the sensor produced the data
+    uint64_t readUs;   // time the read completed
+    uint8_t started;   // rules that became active on this frame
+    uint8_t ended;     // rules that ended on this frame
+} ens160_sample_t;
+
+static ENS160 *acquisitionSensor;
+static SampleQueue<ens160_sample_t, 16> samples;
+#endif
+
+static uint32_t loadBusSpeed(i2c_inst_t *bus)
+{
+    const bus_profile_t *profile = (const bus_profile_t *)(XIP_BASE + BUS_PROFILE_OFFSET);
+
+    if( profile->magic != BUS_PROFILE_MAGIC )
+        return 0;
+    return profile->baudrate[i2c_hw_index(bus)];
+}
+
+// Only called before core 1 is started, so nothing else runs from flash
+static void saveBusSpeed(i2c_inst_t *bus, uint32_t baudrate)
+{
+    const bus_profile_t *stored = (const bus_profile_t *)(XIP_BASE + BUS_PROFILE_OFFSET);
+    uint8_t page[FLASH_PAGE_SIZE];
+    bus_profile_t profile;
+    uint32_t interrupts;
+
+    if( stored->magic == BUS_PROFILE_MAGIC )
+        profile = *stored;
+    else
+        memset(&profile, 0, sizeof(profile));
+    profile.magic = BUS_PROFILE_MAGIC;
+    profile.baudrate[i2c_hw_index(bus)] = baudrate;
+
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &profile, sizeof(profile));
+
+    interrupts = save_and_disable_interrupts();
+    flash_range_erase(BUS_PROFILE_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(BUS_PROFILE_OFFSET, page, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);
+}
+
+// Per-sample output is formatted with ens160_format.h rather than printf
+static void printNumber(const char *label, uint32_t value, const char *unit)
+{
+    char number[ENS160_FORMAT_MAX];
+
+    ens160FormatUnsigned(number, value, 0);
+    fputs(label, stdout);
+    fputs(number, stdout);
+    fputs(unit, stdout);
+}
+
+static void printFrame(const ens160_frame_t *frame)
+{
+    printNumber("Air Quality Index (1-5) : ", frame->aqi, "\n");
+    printNumber("Total Volatile Organic Compounds: ", frame->tvoc, "ppb\n");
+    printNumber("CO2 concentration: ", frame->eco2, "ppm\n");
+}
+
+static void printFlag(const ens160_frame_t *frame, uint32_t timeToValid)
+{
+    printNumber("Gas Sensor Status Flag: ", frame->validity, "");
+    if( timeToValid != ENS160_TIME_UNKNOWN )
+        printNumber(", valid in about ", timeToValid / 1000, " s");
+    fputs("\n", stdout);
+}
+
+// Latency percentiles are printed after this many delivered samples
+#define LATENCY_REPORT_EVERY 60
+
+static ENS160LatencyMonitor latency;
+
+static void printLatency()
+{
+    static const char *names[ENS160_LATENCY_INTERVALS] = { "update->read", "read->output", "update->output" };
+    ens160_latency_summary_t summary;
+    uint8_t i;
+
+    for( i = 0; i < ENS160_LATENCY_INTERVALS; i++ )
+    {
+        latency.summarize(i, &summary);
+        printf("%-15s p50 %lu us, p90 %lu us, p99 %lu us, max %lu us\n", names[i], 
+            summary.p50, summary.p90, summary.p99, summary.max);
+    }
+}
+
+// Called when a valid sample reaches the output; reports every LATENCY_REPORT_EVERY samples
+static void recordLatency(uint64_t updateUs, uint64_t readUs)
+{
+    static uint32_t delivered = 0;
+
+    latency.record(updateUs, readUs, time_us_64());
+    if( ++delivered % LATENCY_REPORT_EVERY == 0 )
+        printLatency();
+}
+
+// Air quality events. The engine decides how often the sensor is polled and
+// how often frames are reported: closely while a rule is active, rarely while
+// the air is stable.
+static const char *ruleNames[] = { "eCO2 above 1000 ppm", "TVOC changing fast", "AQI 4 or worse for 5 minutes" };
+static const ens160_rule_t rules[] =
+{
+    { ENS160_RULE_ABOVE, ENS160_SIGNAL_ECO2, 1000, 100, 0 },
+    { ENS160_RULE_RATE, ENS160_SIGNAL_TVOC, 500, 200, 0 },
+    { ENS160_RULE_SUSTAINED, ENS160_SIGNAL_AQI, 4, 0, 5UL * 60UL * 1000UL },
+};
+
+static ENS160EventEngine events;
+static ENS160AdaptiveRate rate;
+
+// Without INT wired the sensor is polled, around the updates the scheduler
+// predicts rather than every 100 ms. The adaptive rate's interval is the least
+// time between samples, which at rest makes the scheduler skip updates.
+static ENS160PollScheduler scheduler;
+
+// COMMAND register operations run a step per pass of the measurement loop
+static ENS160CommandEngine *commands;
+
+static void waitForPoll(uint64_t readUs)
+{
+    uint64_t next = scheduler.getNextPoll(readUs + rate.getPollInterval() * 1000ULL);
+    uint64_t now = time_us_64();
+
+    if( commands->isBusy() && commands->getDue() * 1000ULL < next )
+        next = commands->getDue() * 1000ULL;
+
+    if( next > now )
+        sleep_us(next - now);
+}
+
+static void addRules()
+{
+    uint8_t i;
+
+    for( i = 0; i < sizeof(rules) / sizeof(rules[0]); i++ )
+        events.addRule(&rules[i]);
+}
+
+static void printEvent(uint8_t rule, bool active)
+{
+    printf("Event %s: %s\n", active ? "started" : "ended", ruleNames[rule]);
+}
+
+static void printAppVersion(const ens160_command_result_t *result, void *context)
+{
+    uint32_t version = ENS160CommandEngine::getAppVersion(result);
+
+    (void)context;
+    if( result->error != ENS160_OK )
+    {
+        printf("Firmware version not read (%ld)\n", result->error);
+        return;
+    }
+    printf("Firmware version: %lu.%lu.%lu\n", version & 0xFF, (version >> 8) & 0xFF, version >> 16);
+}
+
+// The values the sensor compensates with, read raw in one burst and printed
+// in fixed point
+static void printCompensation(ENS160 *sensor)
+{
+    ens160_fields_t fields;
+    char number[ENS160_FORMAT_MAX];
+
+    if( !sensor->readFields(ENS160_FIELD_DATA_T | ENS160_FIELD_DATA_RH, &fields) )
+        return;
+
+    fputs("---------------------------\n", stdout);
+    fputs("Compensation Temperature: ", stdout);
+    ens160FormatFixed(number, ens160CentiCelsius(fields.dataT), 2, 0);
+    puts(number);
+    fputs("---------------------------", stdout);
+    fputs("Compensation Relative Humidity: ", stdout);
+    ens160FormatFixed(number, ens160CentiPercent(fields.dataRH), 2, 0);
+    puts(number);
+    fputs("---------------------------\n", stdout);
+}
+
+#if !ENS160_DUAL_CORE
+static void reportEvent(const ens160_event_t *event, void *context)
+{
+    (void)context;
+    printEvent(event->rule, event->active);
+}
+#endif
+
+#if ENS160_DUAL_CORE
+// Event changes travel to core 0 with the sample they happened on
+static void noteEvent(const ens160_event_t *event, void *context)
+{
+    ens160_sample_t *sample = (ens160_sample_t *)context;
+
+    if( event->active )
+        sample->started |= (uint8_t)(1 << event->rule);
+    else
+        sample->ended |= (uint8_t)(1 << event->rule);
+}
+
+// Core 1 owns the sensor and the I2C bus, so sampling is not held up by
+// USB stdio on core 0. Validity changes are queued, and of the valid frames
+// those that start or end an event or that the adaptive rate wants reported.
+// The update time is the scheduler's estimate.
+static void acquisitionLoop()
+{
+    ens160_sample_t sample;
+    int ensStatus = -1;
+    uint8_t changed;
+
+    events.setCallback(noteEvent, &sample);
+
+    while (1)
+    {
+        sample.started = 0;
+        sample.ended = 0;
+        bool delivered = acquisitionSensor->readFrame(&sample.frame);
+        sample.readUs = time_us_64();
+        commands->service((uint32_t)(sample.readUs / 1000));
+        scheduler.observe(sample.frame.newData, sample.readUs);
+        sample.updateUs = scheduler.getUpdateTime();
+        changed = events.update(&sample.frame);
+        if( sample.frame.newData )
+            rate.update(changed || events.isActive(), sample.frame.timestamp);
+
+        if( delivered )
+        {
+            if( sample.frame.newData && (changed || rate.reportDue(sample.frame.timestamp)) )
+            {
+                sample.timeToValid = 0;
+                samples.push(sample);
+                __sev();
+            }
+        }
+        else if( sample.frame.newData && sample.frame.validity != ensStatus )
+        {
+            ensStatus = sample.frame.validity;
+            sample.timeToValid = acquisitionSensor->getTimeToValid();
+            samples.push(sample);
+            __sev();
+        }
+        waitForPoll(sample.readUs);
+    }
+}
+
+// Core 0 only formats and prints what core 1 has queued
+static void outputLoop()
+{
+    ens160_sample_t sample;
+    uint32_t dropped = 0;
+    uint8_t i;
+
+    while (1)
+    {
+        while( samples.pop(&sample) )
+        {
+            for( i = 0; i < sizeof(rules) / sizeof(rules[0]); i++ )
+            {
+                if( sample.started & (1 << i) )
+                    printEvent(i, true);
+                if( sample.ended & (1 << i) )
+                    printEvent(i, false);
+            }
+            if( sample.frame.valid )
+            {
+                recordLatency(sample.updateUs, sample.readUs);
+                printFrame(&sample.frame);
+            }
+            else
+                printFlag(&sample.frame, sample.timeToValid);
+        }
+        if( samples.getDropped() != dropped )
+        {
+            dropped = samples.getDropped();
+            printf("Output too slow, %lu samples dropped\n", dropped);
+        }
+        __wfe();
+    }
+}
+#endif
+
+int main()
+{
+    stdio_init_all();
+    // This example will use I2C0 on the default SDA and SCL pins (4, 5 on a Pico)
+    i2c_init(i2c_default, 400 * 1000);
+    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
+    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+    // Make the I2C pins available to picotool
+    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
+    printf("Initialisation complete!\n");
+    ENS160 myENS(i2c_default, ENS160_ADDRESS_HIGH);
+    // Lets the driver clock a stuck bus free and re-initialise the controller
+    myENS.setBusPins(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, 400 * 1000);
+
+    ENS160CommandEngine commandEngine(&myENS);
+    int ensStatus; 
+    uint32_t busSpeed;
+    uint32_t settled;
+
+    if (!myENS.init())
+    {
+        printf("Hello, ENS160! Reading raw data from registers...\n");
+        while(1);
+    }
+    // Reuse the stored bus clock while it still checks out, otherwise find the fastest reliable one
+    busSpeed = loadBusSpeed(i2c_default);
+    if( busSpeed == 0 || myENS.setBusSpeed(busSpeed) == 0 || !myENS.verifyBus(ENS160_CALIBRATION_READS) )
+    {
+        busSpeed = myENS.calibrateBusSpeed();
+        if( busSpeed != 0 )
+            saveBusSpeed(i2c_default, busSpeed);
+    }
+    printf("I2C clock: ");
+    printf("%lu Hz\n", myENS.getBusSpeed());
+    if( myENS.setOperatingMode(SFE_ENS160_RESET) )
+        printf("Ready.\n");
+    sleep_ms(100);
+    myENS.setOperatingMode(SFE_ENS160_IDLE);
+    // The firmware version is fetched while the sensor settles in IDLE, so
+    // the engine has no mode to restore and the warm-up is not restarted
+    commands = &commandEngine;
+    commands->submit(SFE_ENS160_COMMAND_GET_APPVER, printAppVersion, 0);
+    settled = to_ms_since_boot(get_absolute_time()) + 500;
+    while( (int32_t)(to_ms_since_boot(get_absolute_time()) - settled) < 0 )
+    {
+        commands->service(to_ms_since_boot(get_absolute_time()));
+        sleep_ms(1);
+    }
+    myENS.setOperatingMode(SFE_ENS160_STANDARD);
+    ensStatus = myENS.getFlags();
+    printf("Gas Sensor Status Flag: ");
+    printf("%d\n", ensStatus);
+    myENS.setValidOnly();
+    myENS.setAutoRestore(); // put the configuration back if the sensor resets
+    addRules();
+#if ENS160_DUAL_CORE
+    // Compensation is read before core 1 takes over the bus
+    printCompensation(&myENS);
+    acquisitionSensor = &myENS;
+    multicore_launch_core1(acquisitionLoop);
+    outputLoop();
+#else
+    bool printedCompensation = false; 
+    ens160_frame_t frame;
+    uint64_t readUs;
+    uint8_t changed;
+
+    events.setCallback(reportEvent, 0);
+
+    while (1)
+    {
+        bool delivered = myENS.readFrame(&frame);
+        readUs = time_us_64();
+        commands->service((uint32_t)(readUs / 1000));
+        scheduler.observe(frame.newData, readUs);
+        changed = events.update(&frame);
+        if( frame.newData )
+            rate.update(changed || events.isActive(), frame.timestamp);
+
+        if( !delivered )
+        {
+            // Gated frames leave NEWDAT set, so only report changes of the flag
+            if( frame.newData && frame.validity != ensStatus )
+            {
+                ensStatus = frame.validity;
+                printFlag(&frame, myENS.getTimeToValid());
+            }
+        }
+        else if( frame.newData && (changed || rate.reportDue(frame.timestamp)) )
+        {
+            if( printedCompensation == false)
+            {
+                printCompensation(&myENS);
+                printedCompensation = true;
+                sleep_ms(500);
+            }
+
+            recordLatency(scheduler.getUpdateTime(), readUs);
+            printFrame(&frame);
+
+        }
+        waitForPoll(readUs);
+    }
+#endif
+    return 0;
 }
\ No newline at end of file
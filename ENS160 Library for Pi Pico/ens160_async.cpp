@@ -0,0 +1,256 @@
+#include "ens160_async.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+ENS160AsyncOp::ENS160AsyncOp(ENS160Executor *executor)
+{
+	this->executor = executor;
+	this->due = 0;
+	this->next = 0;
+}
+
+void ENS160AsyncOp::await_suspend(std::coroutine_handle<> handle)
+{
+	this->handle = handle;
+	this->executor->schedule(this);
+}
+
+ENS160SleepOp::ENS160SleepOp(ENS160Executor *executor, uint64_t due) : ENS160AsyncOp(executor)
+{
+	this->due = due;
+}
+
+ENS160Executor::ENS160Executor()
+{
+	this->queue = 0;
+	this->pending = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// schedule()
+//
+// Inserts the operation by due time, after any that are due at the same time,
+// so bus operations queued together run in the order they were awaited.
+
+void ENS160Executor::schedule(ENS160AsyncOp *op)
+{
+	ENS160AsyncOp **link = &this->queue;
+
+	while( *link != 0 && (*link)->due <= op->due )
+		link = &(*link)->next;
+
+	op->next = *link;
+	*link = op;
+	this->pending++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// poll()
+//
+// Runs every operation that is due or ready. Each one is unlinked before its
+// step() so that the task it resumes is free to await again straight away.
+//
+//  retval       true while operations remain queued
+
+bool ENS160Executor::poll()
+{
+	ENS160AsyncOp **link;
+	ENS160AsyncOp *op;
+	uint64_t now = time_us_64();
+
+	for( ;; )
+	{
+		link = &this->queue;
+		while( *link != 0 && (*link)->due > now && !(*link)->ready() )
+			link = &(*link)->next;
+
+		if( *link == 0 )
+			break;
+
+		op = *link;
+		*link = op->next;
+		this->pending--;
+
+		if( op->step() )
+			op->handle.resume();
+		else
+			schedule(op);
+
+		now = time_us_64();
+	}
+
+	return this->queue != 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// run()
+//
+// Between operations the core waits for an event or the next due time; an
+// interrupt wakes it early so ready() operations are picked up at once.
+
+void ENS160Executor::run()
+{
+	while( poll() )
+		best_effort_wfe_or_timeout(this->queue->due);
+}
+
+uint64_t ENS160Executor::getNextDue()
+{
+	if( this->queue == 0 )
+		return 0;
+
+	return this->queue->due;
+}
+
+ENS160SleepOp ENS160Executor::sleep(uint32_t ms)
+{
+	return ENS160SleepOp(this, time_us_64() + (uint64_t)ms * 1000);
+}
+
+ENS160SleepOp ENS160Executor::sleepUntil(uint64_t timeUs)
+{
+	return ENS160SleepOp(this, timeUs);
+}
+
+uint32_t ENS160Executor::getPendingCount()
+{
+	return this->pending;
+}
+
+ENS160FrameOp::ENS160FrameOp(ENS160AsyncSensor *sensor, ens160_frame_t *frame) : ENS160AsyncOp(sensor->executor)
+{
+	this->sensor = sensor;
+	this->frame = frame;
+	this->delivered = false;
+	this->due = time_us_64();
+}
+
+bool ENS160FrameOp::step()
+{
+	this->delivered = this->sensor->sensor->readFrame(this->frame);
+
+	return true;
+}
+
+#if ENS160_FEATURE_FIELDS
+ENS160FieldsOp::ENS160FieldsOp(ENS160AsyncSensor *sensor, uint16_t fields, ens160_fields_t *result) : ENS160AsyncOp(sensor->executor)
+{
+	this->sensor = sensor;
+	this->fields = fields;
+	this->result = result;
+	this->complete = false;
+	this->due = time_us_64();
+}
+
+bool ENS160FieldsOp::step()
+{
+	this->complete = this->sensor->sensor->readFields(this->fields, this->result);
+
+	return true;
+}
+#endif
+
+ENS160DataReadyOp::ENS160DataReadyOp(ENS160AsyncSensor *sensor, uint32_t timeoutMs) : ENS160AsyncOp(sensor->executor)
+{
+	uint64_t now = time_us_64();
+
+	this->sensor = sensor;
+	this->deadline = now + (uint64_t)timeoutMs * 1000;
+	this->dataReady = false;
+	this->due = sensor->interrupt ? this->deadline : now;
+}
+
+bool ENS160DataReadyOp::ready()
+{
+	return this->sensor->interrupt && this->sensor->interruptPending;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// step()
+//
+// With an interrupt this only runs once the line has fired or the deadline
+// has passed. The flag is taken and cleared with interrupts masked, so an
+// edge landing between the two is kept for the next wait rather than lost.
+// Otherwise it reads DEVICE_STATUS and comes back one poll interval later,
+// never past the deadline.
+
+bool ENS160DataReadyOp::step()
+{
+	uint64_t now;
+	uint32_t interrupts;
+
+	if( this->sensor->interrupt )
+	{
+		interrupts = save_and_disable_interrupts();
+		this->dataReady = this->sensor->interruptPending;
+		this->sensor->interruptPending = false;
+		restore_interrupts(interrupts);
+		return true;
+	}
+
+	this->dataReady = this->sensor->sensor->checkDataStatus();
+	now = time_us_64();
+
+	if( this->dataReady || now >= this->deadline )
+		return true;
+
+	this->due = now + this->sensor->pollUs;
+	if( this->due > this->deadline )
+		this->due = this->deadline;
+
+	return false;
+}
+
+ENS160AsyncSensor::ENS160AsyncSensor(ENS160Executor *executor, ENS160 *sensor)
+{
+	this->executor = executor;
+	this->sensor = sensor;
+	this->pollUs = ENS160_ASYNC_POLL_MS * 1000;
+	this->interrupt = false;
+	this->interruptPending = false;
+}
+
+void ENS160AsyncSensor::setPollInterval(uint32_t ms)
+{
+	this->pollUs = ms * 1000;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// useInterrupt()
+//
+// The sensor must also be configured to drive INTn on new data, see 
+// ENS160::setDataInterrupt() and ENS160::enableInterrupt().
+
+void ENS160AsyncSensor::useInterrupt(bool enable)
+{
+	this->interrupt = enable;
+	this->interruptPending = false;
+}
+
+// Safe to call from the INTn GPIO interrupt handler
+void ENS160AsyncSensor::notifyDataReady()
+{
+	this->interruptPending = true;
+}
+
+ENS160FrameOp ENS160AsyncSensor::readFrame(ens160_frame_t *frame)
+{
+	return ENS160FrameOp(this, frame);
+}
+
+#if ENS160_FEATURE_FIELDS
+ENS160FieldsOp ENS160AsyncSensor::readFields(uint16_t fields, ens160_fields_t *result)
+{
+	return ENS160FieldsOp(this, fields, result);
+}
+#endif
+
+ENS160DataReadyOp ENS160AsyncSensor::waitDataReady(uint32_t timeoutMs)
+{
+	return ENS160DataReadyOp(this, timeoutMs);
+}
+
+ENS160 *ENS160AsyncSensor::getSensor()
+{
+	return this->sensor;
+}
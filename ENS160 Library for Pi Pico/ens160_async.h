@@ -0,0 +1,194 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include "ens160_i2c.h"
+
+// Spacing of DEVICE_STATUS polls while waiting for data without an interrupt
+#define ENS160_ASYNC_POLL_MS         50
+#define ENS160_ASYNC_DATA_TIMEOUT_MS 2000
+
+//////////////////////////////////////////////////////////////////////////////////
+// Cooperative driver API
+//
+// Lets firmware run many sensor tasks on one core without threads or busy
+// waiting. Tasks are C++20 coroutines that co_await sleeps, data-ready and
+// register reads; a single-threaded executor keeps every suspended operation
+// in one list ordered by due time, runs them in that order and sleeps the core
+// until the next one is due. Bus operations run to completion inside the
+// executor one at a time, so tasks sharing a bus never interleave mid-transfer.
+//
+//  ENS160Task poll(ENS160Executor *executor, ENS160AsyncSensor *sensor)
+//  {
+//      ens160_frame_t frame;
+//      for( ;; )
+//      {
+//          if( co_await sensor->waitDataReady() && co_await sensor->readFrame(&frame) )
+//              ...
+//      }
+//  }
+
+class ENS160Executor;
+
+// Return type of task coroutines. A task starts running when it is called and
+// frees itself when it returns; the executor only sees the operations it awaits.
+struct ENS160Task
+{
+	struct promise_type
+	{
+		ENS160Task get_return_object() { return ENS160Task(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160AsyncOp
+//
+// A suspended operation. It lives in the awaiting coroutine's frame, so the
+// executor needs no storage of its own for it.
+
+class ENS160AsyncOp {
+    public:
+        ENS160AsyncOp(ENS160Executor *executor);
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // step()
+        //  Called when the operation is due.
+        //  retval       true to resume the task, false to stay queued until 'due'
+
+        virtual bool step() = 0;
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // ready()
+        //  Checked on every executor wake-up, true to run step() before 'due'.
+
+        virtual bool ready() { return false; }
+
+        uint64_t due;
+
+    protected:
+        ENS160Executor *executor;
+
+    private:
+        friend class ENS160Executor;
+        std::coroutine_handle<> handle;
+        ENS160AsyncOp *next;
+};
+
+class ENS160SleepOp : public ENS160AsyncOp {
+    public:
+        ENS160SleepOp(ENS160Executor *executor, uint64_t due);
+        bool step() override { return true; }
+        void await_resume() {}
+};
+
+class ENS160Executor {
+    public:
+        ENS160Executor();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // run()
+        //  Runs operations until none are left, sleeping between them.
+
+        void run();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // poll()
+        //  Runs every operation that is due or ready, then returns, for firmware
+        //  that has its own main loop.
+        //  retval       true while operations remain queued
+
+        bool poll();
+
+        void schedule(ENS160AsyncOp *op);
+        ENS160SleepOp sleep(uint32_t ms);
+        ENS160SleepOp sleepUntil(uint64_t timeUs);
+        uint64_t getNextDue();
+        uint32_t getPendingCount();
+
+    private:
+        ENS160AsyncOp *queue;
+        uint32_t pending;
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160AsyncSensor
+//
+// Awaitable wrappers around one ENS160. Without an interrupt, waitDataReady()
+// polls DEVICE_STATUS every poll interval; with one, the INTn handler calls
+// notifyDataReady() and the wait completes on the next executor wake-up
+// without touching the bus.
+
+class ENS160AsyncSensor;
+
+class ENS160FrameOp : public ENS160AsyncOp {
+    public:
+        ENS160FrameOp(ENS160AsyncSensor *sensor, ens160_frame_t *frame);
+        bool step() override;
+        bool await_resume() { return this->delivered; }
+
+    private:
+        ENS160AsyncSensor *sensor;
+        ens160_frame_t *frame;
+        bool delivered;
+};
+
+#if ENS160_FEATURE_FIELDS
+class ENS160FieldsOp : public ENS160AsyncOp {
+    public:
+        ENS160FieldsOp(ENS160AsyncSensor *sensor, uint16_t fields, ens160_fields_t *result);
+        bool step() override;
+        bool await_resume() { return this->complete; }
+
+    private:
+        ENS160AsyncSensor *sensor;
+        uint16_t fields;
+        ens160_fields_t *result;
+        bool complete;
+};
+#endif
+
+class ENS160DataReadyOp : public ENS160AsyncOp {
+    public:
+        ENS160DataReadyOp(ENS160AsyncSensor *sensor, uint32_t timeoutMs);
+        bool step() override;
+        bool ready() override;
+        bool await_resume() { return this->dataReady; }
+
+    private:
+        ENS160AsyncSensor *sensor;
+        uint64_t deadline;
+        bool dataReady;
+};
+
+class ENS160AsyncSensor {
+    public:
+        ENS160AsyncSensor(ENS160Executor *executor, ENS160 *sensor);
+        void setPollInterval(uint32_t ms);
+        void useInterrupt(bool enable = true);
+        void notifyDataReady();
+
+        ENS160FrameOp readFrame(ens160_frame_t *frame);
+#if ENS160_FEATURE_FIELDS
+        ENS160FieldsOp readFields(uint16_t fields, ens160_fields_t *result);
+#endif
+        ENS160DataReadyOp waitDataReady(uint32_t timeoutMs = ENS160_ASYNC_DATA_TIMEOUT_MS);
+
+        ENS160 *getSensor();
+
+    private:
+        friend class ENS160FrameOp;
+#if ENS160_FEATURE_FIELDS
+        friend class ENS160FieldsOp;
+#endif
+        friend class ENS160DataReadyOp;
+        ENS160Executor *executor;
+        ENS160 *sensor;
+        uint32_t pollUs;
+        bool interrupt;
+        volatile bool interruptPending;
+};
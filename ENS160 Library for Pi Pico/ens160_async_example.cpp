@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "hardware/i2c.h"
+#include "hardware/gpio.h"
+#include "ens160_i2c.h"
+#include "ens160_async.h"
+
+// Reads the sensor whenever it has a result while blinking the LED, both as
+// coroutines on one core. Nothing blocks: between operations the core sleeps.
+
+static ENS160Task sensorTask(ENS160Executor *executor, ENS160AsyncSensor *sensor)
+{
+    ens160_frame_t frame;
+
+    sensor->getSensor()->setOperatingMode(SFE_ENS160_RESET);
+    co_await executor->sleep(100);
+    sensor->getSensor()->setOperatingMode(SFE_ENS160_IDLE);
+    co_await executor->sleep(500);
+    sensor->getSensor()->setOperatingMode(SFE_ENS160_STANDARD);
+    sensor->getSensor()->setValidOnly();
+
+    while (1)
+    {
+        if( !co_await sensor->waitDataReady() )
+            continue;
+
+        if( !co_await sensor->readFrame(&frame) )
+            continue;
+
+        if( frame.valid )
+            printf("AQI %u, TVOC %u ppb, eCO2 %u ppm\n", frame.aqi, frame.tvoc, frame.eco2);
+        else
+            printf("Warming up, valid in %lu s\n", sensor->getSensor()->getTimeToValid() / 1000);
+    }
+}
+
+static ENS160Task heartbeatTask(ENS160Executor *executor)
+{
+    bool on = false;
+
+    gpio_init(PICO_DEFAULT_LED_PIN);
+    gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
+
+    while (1)
+    {
+        on = !on;
+        gpio_put(PICO_DEFAULT_LED_PIN, on);
+        co_await executor->sleep(500);
+    }
+}
+
+int main()
+{
+    stdio_init_all();
+    // This example will use I2C0 on the default SDA and SCL pins (4, 5 on a Pico)
+    i2c_init(i2c_default, 400 * 1000);
+    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
+    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+    // Make the I2C pins available to picotool
+    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
+
+    ENS160 myENS(i2c_default, ENS160_ADDRESS_HIGH);
+    myENS.setBusPins(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, 400 * 1000);
+
+    if (!myENS.init())
+    {
+        printf("ENS160 not found\n");
+        while(1);
+    }
+
+    ENS160Executor executor;
+    ENS160AsyncSensor sensor(&executor, &myENS);
+
+    sensorTask(&executor, &sensor);
+    heartbeatTask(&executor);
+    executor.run();
+
+    return 0;
+}
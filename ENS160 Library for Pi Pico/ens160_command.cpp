@@ -0,0 +1,188 @@
+#include <string.h>
+#include "ens160_command.h"
+
+// Engine states, see service()
+#define ENS160_COMMAND_READY   0
+#define ENS160_COMMAND_ISSUE   1
+#define ENS160_COMMAND_WAIT    2
+#define ENS160_COMMAND_RESTORE 3
+
+ENS160CommandEngine::ENS160CommandEngine(ENS160 *sensor)
+{
+	this->sensor = sensor;
+	this->head = 0;
+	this->count = 0;
+	this->state = ENS160_COMMAND_READY;
+	this->savedMode = SFE_ENS160_IDLE;
+	this->issuedAt = 0;
+	this->due = 0;
+	this->interrupt = false;
+	this->gprPending = false;
+}
+
+bool ENS160CommandEngine::submit(uint8_t command, ens160_command_callback_t callback, void *context)
+{
+	Entry *entry;
+
+	if( this->count >= ENS160_COMMAND_QUEUE )
+		return false;
+
+	entry = &this->queue[(this->head + this->count) % ENS160_COMMAND_QUEUE];
+	entry->command = command;
+	entry->callback = callback;
+	entry->context = context;
+	this->count++;
+
+	return true;
+}
+
+void ENS160CommandEngine::useInterrupt(bool enable)
+{
+	this->interrupt = enable;
+}
+
+// Safe to call from the INTn handler
+void ENS160CommandEngine::notifyGPR()
+{
+	this->gprPending = true;
+}
+
+bool ENS160CommandEngine::isBusy()
+{
+	return this->count > 0 || this->state != ENS160_COMMAND_READY;
+}
+
+uint32_t ENS160CommandEngine::getDue()
+{
+	return this->due;
+}
+
+uint32_t ENS160CommandEngine::getAppVersion(const ens160_command_result_t *result)
+{
+	return result->gpr[4] | (result->gpr[5] << 8) | ((uint32_t)result->gpr[6] << 16);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// complete()
+//
+// Hands the result of the command at the head of the queue to its callback
+// and moves on to the next command, or to restoring the operating mode.
+
+void ENS160CommandEngine::complete(int32_t error, const uint8_t *gpr)
+{
+	Entry *entry = &this->queue[this->head];
+	ens160_command_result_t result;
+
+	result.command = entry->command;
+	result.error = error;
+	if( gpr )
+		memcpy(result.gpr, gpr, sizeof(result.gpr));
+	else
+		memset(result.gpr, 0, sizeof(result.gpr));
+
+	this->head = (this->head + 1) % ENS160_COMMAND_QUEUE;
+	this->count--;
+	this->state = this->count ? ENS160_COMMAND_ISSUE : ENS160_COMMAND_RESTORE;
+
+	if( entry->callback )
+		entry->callback(&result, entry->context);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// service()
+//
+// Takes one step. Only GET_APPVER produces a result; other commands complete
+// once written. Reading GPR_READ before a command clears any NEWGPR left from
+// an earlier one. A failed switch back to the saved mode is tried again every
+// poll interval, since a sensor left in IDLE stops measuring.
+
+bool ENS160CommandEngine::service(uint32_t now)
+{
+	ens160_result<uint8_t> mode;
+	ens160_result<uint8_t> status;
+	uint8_t gpr[8];
+	int32_t error;
+
+	if( !isBusy() || (int32_t)(now - this->due) < 0 )
+		return isBusy();
+
+	this->due = now;
+
+	switch( this->state )
+	{
+		case ENS160_COMMAND_READY:
+			mode = this->sensor->readOperatingMode();
+			if( !mode.ok() )
+			{
+				complete(mode.error, 0);
+				this->state = ENS160_COMMAND_READY;
+				break;
+			}
+			this->savedMode = mode.value;
+			if( mode.value != SFE_ENS160_IDLE && !this->sensor->setOperatingMode(SFE_ENS160_IDLE) )
+			{
+				// The mode never changed: the next command starts over from here
+				complete(ENS160_ERR_NACK, 0);
+				this->state = ENS160_COMMAND_READY;
+				break;
+			}
+			this->state = ENS160_COMMAND_ISSUE;
+			break;
+
+		case ENS160_COMMAND_ISSUE:
+			error = this->sensor->readGPR(gpr);
+			if( error == ENS160_OK )
+				error = this->sensor->writeCommand(this->queue[this->head].command);
+			if( error != ENS160_OK )
+			{
+				complete(error, 0);
+				break;
+			}
+			if( this->queue[this->head].command != SFE_ENS160_COMMAND_GET_APPVER )
+			{
+				complete(ENS160_OK, 0);
+				break;
+			}
+			this->gprPending = false;
+			this->issuedAt = now;
+			this->due = now + (this->interrupt ? ENS160_COMMAND_TIMEOUT_MS : ENS160_COMMAND_POLL_MS);
+			this->state = ENS160_COMMAND_WAIT;
+			break;
+
+		case ENS160_COMMAND_WAIT:
+			// With the interrupt, the bus is only touched once it has fired
+			if( this->interrupt && !this->gprPending && now - this->issuedAt < ENS160_COMMAND_TIMEOUT_MS )
+			{
+				this->due = this->issuedAt + ENS160_COMMAND_TIMEOUT_MS;
+				break;
+			}
+			this->gprPending = false;
+			status = this->sensor->readStatus();
+			if( status.ok() && (status.value & SFE_ENS160_STATUS_NEWGPR) )
+			{
+				error = this->sensor->readGPR(gpr);
+				complete(error, error == ENS160_OK ? gpr : 0);
+			}
+			else if( now - this->issuedAt >= ENS160_COMMAND_TIMEOUT_MS )
+				complete(status.ok() ? ENS160_ERR_NO_RESULT : status.error, 0);
+			else
+				this->due = this->interrupt ? this->issuedAt + ENS160_COMMAND_TIMEOUT_MS : now + ENS160_COMMAND_POLL_MS;
+			break;
+
+		case ENS160_COMMAND_RESTORE:
+			if( this->count )
+			{
+				this->state = ENS160_COMMAND_ISSUE;
+				break;
+			}
+			if( this->savedMode != SFE_ENS160_IDLE && !this->sensor->setOperatingMode(this->savedMode) )
+			{
+				this->due = now + ENS160_COMMAND_POLL_MS;
+				break;
+			}
+			this->state = ENS160_COMMAND_READY;
+			break;
+	}
+
+	return isBusy();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "ens160_i2c.h"
+
+#if !ENS160_FEATURE_GPR
+#error "ENS160CommandEngine needs ENS160_FEATURE_GPR"
+#endif
+
+// Commands that can wait in the engine's queue
+#define ENS160_COMMAND_QUEUE 4
+
+// Outcome of one command, passed to its callback
+typedef struct
+{
+	uint8_t command;  // SFE_ENS160_COMMAND_*
+	int32_t error;    // ENS160_OK or ENS160_ERR_*
+	uint8_t gpr[8];   // GPR_READ0..7 for commands with a result, GET_APPVER fills 4..6
+}	ens160_command_result_t;
+
+typedef void (*ens160_command_callback_t)(const ens160_command_result_t *result, void *context);
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160CommandEngine
+//
+// Runs COMMAND register operations without holding up the measurement loop.
+// Commands are queued and carried out by service(), which the loop calls on
+// every pass and which does at most a couple of short transfers each time:
+// switch the sensor to IDLE, issue the command, look for NEWGPR, read the
+// result, and once the queue is empty put the sensor back in the mode it was
+// in. Commands queued together share one visit to IDLE. Completion is seen by
+// polling DEVICE_STATUS every ENS160_COMMAND_POLL_MS, or, with the GPR
+// interrupt routed to INTn, when the handler calls notifyGPR().
+//
+// Frames read while a command runs carry no new data, and leaving STANDARD
+// restarts the sensor's warm-up, so commands are best queued at start-up.
+
+class ENS160CommandEngine {
+    public:
+        ENS160CommandEngine(ENS160 *sensor);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // submit()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  command      SFE_ENS160_COMMAND_NOP, _GET_APPVER or _CLRGPR
+        //  callback     called from service() when the command has completed or failed
+        //  context      passed to callback
+        //  retval       false if ENS160_COMMAND_QUEUE commands are already waiting
+
+        bool submit(uint8_t command, ens160_command_callback_t callback, void *context);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // service()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  now          current time in ms
+        //  retval       true while commands are waiting or running
+
+        bool service(uint32_t now);
+
+        void useInterrupt(bool enable = true);
+        void notifyGPR();
+        bool isBusy();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // getDue()
+        //  Time in ms at which service() next has something to do, while busy.
+
+        uint32_t getDue();
+
+        static uint32_t getAppVersion(const ens160_command_result_t *result);
+
+    private:
+        typedef struct
+        {
+            uint8_t command;
+            ens160_command_callback_t callback;
+            void *context;
+        }   Entry;
+
+        ENS160 *sensor;
+        Entry queue[ENS160_COMMAND_QUEUE];
+        uint8_t head;
+        uint8_t count;
+        uint8_t state;
+        uint8_t savedMode;
+        uint32_t issuedAt;
+        uint32_t due;
+        bool interrupt;
+        volatile bool gprPending;
+        void complete(int32_t error, const uint8_t *gpr);
+};
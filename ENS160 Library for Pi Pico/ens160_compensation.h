@@ -0,0 +1,84 @@
+#pragma once
+#include "ens160_i2c.h"
+
+#if !ENS160_FEATURE_FLOAT || !ENS160_FEATURE_FIELDS
+#error "ENS160CompensationFeeder needs ENS160_FEATURE_FLOAT and ENS160_FEATURE_FIELDS"
+#endif
+
+// Defaults: rewrite TEMP_IN/RH_IN after a 0.5 C or 2 %rH change, or every 15 minutes
+#define ENS160_COMP_TEMP_THRESHOLD 0.5f
+#define ENS160_COMP_RH_THRESHOLD   2.0f
+#define ENS160_COMP_MAX_AGE_MS     (15UL * 60UL * 1000UL)
+#define ENS160_COMP_FILTER_ALPHA   0.2f
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160CompensationFeeder
+//
+// Feeds temperature and humidity from a companion sensor into the ENS160's
+// compensation registers. Samples are smoothed with an exponential filter and
+// only written when the filtered value has moved past a threshold since the
+// last write, or when the last write is older than the maximum age (which also
+// restores compensation after a sensor reset). Both values go out in one burst.
+
+class ENS160CompensationFeeder {
+    public:
+        ENS160CompensationFeeder(ENS160 *sensor);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // setThresholds()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  tempDelta    change in Celsius that triggers a write
+        //  rhDelta      change in %rH that triggers a write
+        //  maxAgeMs     longest time between writes
+
+        void setThresholds(float tempDelta, float rhDelta, uint32_t maxAgeMs);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // setFilter()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  alpha        weight of a new sample, 0 < alpha <= 1 (1 disables filtering)
+
+        void setFilter(float alpha);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // update()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  tempCelsius  temperature from the companion sensor
+        //  humidity     relative humidity from the companion sensor
+        //  now          current time in ms
+        //  retval       true if the sample caused a write to the ENS160
+
+        bool update(float tempCelsius, float humidity, uint32_t now);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // readBack()
+        //  Reads DATA_T and DATA_RH in one burst to check what the sensor is using.
+
+        bool readBack(float *tempCelsius, float *humidity);
+
+        float getFilteredTemp();
+        float getFilteredRH();
+        uint32_t getSampleCount();
+        uint32_t getWriteCount();
+        uint32_t getWriteErrorCount();
+
+    private:
+        ENS160 *sensor;
+        float tempThreshold;
+        float rhThreshold;
+        uint32_t maxAge;
+        float alpha;
+        bool primed;
+        bool written;
+        float tempFiltered;
+        float rhFiltered;
+        float tempWritten;
+        float rhWritten;
+        uint32_t writtenAt;
+        uint32_t samples;
+        uint32_t writes;
+        uint32_t writeErrors;
+};
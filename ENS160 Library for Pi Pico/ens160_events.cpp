@@ -0,0 +1,220 @@
+#include <string.h>
+#include "ens160_events.h"
+
+static uint16_t signalValue(const ens160_frame_t *frame, uint8_t signal)
+{
+	switch( signal )
+	{
+		case ENS160_SIGNAL_AQI: return frame->aqi;
+		case ENS160_SIGNAL_TVOC: return frame->tvoc;
+		default: return frame->eco2;
+	}
+}
+
+ENS160EventEngine::ENS160EventEngine()
+{
+	this->callback = 0;
+	this->context = 0;
+	clearRules();
+}
+
+int8_t ENS160EventEngine::addRule(const ens160_rule_t *rule)
+{
+	ens160_rule_state_t *state;
+
+	if( this->ruleCount >= ENS160_EVENT_MAX_RULES )
+		return -1;
+
+	state = &this->rules[this->ruleCount];
+	memset(state, 0, sizeof(*state));
+	state->rule = *rule;
+
+	return (int8_t)this->ruleCount++;
+}
+
+void ENS160EventEngine::clearRules()
+{
+	this->ruleCount = 0;
+	this->activeMask = 0;
+	this->events = 0;
+}
+
+void ENS160EventEngine::setCallback(ens160_event_callback_t callback, void *context)
+{
+	this->callback = callback;
+	this->context = context;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// evaluate()
+//
+// Advances one rule by one sample and returns whether it should be active.
+// The rate is the change since the previous sample scaled to a minute, put
+// through an exponential filter so that a single noisy step does not fire a
+// rate rule; two samples with the same timestamp leave it as it was.
+
+bool ENS160EventEngine::evaluate(ens160_rule_state_t *state, uint16_t value, uint32_t now)
+{
+	const ens160_rule_t *rule = &state->rule;
+	uint32_t elapsed;
+	int32_t step;
+	int32_t magnitude;
+	uint16_t release;
+
+	if( state->primed )
+	{
+		elapsed = now - state->lastTime;
+		if( elapsed > 0 )
+		{
+			step = (int32_t)(((int64_t)value - state->last) * 60000 / (int64_t)elapsed);
+			state->rate += (step - state->rate) >> ENS160_EVENT_RATE_SHIFT;
+		}
+	}
+	state->primed = true;
+	state->last = value;
+	state->lastTime = now;
+
+	release = rule->threshold > rule->hysteresis ? rule->threshold - rule->hysteresis : 0;
+
+	if( rule->type == ENS160_RULE_RATE )
+	{
+		magnitude = state->rate < 0 ? -state->rate : state->rate;
+		return state->active ? magnitude >= release : magnitude >= rule->threshold;
+	}
+
+	if( rule->type == ENS160_RULE_ABOVE )
+		return state->active ? value >= release : value >= rule->threshold;
+
+	// Sustained: the clock starts at the first sample over the threshold and
+	// stops once the value drops below the release level
+	if( value >= rule->threshold && !state->exceeding )
+	{
+		state->exceeding = true;
+		state->since = now;
+	}
+	else if( value < release )
+		state->exceeding = false;
+
+	return state->exceeding && (uint32_t)(now - state->since) >= rule->durationMs;
+}
+
+uint8_t ENS160EventEngine::update(const ens160_frame_t *frame)
+{
+	ens160_rule_state_t *state;
+	ens160_event_t event;
+	uint8_t changed = 0;
+	uint8_t i;
+	bool active;
+
+	if( !frame->valid || !frame->newData )
+		return 0;
+
+	for( i = 0; i < this->ruleCount; i++ )
+	{
+		state = &this->rules[i];
+		event.value = signalValue(frame, state->rule.signal);
+		active = evaluate(state, event.value, frame->timestamp);
+
+		if( active == state->active )
+			continue;
+
+		state->active = active;
+		if( active )
+			this->activeMask |= (uint8_t)(1 << i);
+		else
+			this->activeMask &= (uint8_t)~(1 << i);
+		this->events++;
+		changed++;
+
+		if( this->callback )
+		{
+			event.rule = i;
+			event.active = active;
+			event.rate = state->rate;
+			event.time = frame->timestamp;
+			this->callback(&event, this->context);
+		}
+	}
+
+	return changed;
+}
+
+bool ENS160EventEngine::isActive()
+{
+	return this->activeMask != 0;
+}
+
+uint8_t ENS160EventEngine::getActiveMask()
+{
+	return this->activeMask;
+}
+
+int32_t ENS160EventEngine::getRate(uint8_t rule)
+{
+	return rule < this->ruleCount ? this->rules[rule].rate : 0;
+}
+
+uint32_t ENS160EventEngine::getEventCount()
+{
+	return this->events;
+}
+
+ENS160AdaptiveRate::ENS160AdaptiveRate()
+{
+	this->fast = ENS160_RATE_FAST_MS;
+	this->slow = ENS160_RATE_SLOW_MS;
+	this->settle = ENS160_RATE_SETTLE_MS;
+	this->reportEvery = ENS160_RATE_REPORT_MS;
+	this->interval = ENS160_RATE_FAST_MS;
+	this->quietSince = 0;
+	this->reportedAt = 0;
+	this->reported = false;
+	this->busy = true;
+}
+
+void ENS160AdaptiveRate::setLimits(uint32_t fastMs, uint32_t slowMs, uint32_t settleMs, uint32_t reportMs)
+{
+	this->fast = fastMs ? fastMs : 1;
+	this->slow = slowMs > this->fast ? slowMs : this->fast;
+	this->settle = settleMs;
+	this->reportEvery = reportMs;
+	this->interval = this->fast;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// update()
+//
+// The first call starts the settle time, so a freshly started sensor is
+// followed closely for a while before the interval is allowed to grow.
+
+void ENS160AdaptiveRate::update(bool active, uint32_t now)
+{
+	if( active || this->busy )
+	{
+		this->busy = active;
+		this->interval = this->fast;
+		this->quietSince = now;
+		return;
+	}
+
+	if( (uint32_t)(now - this->quietSince) < this->settle )
+		return;
+
+	this->interval = this->interval >= this->slow / 2 ? this->slow : this->interval * 2;
+}
+
+bool ENS160AdaptiveRate::reportDue(uint32_t now)
+{
+	if( !this->busy && this->reported && (uint32_t)(now - this->reportedAt) < this->reportEvery )
+		return false;
+
+	this->reported = true;
+	this->reportedAt = now;
+
+	return true;
+}
+
+uint32_t ENS160AdaptiveRate::getPollInterval()
+{
+	return this->interval;
+}
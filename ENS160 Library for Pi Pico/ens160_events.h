@@ -0,0 +1,163 @@
+#pragma once
+#include "ens160_i2c.h"
+
+// Rules held by one ENS160EventEngine
+#define ENS160_EVENT_MAX_RULES 8
+
+// Rule types
+#define ENS160_RULE_ABOVE     0 // value at or above the threshold
+#define ENS160_RULE_RATE      1 // value changing faster than threshold units per minute, either way
+#define ENS160_RULE_SUSTAINED 2 // value at or above the threshold for at least durationMs
+
+// Values a rule can watch
+#define ENS160_SIGNAL_AQI  0
+#define ENS160_SIGNAL_TVOC 1
+#define ENS160_SIGNAL_ECO2 2
+
+// The rate of change is smoothed over about 2^ENS160_EVENT_RATE_SHIFT samples
+#define ENS160_EVENT_RATE_SHIFT 2
+
+// Adaptive rate defaults: poll at the example's 100 ms during events, back off
+// to 10 s once nothing has happened for a minute, report once a minute at rest
+#define ENS160_RATE_FAST_MS   100
+#define ENS160_RATE_SLOW_MS   10000
+#define ENS160_RATE_SETTLE_MS 60000
+#define ENS160_RATE_REPORT_MS 60000
+
+typedef struct
+{
+	uint8_t type;        // ENS160_RULE_*
+	uint8_t signal;      // ENS160_SIGNAL_*
+	uint16_t threshold;  // value, or units per minute for ENS160_RULE_RATE
+	uint16_t hysteresis; // an active rule ends below threshold - hysteresis
+	uint32_t durationMs; // ENS160_RULE_SUSTAINED only
+}	ens160_rule_t;
+
+// Passed to the callback when a rule becomes active and again when it ends
+typedef struct
+{
+	uint8_t rule;     // index returned by addRule()
+	bool active;      // true when the rule starts, false when it ends
+	uint16_t value;   // the watched value at that sample
+	int32_t rate;     // its smoothed rate of change in units per minute
+	uint32_t time;    // frame timestamp in ms
+}	ens160_event_t;
+
+typedef void (*ens160_event_callback_t)(const ens160_event_t *event, void *context);
+
+// Running state of one rule, the same size whatever the rule
+typedef struct
+{
+	ens160_rule_t rule;
+	bool active;
+	bool exceeding;    // over the threshold since `since`
+	bool primed;       // last and lastTime hold a sample
+	uint16_t last;
+	uint32_t lastTime;
+	uint32_t since;
+	int32_t rate;
+}	ens160_rule_state_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160EventEngine
+//
+// Evaluates threshold, rate of change and sustained exceedance rules on each
+// new valid frame as it arrives. Every rule keeps a fixed handful of values
+// (the previous sample, a smoothed rate, when the exceedance began), so the
+// cost per frame is constant and no history is stored. A rule becomes active
+// when its condition holds and ends once the value has fallen back past the
+// hysteresis, and the callback hears of both. Frames that are not valid or
+// carry no new data are ignored.
+
+class ENS160EventEngine {
+    public:
+        ENS160EventEngine();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // addRule()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  rule         rule to add, copied
+        //  retval       its index, or -1 if ENS160_EVENT_MAX_RULES are already in use
+
+        int8_t addRule(const ens160_rule_t *rule);
+        void clearRules();
+        void setCallback(ens160_event_callback_t callback, void *context);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // update()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  frame        frame just read, its timestamp is the sample time
+        //  retval       number of rules that started or ended on this frame
+
+        uint8_t update(const ens160_frame_t *frame);
+
+        bool isActive();
+        uint8_t getActiveMask();
+        int32_t getRate(uint8_t rule);
+        uint32_t getEventCount();
+
+    private:
+        ens160_rule_state_t rules[ENS160_EVENT_MAX_RULES];
+        uint8_t ruleCount;
+        uint8_t activeMask;
+        uint32_t events;
+        ens160_event_callback_t callback;
+        void *context;
+        bool evaluate(ens160_rule_state_t *state, uint16_t value, uint32_t now);
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160AdaptiveRate
+//
+// Turns the engine's activity into a poll interval and a report decision.
+// While a rule is active, or one has just started or ended, polling runs at
+// the fast interval and every frame is reported. Once nothing has happened for
+// the settle time the interval doubles with each poll up to the slow one, and
+// only one frame per report interval goes out. The price is detection delay at
+// rest: a threshold crossing is seen up to one slow interval late.
+
+class ENS160AdaptiveRate {
+    public:
+        ENS160AdaptiveRate();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // setLimits()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  fastMs       poll interval during events
+        //  slowMs       longest poll interval at rest
+        //  settleMs     quiet time before the interval starts growing
+        //  reportMs     time between reported frames at rest
+
+        void setLimits(uint32_t fastMs, uint32_t slowMs, uint32_t settleMs, uint32_t reportMs);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // update()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  active       a rule is active or started or ended at this poll
+        //  now          current time in ms
+
+        void update(bool active, uint32_t now);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // reportDue()
+        //  Returns true if a frame read now should be reported, and counts it as
+        //  reported.
+
+        bool reportDue(uint32_t now);
+        uint32_t getPollInterval();
+
+    private:
+        uint32_t fast;
+        uint32_t slow;
+        uint32_t settle;
+        uint32_t reportEvery;
+        uint32_t interval;
+        uint32_t quietSince;
+        uint32_t reportedAt;
+        bool reported;
+        bool busy;
+};
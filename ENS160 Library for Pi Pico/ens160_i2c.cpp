@@ -1,724 +1,1652 @@
-#include "ens160_i2c.h"
-
-ENS160::ENS160(i2c_inst_t *i2c_device_bus, int i2c_device_address)
-{
-    this->i2c_address = i2c_device_address;
-    this->i2cbus = i2c_device_bus;
-}
-bool ENS160::ping(int address)
-{
-    int ret;
-    uint8_t rxdata;
-    ret = i2c_read_blocking(this->i2cbus, address, &rxdata, 1, false);
-    if (ret != PICO_ERROR_GENERIC)
-        return true;
-    return false;
-}
-
-int32_t ENS160::readRegisterRegion(uint8_t reg, uint8_t *data, uint8_t length)
-{
-    i2c_write_blocking(this->i2cbus, this->i2c_address, const_cast<uint8_t*>(&reg), 1, true);
-	return i2c_read_blocking(this->i2cbus, this->i2c_address, data, length, false);
-}
-
-int32_t ENS160::writeRegisterRegion(uint8_t *data, uint8_t length)
-{
-    return i2c_write_blocking(this->i2cbus, this->i2c_address, const_cast<uint8_t*>(data), length, true);
-}
-
-int32_t ENS160::writeRegisterRegion(uint8_t reg, uint8_t data, uint8_t length)
-{
-    uint8_t buf[] = {reg, data};
-    return i2c_write_blocking(this->i2cbus, this->i2c_address, buf, length, true);
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// getUniqueID()
-// Gets the device's unique ID
-uint16_t ENS160::getUniqueID()
-{
-    int32_t retVal;
-	uint8_t tempVal[2] = {0}; 
-	uint16_t id; 
-
-    retVal = readRegisterRegion(SFE_ENS160_PART_ID, tempVal, 2);
-
-	id = tempVal[0];
-	id |= tempVal[1] << 8;
-
-	if( retVal != 0 )
-		return 0;
-
-	return id; 
-}
-
-///////////////////////////////////////////////////////////////////////
-// isConnected()
-//  Parameter   Description
-//  ---------   -----------------------------
-//  retVal      true if device is connected, false if not connected
-
-bool ENS160::isConnected()
-{
-	uint16_t uniqueID; 
-	uniqueID = getUniqueID(); 
-	if( uniqueID != ENS160_DEVICE_ID )
-		return false;
-	return true;
-}
-
-bool ENS160::init()
-{
-    if(!this->ping(this->i2c_address))
-        return false;
-    return this->isConnected();
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// setOperatingMode()
-// Sets the operating mode: Deep Sleep (0x00), Idle (0x01), Standard (0x02), Reset (0xF0)
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  val					 The desired operating mode to set. 
-bool ENS160::setOperatingMode(uint8_t val)
-{
-	int32_t retVal;
-
-	if( val > SFE_ENS160_RESET )
-		return false;
-
-	retVal = this->writeRegisterRegion(SFE_ENS160_OP_MODE, val, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true; 
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// getOperatingMode()
-//
-// Gets the current operating mode: Deep Sleep (0x00), Idle (0x01), Standard (0x02), Reset (0xF0)
-
-int8_t ENS160::getOperatingMode()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_OP_MODE, &tempVal, 1);
-
-	if( retVal != 0 )
-		return -1;
-
-	return tempVal; 
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// configureInterrupt()
-//
-// Changes all of the settings within the interrupt configuration register.
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  val					 The desired configuration settings.
-
-bool ENS160::configureInterrupt(uint8_t val)
-{
-	int32_t retVal;
-
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, val, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// setInterrupt()
-//
-// Enables the interrupt.
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  enable			 Turns on or off the interrupt. 
-
-bool ENS160::enableInterrupt(bool enable)
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-	
-	tempVal = (tempVal | (uint8_t)enable); 
-
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true;
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// setInterruptPolarity()
-//
-// Changes the polarity of the interrupt: active high or active low. By default
-// this value is set to zero or active low. 
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  activeHigh   Changes active state of interrupt from high to low. 
-
-bool ENS160::setInterruptPolarity(bool activeHigh)
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-	
-	if( retVal != 0 )
-		return false;
-
-	tempVal = (tempVal | (activeHigh << 6)); 
-
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true;
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// getInterruptPolarity()
-//
-// Retrieves the polarity of the physical interrupt. 
-
-int8_t ENS160::getInterruptPolarity()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-	
-	if( retVal != 0 )
-		return -1;
-
-	tempVal &= 0x40;
-
-	return (tempVal >> 6);
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// setInterruptDrive()
-//
-// Changes the pin drive of the interrupt: open drain (default) to push/pull
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  pushPull     Changes the drive of the pin. 
-
-bool ENS160::setInterruptDrive(bool pushPull)
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-	
-	tempVal = (tempVal | (uint8_t)(pushPull << 5)); 
-
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// setDataInterrupt()
-//
-// Routes the data ready signal to the interrupt pin.
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  enable			 Self-explanatory: enables or disables data ready on interrupt.
-
-bool ENS160::setDataInterrupt(bool enable)
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-	
-	tempVal = (tempVal | (uint8_t)(enable << 1)); 
-
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true; 
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// setGPRInterrupt()
-//
-// Routes the general purporse read register signal to the interrupt pin.
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  enable			 Self-explanatory: enables or disables general purpos read interrupt.
-
-bool ENS160::setGPRInterrupt(bool enable)
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-	
-	tempVal = (tempVal | (uint8_t)(enable << 3)); 
-	
-	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
-
-	if( retVal != 0 )
-		return false;
-
-	return true; 
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getAppVer()
-//
-// Retrieves the 24 bit application version of the device.
-
-uint32_t ENS160::getAppVer()
-{
-	int32_t retVal;
-	uint8_t tempVal[3] = {0};
-	uint32_t version;
-
-	retVal = readRegisterRegion(SFE_ENS160_GPR_READ4, tempVal, 3);
-
-	if( retVal != 0 )
-		return 0;
-
-	version = tempVal[0];
-	version |= tempVal[1] << 8;
-	version |= tempVal[2] << 16;
-
-	return version;
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// setTempCompensation()
-//
-// The ENS160 can use temperature data to help give more accurate sensor data. 
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  kelvinConversion	 The given temperature in Kelvin 
-
-bool ENS160::setTempCompensation(float tempKelvin)
-{
-	int32_t retVal;
-	uint8_t tempVal[3] = {0};
-	uint16_t kelvinConversion = tempKelvin; 
-
-	kelvinConversion = kelvinConversion * 64; // convert value - fixed equation pg. 29 of datasheet
-    tempVal[0] = SFE_ENS160_TEMP_IN;
-	tempVal[1] = (kelvinConversion & 0x00FF);
-	tempVal[2] = (kelvinConversion & 0xFF00) >> 8;
-
-	retVal = writeRegisterRegion(tempVal, 2);
-
-	if( retVal != 0 )
-		return false;
-
-	return true; 
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// setTempCompensationCelsius()
-//
-// The ENS160 can use temperature data to help give more accurate sensor data. 
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  tempCelsius	 The given temperature in Celsius 
-
-bool ENS160::setTempCompensationCelsius(float tempCelsius)
-{
-	float kelvinConversion = tempCelsius + 273.15; 
-
-	if( setTempCompensation(kelvinConversion) )
-			return true;
-
-	return false; 
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// setRHCompensation()
-//
-// The ENS160 can use relative Humidiy data to help give more accurate sensor data. 
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  humidity	   The given relative humidity. 
-
-bool ENS160::setRHCompensation(uint16_t humidity)
-{
-	int32_t retVal;
-	uint8_t tempVal[3] = {0};
-
-	humidity = humidity * 512; // convert value - fixed equation pg. 29 in datasheet. 
-    tempVal[0] = SFE_ENS160_RH_IN;
-	tempVal[1] = (humidity & 0x00FF);
-	tempVal[2] = (humidity & 0xFF00) >> 8;
-
-	retVal = writeRegisterRegion(tempVal, 2);
-
-	if( retVal != 0 )
-		return false;
-
-	return true; 
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// setRHCompensationFloat()
-//
-// The ENS160 can use relative Humidiy data to help give more accurate sensor data. 
-//
-//  Parameter    Description
-//  ---------    -----------------------------
-//  humidity	   The given relative humidity. 
-
-bool ENS160::setRHCompensationFloat(float humidity)
-{
-	uint16_t humidityConversion = (uint16_t)humidity;
-
-	if( setRHCompensation(humidityConversion) )
-		return false;
-
-	return true; 
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// checkDataStatus()
-//
-// This checks the if the NEWDAT bit is high indicating that new data is ready to be read. 
-// The bit is cleared when data has been read from their registers. 
-
-bool ENS160::checkDataStatus()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false; 
-
-	tempVal &= 0x02; 
-
-	if( tempVal == 0x02 )
-		return true;
-
-	return false;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// checkGPRStatus()
-//
-// This checks the if the NEWGPR bit is high indicating that there is data in the
-// general purpose read registers. The bit is cleared the relevant registers have been
-// read. 
-
-bool ENS160::checkGPRStatus()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false; 
-
-	tempVal &= 0x01;
-
-	if( tempVal == 0x01 )
-		return true;
-
-	return false;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getFlags()
-//
-// This checks the status "flags" of the device (0-3).
-
-uint8_t ENS160::getFlags()
-{
-	int32_t retVal;
-	uint8_t tempVal;
-
-	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
-
-	if( retVal != 0 )
-		return 0xFF; // Change to general error
-
-	tempVal = (tempVal & 0x0C) >> 2; 
-
-	switch( tempVal )
-	{
-		case 0: // Normal operation
-			return 0;
-			break;
-		case 1: // Warm-up phase
-			return 1;
-			break;
-		case 2: // Initial Start-Up Phase
-			return 2;
-			break;
-		case 3: // Invalid Output
-			return 3;
-			break;
-		default:
-			return 0xFF;
-	}
-}
-
-
-
-//////////////////////////////////////////////////////////////////////////////
-// checkOperationStatus()
-//
-// Checks the bit that indicates if an operation mode is running i.e. the device is not off. 
-
-bool ENS160::checkOperationStatus()
-{
-	int32_t retVal;
-	uint8_t tempVal;
-
-	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false; 
-
-	tempVal &= 0x80;
-
-	if( tempVal == 0x80 )
-		return true;
-
-	return false;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getOperationError()
-//
-// Checks the bit that indicates if an invalid operating mode has been selected. 
-
-bool ENS160::getOperationError()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
-
-	if( retVal != 0 )
-		return false; 
-
-	tempVal &= 0x40;
-
-	if( tempVal == 0x40 )
-		return true;
-
-	return false;
-}
-
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getAQI()
-//
-// This reports the calculated Air Quality Index according to UBA which is a value between 1-5. 
-// The AQI-UBA is a guideline developed by the German Federal Environmental Agency and is widely 
-// referenced and adopted by many countries and organizations. 
-//
-// 1 - Excellent, 2 - Good, 3 - Moderate, 4 - Poor, 5 - Unhealthy. 
-
-uint8_t ENS160::getAQI()
-{
-	int32_t retVal;
-	uint8_t tempVal; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_AQI, &tempVal, 1);
-
-	if( retVal != 0 )
-		return 0;
-	
-	tempVal = (tempVal & 0x03);
-
-	return tempVal;
-}
-
-//////////////////////////////////////////////////////////////////////////////
-// getTVOC()
-//
-// This reports the Total Volatile Organic Compounds in ppb (parts per billion)
-
-uint16_t ENS160::getTVOC()
-{
-	int32_t retVal;
-	uint16_t tvoc; 
-	uint8_t tempVal[2] = {0}; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_TVOC, tempVal, 2);
-
-	if( retVal != 0 )
-		return 0;
-	
-	tvoc = tempVal[0];
-	tvoc |= tempVal[1] << 8;
-
-	return tvoc;
-}
-
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getETOH()
-//
-// This reports the ehtanol concentration in ppb (parts per billion). According to 
-// the datasheet this is a "virtual mirror" of the ethanol-calibrated TVOC register, 
-// which is why they share the same register. 
-
-uint16_t ENS160::getETOH()
-{
-	int32_t retVal;
-	uint16_t ethanol; 
-	uint8_t tempVal[2] = {0}; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_ETOH, tempVal, 2);
-
-	if( retVal != 0 )
-		return 0;
-	
-	ethanol = tempVal[0];
-	ethanol |= tempVal[1] << 8;
-
-	return ethanol;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getECO2()
-//
-// This reports the CO2 concentration in ppm (parts per million) based on the detected VOCs and hydrogen. 
-
-uint16_t ENS160::getECO2()
-{
-	int32_t retVal;
-	uint16_t eco; 
-	uint8_t tempVal[2] = {0}; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_ECO2, tempVal, 2);
-
-	if( retVal != 0 )
-		return 0;
-	
-	eco = tempVal[0];
-	eco |= tempVal[1]  << 8;
-
-	return eco;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getTempKelvin()
-//
-// This reports the temperature compensation value given to the sensor in Kelvin.
-
-float ENS160::getTempKelvin()
-{
-	int32_t retVal;
-	float temperature; 
-	int16_t tempConversion; 
-	uint8_t tempVal[2] = {0}; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_T, tempVal, 2);
-
-	if( retVal != 0 )
-		return 0;
-	
-	tempConversion = tempVal[0];
-	tempConversion |= (tempVal[1] << 8);
-	temperature = (float)tempConversion; 
-
-	temperature = temperature/64; // Formula as described on pg. 32 of datasheet.
-
-	return temperature;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getTempCelsius()
-//
-// This reports the temperature compensation value given to the sensor in Celsius.
-
-float ENS160::getTempCelsius()
-{
-	float temperature; 
-
-	temperature = getTempKelvin();
-
-	return (temperature - 273.15);
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// getRH()
-//
-// This reports the relative humidity compensation value given to the sensor.
-
-float ENS160::getRH()
-{
-	int32_t retVal;
-	uint16_t rh; 
-	uint8_t tempVal[2] = {0}; 
-
-	retVal = readRegisterRegion(SFE_ENS160_DATA_RH, tempVal, 2);
-
-	if( retVal != 0 )
-		return 0;
-	
-	rh = tempVal[0];
-	rh |= tempVal[1] << 8;
-
-	rh = rh/512; // Formula as described on pg. 33 of datasheet.
-
-	return rh;
-}
\ No newline at end of file
+#include "ens160_i2c.h"
+#include "pico/time.h"
+#if ENS160_FEATURE_RECOVERY
+#include "hardware/gpio.h"
+#endif
+
+// Bus recovery steps, see serviceBus()
+#define ENS160_RECOVERY_IDLE   0
+#define ENS160_RECOVERY_CLOCK  1
+#define ENS160_RECOVERY_STOP   2
+#define ENS160_RECOVERY_REINIT 3
+
+#if ENS160_FEATURE_CALIBRATION
+// Bus clocks tried by calibrateBusSpeed(), slowest first
+static const uint32_t busSpeeds[] = { 100 * 1000, 400 * 1000, 1000 * 1000 };
+#endif
+
+ENS160::ENS160(i2c_inst_t *i2c_device_bus, int i2c_device_address)
+{
+    this->i2c_address = i2c_device_address;
+    this->i2cbus = i2c_device_bus;
+    this->validOnly = false;
+    this->validityState = 0xFF;
+    this->validityStart = 0;
+    this->validFrames = 0;
+    this->invalidFrames = 0;
+#if ENS160_FEATURE_FIELDS
+    this->busCost.transactionCost = ENS160_DEFAULT_TRANSACTION_COST;
+    this->busCost.byteCost = ENS160_DEFAULT_BYTE_COST;
+    this->plan.fields = 0;
+    this->plan.count = 0;
+#endif
+    this->retries = ENS160_DEFAULT_RETRIES;
+    this->backoffUs = ENS160_DEFAULT_BACKOFF_US;
+    this->failureStreak = 0;
+    this->recoveryState = ENS160_RECOVERY_IDLE;
+#if ENS160_FEATURE_RECOVERY
+    this->sdaPin = ENS160_PIN_NONE;
+    this->sclPin = ENS160_PIN_NONE;
+#endif
+    this->baudrate = 0;
+    this->busErrors = 0;
+    this->recoveries = 0;
+#if ENS160_FEATURE_SNAPSHOT
+    this->shadow.opMode = SFE_ENS160_DEEP_SLEEP;
+    this->shadow.config = 0;
+    this->shadow.tempIn = 0;
+    this->shadow.rhIn = 0;
+    this->autoRestore = false;
+    this->restores = 0;
+#endif
+}
+bool ENS160::ping(int address)
+{
+    int ret;
+    uint8_t rxdata;
+    ret = i2c_read_blocking(this->i2cbus, address, &rxdata, 1, false);
+    if (ret != PICO_ERROR_GENERIC)
+        return true;
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readRegisterRegion()
+//
+// Reads length bytes starting at reg. A failed transfer is retried up to the
+// retry budget, waiting backoffUs, 2 * backoffUs, ... between attempts. While
+// the bus is being recovered nothing is sent and ENS160_ERR_RECOVERING is
+// returned straight away, so a stuck bus never stalls the caller.
+
+int32_t ENS160::readRegisterRegion(uint8_t reg, uint8_t *data, uint8_t length)
+{
+	int32_t retVal;
+	uint8_t attempt;
+
+	if( !serviceBus() )
+		return ENS160_ERR_RECOVERING;
+
+	retVal = readOnce(reg, data, length);
+
+	for( attempt = 0; retVal != ENS160_OK && attempt < this->retries; attempt++ )
+	{
+		sleep_us((uint64_t)this->backoffUs << attempt);
+		retVal = readOnce(reg, data, length);
+	}
+
+	return finishTransfer(retVal);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// writeRegisterRegion()
+//
+// Writes a buffer whose first byte is the register address, with the same
+// retry and recovery handling as readRegisterRegion(). Configuration that
+// made it to the sensor is kept for restoring it after a sensor reset.
+
+int32_t ENS160::writeRegisterRegion(uint8_t *data, uint8_t length)
+{
+	int32_t retVal;
+	uint8_t attempt;
+
+	if( !serviceBus() )
+		return ENS160_ERR_RECOVERING;
+
+	retVal = writeOnce(data, length);
+
+	for( attempt = 0; retVal != ENS160_OK && attempt < this->retries; attempt++ )
+	{
+		sleep_us((uint64_t)this->backoffUs << attempt);
+		retVal = writeOnce(data, length);
+	}
+
+	retVal = finishTransfer(retVal);
+#if ENS160_FEATURE_SNAPSHOT
+	if( retVal == ENS160_OK )
+		noteWrite(data, length);
+#endif
+
+	return retVal;
+}
+
+int32_t ENS160::writeRegisterRegion(uint8_t reg, uint8_t data, uint8_t length)
+{
+	uint8_t buf[] = {reg, data};
+
+	return writeRegisterRegion(buf, length + 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// busError()
+//
+// Maps a Pico SDK transfer result onto the driver's error codes.
+
+static int32_t busError(int ret)
+{
+	if( ret == PICO_ERROR_TIMEOUT )
+		return ENS160_ERR_TIMEOUT;
+	if( ret == PICO_ERROR_GENERIC )
+		return ENS160_ERR_NACK;
+	return ENS160_ERR_SHORT;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readOnce()
+//
+// One register read: address write with a repeated start, then the data. Both
+// halves are bounded by a timeout so a stuck bus cannot hang the caller.
+
+int32_t ENS160::readOnce(uint8_t reg, uint8_t *data, uint8_t length)
+{
+	int ret;
+
+	ret = i2c_write_timeout_us(this->i2cbus, this->i2c_address, &reg, 1, true, 
+		ENS160_TIMEOUT_BASE_US + ENS160_TIMEOUT_PER_BYTE_US);
+
+	if( ret != 1 )
+		return busError(ret);
+
+	ret = i2c_read_timeout_us(this->i2cbus, this->i2c_address, data, length, false, 
+		ENS160_TIMEOUT_BASE_US + length * ENS160_TIMEOUT_PER_BYTE_US);
+
+	if( ret != length )
+		return busError(ret);
+
+	return ENS160_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// writeOnce()
+//
+// One register write, terminated with a stop condition.
+
+int32_t ENS160::writeOnce(const uint8_t *data, uint8_t length)
+{
+	int ret;
+
+	ret = i2c_write_timeout_us(this->i2cbus, this->i2c_address, data, length, false, 
+		ENS160_TIMEOUT_BASE_US + length * ENS160_TIMEOUT_PER_BYTE_US);
+
+	if( ret != length )
+		return busError(ret);
+
+	return ENS160_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// finishTransfer()
+//
+// Book-keeping after the retries of one operation. A timeout, or a run of 
+// failed operations, suggests a slave is holding SDA low, so bus recovery is
+// started; it is carried out step by step by serviceBus().
+
+int32_t ENS160::finishTransfer(int32_t retVal)
+{
+	if( retVal == ENS160_OK )
+	{
+		this->failureStreak = 0;
+		return ENS160_OK;
+	}
+
+	this->busErrors++;
+	this->failureStreak++;
+
+#if ENS160_FEATURE_RECOVERY
+	if( retVal == ENS160_ERR_TIMEOUT || this->failureStreak >= ENS160_RECOVER_AFTER )
+	{
+		this->failureStreak = 0;
+		this->recoveryState = ENS160_RECOVERY_CLOCK;
+	}
+#endif
+
+	return retVal;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setRetryPolicy()
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  retries      Extra attempts after a failed transfer (0 disables retries).
+//  backoffUs    Wait before the first retry; doubled for every further retry.
+
+void ENS160::setRetryPolicy(uint8_t retries, uint16_t backoffUs)
+{
+	this->retries = retries;
+	this->backoffUs = backoffUs;
+}
+
+#if ENS160_FEATURE_RECOVERY
+//////////////////////////////////////////////////////////////////////////////
+// setBusPins()
+//
+// Tells the driver which pins and clock the bus uses so it can clock a stuck
+// bus free and re-initialise the controller. Without them recovery only 
+// resets the error count.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  sda          SDA GPIO
+//  scl          SCL GPIO
+//  baudrate     Clock passed to i2c_init() when the controller is re-initialised
+
+void ENS160::setBusPins(uint8_t sda, uint8_t scl, uint32_t baudrate)
+{
+	this->sdaPin = sda;
+	this->sclPin = scl;
+	this->baudrate = baudrate;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// serviceBus()
+//
+// Advances bus recovery by one short step (at most ~100 us) and returns true
+// once the bus can be used again. Recovery is: clock SCL up to nine times until
+// the slave releases SDA, generate a stop condition, then hand the pins back to
+// the I2C controller and re-initialise it. Register accesses call this first, 
+// so a loop serving several sensors keeps running while one bus recovers.
+// Without ENS160_FEATURE_RECOVERY the bus is always reported usable.
+
+bool ENS160::serviceBus()
+{
+#if ENS160_FEATURE_RECOVERY
+	uint8_t i;
+
+	switch( this->recoveryState )
+	{
+		case ENS160_RECOVERY_IDLE:
+			return true;
+
+		case ENS160_RECOVERY_CLOCK:
+			if( this->sdaPin == ENS160_PIN_NONE || this->sclPin == ENS160_PIN_NONE )
+			{
+				this->recoveryState = ENS160_RECOVERY_REINIT;
+				return false;
+			}
+			// Drive the pins open-drain style: output low, or input to let the pull-up win
+			gpio_init(this->sdaPin);
+			gpio_init(this->sclPin);
+			gpio_pull_up(this->sdaPin);
+			gpio_pull_up(this->sclPin);
+			for( i = 0; i < 9 && !gpio_get(this->sdaPin); i++ )
+			{
+				gpio_set_dir(this->sclPin, GPIO_OUT);
+				busy_wait_us_32(5);
+				gpio_set_dir(this->sclPin, GPIO_IN);
+				busy_wait_us_32(5);
+			}
+			this->recoveryState = ENS160_RECOVERY_STOP;
+			return false;
+
+		case ENS160_RECOVERY_STOP:
+			gpio_set_dir(this->sclPin, GPIO_OUT);
+			gpio_set_dir(this->sdaPin, GPIO_OUT);
+			busy_wait_us_32(5);
+			gpio_set_dir(this->sclPin, GPIO_IN);
+			busy_wait_us_32(5);
+			gpio_set_dir(this->sdaPin, GPIO_IN);
+			busy_wait_us_32(5);
+			this->recoveryState = ENS160_RECOVERY_REINIT;
+			return false;
+
+		case ENS160_RECOVERY_REINIT:
+			if( this->sdaPin != ENS160_PIN_NONE && this->sclPin != ENS160_PIN_NONE )
+			{
+				gpio_set_function(this->sdaPin, GPIO_FUNC_I2C);
+				gpio_set_function(this->sclPin, GPIO_FUNC_I2C);
+			}
+			if( this->baudrate != 0 )
+				i2c_init(this->i2cbus, this->baudrate);
+			this->recoveries++;
+			this->recoveryState = ENS160_RECOVERY_IDLE;
+			return true;
+	}
+#endif
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// isRecovering()
+//
+// True while bus recovery is still in progress.
+
+bool ENS160::isRecovering()
+{
+	return this->recoveryState != ENS160_RECOVERY_IDLE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getBusErrorCount()
+//
+// Number of register accesses that failed after all retries.
+
+uint32_t ENS160::getBusErrorCount()
+{
+	return this->busErrors;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getRecoveryCount()
+//
+// Number of completed bus recoveries.
+
+uint32_t ENS160::getRecoveryCount()
+{
+	return this->recoveries;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setBusSpeed()
+//
+// Changes the bus clock and remembers it for re-initialisation after recovery.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  baudrate     Requested clock in Hz
+//  retval       Clock actually set by the SDK
+
+uint32_t ENS160::setBusSpeed(uint32_t baudrate)
+{
+	this->baudrate = i2c_set_baudrate(this->i2cbus, baudrate);
+
+	return this->baudrate;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getBusSpeed()
+//
+// Returns the last clock set through setBusSpeed() or setBusPins(), 0 if unknown.
+
+uint32_t ENS160::getBusSpeed()
+{
+	return this->baudrate;
+}
+
+#if ENS160_FEATURE_CALIBRATION
+//////////////////////////////////////////////////////////////////////////////
+// misrUpdate()
+//
+// Folds one byte read from a DATA_ register into the running MISR the same way
+// the sensor does (polynomial POLY, datasheet DATA_MISR description).
+
+static uint8_t misrUpdate(uint8_t misr, uint8_t data)
+{
+	uint8_t misrXor = (uint8_t)((misr << 1) ^ data);
+
+	if( (misr & 0x80) == 0 )
+		return misrXor;
+
+	return misrXor ^ POLY;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// verifyBus()
+//
+// Checks the link at the current clock without retries: every round must read
+// the expected PART_ID, and a DATA_AQI..DATA_ECO2 burst whose bytes, folded into
+// the MISR seen before the burst, give the MISR the sensor reports after it.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  reads        Number of rounds to run
+//  retval       true if every round passed
+
+bool ENS160::verifyBus(uint8_t reads)
+{
+	uint8_t savedRetries = this->retries;
+	uint8_t tempVal[5];
+	uint8_t misr;
+	uint8_t expected;
+	uint8_t i;
+	uint8_t j;
+	bool passed = true;
+
+	this->retries = 0;
+
+	for( i = 0; i < reads && passed; i++ )
+	{
+		passed = false;
+
+		if( readUniqueID().value != ENS160_DEVICE_ID )
+			break;
+		if( readRegisterRegion(SFE_ENS160_DATA_MISR, &misr, 1) != 0 )
+			break;
+		if( readRegisterRegion(SFE_ENS160_DATA_AQI, tempVal, 5) != 0 )
+			break;
+
+		expected = misr;
+		for( j = 0; j < 5; j++ )
+			expected = misrUpdate(expected, tempVal[j]);
+
+		if( readRegisterRegion(SFE_ENS160_DATA_MISR, &misr, 1) != 0 )
+			break;
+
+		passed = (misr == expected);
+	}
+
+	this->retries = savedRetries;
+
+	return passed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// calibrateBusSpeed()
+//
+// Tries 100 kHz, 400 kHz and 1 MHz in turn and keeps the fastest clock at which 
+// verifyBus() passes. The result is applied and returned so the application
+// can store it for the next boot; 0 means even 100 kHz failed, in which case
+// the bus is left at 100 kHz.
+
+uint32_t ENS160::calibrateBusSpeed()
+{
+	uint32_t best = 0;
+	uint8_t i;
+
+	for( i = 0; i < sizeof(busSpeeds) / sizeof(busSpeeds[0]); i++ )
+	{
+		setBusSpeed(busSpeeds[i]);
+
+		if( !verifyBus(ENS160_CALIBRATION_READS) )
+			break;
+
+		best = busSpeeds[i];
+	}
+
+	setBusSpeed(best != 0 ? best : busSpeeds[0]);
+
+	// A failing clock may have armed recovery; finish it at the chosen clock
+	while( !serviceBus() )
+		;
+
+	this->failureStreak = 0;
+
+	return best;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// getUniqueID()
+// Gets the device's unique ID
+uint16_t ENS160::getUniqueID()
+{
+	return readUniqueID().value;
+}
+
+///////////////////////////////////////////////////////////////////////
+// isConnected()
+//  Parameter   Description
+//  ---------   -----------------------------
+//  retVal      true if device is connected, false if not connected
+
+bool ENS160::isConnected()
+{
+	uint16_t uniqueID; 
+	uniqueID = getUniqueID(); 
+	if( uniqueID != ENS160_DEVICE_ID )
+		return false;
+	return true;
+}
+
+bool ENS160::init()
+{
+    if(!this->ping(this->i2c_address))
+        return false;
+    return this->isConnected();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setOperatingMode()
+// Sets the operating mode: Deep Sleep (0x00), Idle (0x01), Standard (0x02), Reset (0xF0)
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  val					 The desired operating mode to set. 
+bool ENS160::setOperatingMode(uint8_t val)
+{
+	int32_t retVal;
+
+	if( val > SFE_ENS160_RESET )
+		return false;
+
+	retVal = this->writeRegisterRegion(SFE_ENS160_OP_MODE, val, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true; 
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getOperatingMode()
+//
+// Gets the current operating mode: Deep Sleep (0x00), Idle (0x01), Standard (0x02), Reset (0xF0)
+
+int8_t ENS160::getOperatingMode()
+{
+	ens160_result<uint8_t> mode = readOperatingMode();
+
+	if( !mode.ok() )
+		return -1;
+
+	return mode.value;
+}
+
+#if ENS160_FEATURE_INTERRUPT
+//////////////////////////////////////////////////////////////////////////////
+// configureInterrupt()
+//
+// Changes all of the settings within the interrupt configuration register.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  val					 The desired configuration settings.
+
+bool ENS160::configureInterrupt(uint8_t val)
+{
+	int32_t retVal;
+
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, val, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// setInterrupt()
+//
+// Enables the interrupt.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  enable			 Turns on or off the interrupt. 
+
+bool ENS160::enableInterrupt(bool enable)
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+	
+	tempVal = (tempVal | (uint8_t)enable); 
+
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setInterruptPolarity()
+//
+// Changes the polarity of the interrupt: active high or active low. By default
+// this value is set to zero or active low. 
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  activeHigh   Changes active state of interrupt from high to low. 
+
+bool ENS160::setInterruptPolarity(bool activeHigh)
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+	
+	if( retVal != 0 )
+		return false;
+
+	tempVal = (tempVal | (activeHigh << 6)); 
+
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getInterruptPolarity()
+//
+// Retrieves the polarity of the physical interrupt. 
+
+int8_t ENS160::getInterruptPolarity()
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+	
+	if( retVal != 0 )
+		return -1;
+
+	tempVal &= 0x40;
+
+	return (tempVal >> 6);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setInterruptDrive()
+//
+// Changes the pin drive of the interrupt: open drain (default) to push/pull
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  pushPull     Changes the drive of the pin. 
+
+bool ENS160::setInterruptDrive(bool pushPull)
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+	
+	tempVal = (tempVal | (uint8_t)(pushPull << 5)); 
+
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// setDataInterrupt()
+//
+// Routes the data ready signal to the interrupt pin.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  enable			 Self-explanatory: enables or disables data ready on interrupt.
+
+bool ENS160::setDataInterrupt(bool enable)
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+	
+	tempVal = (tempVal | (uint8_t)(enable << 1)); 
+
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true; 
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// setGPRInterrupt()
+//
+// Routes the general purporse read register signal to the interrupt pin.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  enable			 Self-explanatory: enables or disables general purpos read interrupt.
+
+bool ENS160::setGPRInterrupt(bool enable)
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_CONFIG, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+	
+	tempVal = (tempVal | (uint8_t)(enable << 3)); 
+	
+	retVal = writeRegisterRegion(SFE_ENS160_CONFIG, tempVal, 1);
+
+	if( retVal != 0 )
+		return false;
+
+	return true; 
+}
+#endif
+
+
+#if ENS160_FEATURE_GPR
+//////////////////////////////////////////////////////////////////////////////
+// getAppVer()
+//
+// Retrieves the 24 bit application version of the device with the GET_APPVER
+// command. Commands only run in IDLE mode, so the sensor is switched to IDLE
+// and afterwards back to the mode it was in; leaving STANDARD restarts its
+// warm-up. Waits up to ENS160_COMMAND_TIMEOUT_MS for the result and returns 0
+// if none came. ENS160CommandEngine does the same without blocking.
+
+uint32_t ENS160::getAppVer()
+{
+	ens160_result<uint8_t> mode = readOperatingMode();
+	ens160_result<uint8_t> status;
+	uint8_t gpr[8];
+	uint32_t version = 0;
+	uint32_t waited;
+
+	if( !mode.ok() )
+		return 0;
+
+	if( mode.value != SFE_ENS160_IDLE && !setOperatingMode(SFE_ENS160_IDLE) )
+		return 0;
+
+	// Reading GPR_READ clears a NEWGPR left over from an earlier command
+	if( readGPR(gpr) == ENS160_OK && writeCommand(SFE_ENS160_COMMAND_GET_APPVER) == ENS160_OK )
+	{
+		for( waited = 0; waited < ENS160_COMMAND_TIMEOUT_MS; waited += ENS160_COMMAND_POLL_MS )
+		{
+			status = readStatus();
+			if( status.ok() && (status.value & SFE_ENS160_STATUS_NEWGPR) )
+				break;
+			sleep_ms(ENS160_COMMAND_POLL_MS);
+		}
+
+		if( waited < ENS160_COMMAND_TIMEOUT_MS && readGPR(gpr) == ENS160_OK )
+		{
+			version = ens160DecodeLE16(&gpr[4]) | ((uint32_t)gpr[6] << 16);
+		}
+	}
+
+	if( mode.value != SFE_ENS160_IDLE )
+		setOperatingMode(mode.value);
+
+	return version;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// writeCommand()
+//
+// Writes COMMAND. The sensor ignores commands outside IDLE mode.
+
+int32_t ENS160::writeCommand(uint8_t command)
+{
+	return writeRegisterRegion(SFE_ENS160_COMMAND, command, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readGPR()
+//
+// Reads the eight general purpose read registers in one burst.
+
+int32_t ENS160::readGPR(uint8_t *gpr)
+{
+	return readRegisterRegion(SFE_ENS160_GPR_READ0, gpr, 8);
+}
+#endif
+
+#if ENS160_FEATURE_FLOAT
+//////////////////////////////////////////////////////////////////////////////
+// setTempCompensation()
+//
+// The ENS160 can use temperature data to help give more accurate sensor data. 
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  kelvinConversion	 The given temperature in Kelvin 
+
+bool ENS160::setTempCompensation(float tempKelvin)
+{
+	int32_t retVal;
+	uint8_t tempVal[3] = {0};
+	uint16_t kelvinConversion = tempKelvin; 
+
+	kelvinConversion = kelvinConversion * 64; // convert value - fixed equation pg. 29 of datasheet
+    tempVal[0] = SFE_ENS160_TEMP_IN;
+	tempVal[1] = (kelvinConversion & 0x00FF);
+	tempVal[2] = (kelvinConversion & 0xFF00) >> 8;
+
+	retVal = writeRegisterRegion(tempVal, 3);
+
+	if( retVal != 0 )
+		return false;
+
+	return true; 
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// setTempCompensationCelsius()
+//
+// The ENS160 can use temperature data to help give more accurate sensor data. 
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  tempCelsius	 The given temperature in Celsius 
+
+bool ENS160::setTempCompensationCelsius(float tempCelsius)
+{
+	float kelvinConversion = tempCelsius + 273.15; 
+
+	if( setTempCompensation(kelvinConversion) )
+			return true;
+
+	return false; 
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// setRHCompensation()
+//
+// The ENS160 can use relative Humidiy data to help give more accurate sensor data. 
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  humidity	   The given relative humidity. 
+
+bool ENS160::setRHCompensation(uint16_t humidity)
+{
+	int32_t retVal;
+	uint8_t tempVal[3] = {0};
+
+	humidity = humidity * 512; // convert value - fixed equation pg. 29 in datasheet. 
+    tempVal[0] = SFE_ENS160_RH_IN;
+	tempVal[1] = (humidity & 0x00FF);
+	tempVal[2] = (humidity & 0xFF00) >> 8;
+
+	retVal = writeRegisterRegion(tempVal, 3);
+
+	if( retVal != 0 )
+		return false;
+
+	return true; 
+}
+
+#if ENS160_FEATURE_FLOAT
+//////////////////////////////////////////////////////////////////////////////
+// setRHCompensationFloat()
+//
+// The ENS160 can use relative Humidiy data to help give more accurate sensor data. 
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  humidity	   The given relative humidity. 
+
+bool ENS160::setRHCompensationFloat(float humidity)
+{
+	uint16_t humidityConversion = (uint16_t)humidity;
+
+	if( setRHCompensation(humidityConversion) )
+		return false;
+
+	return true; 
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setCompensation()
+//
+// Writes temperature and humidity compensation together in one burst covering
+// TEMP_IN and RH_IN, keeping the fractional bits of both values.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  tempCelsius  The given temperature in Celsius
+//  humidity     The given relative humidity in %rH (0-100)
+
+bool ENS160::setCompensation(float tempCelsius, float humidity)
+{
+	int32_t retVal;
+	uint8_t tempVal[5];
+	uint16_t tempConversion;
+	uint16_t rhConversion;
+
+	if( humidity < 0 )
+		humidity = 0;
+	if( humidity > 100 )
+		humidity = 100;
+
+	tempConversion = (uint16_t)((tempCelsius + 273.15f) * 64 + 0.5f); // pg. 29 of datasheet
+	rhConversion = (uint16_t)(humidity * 512 + 0.5f);
+
+	tempVal[0] = SFE_ENS160_TEMP_IN;
+	tempVal[1] = (tempConversion & 0x00FF);
+	tempVal[2] = (tempConversion & 0xFF00) >> 8;
+	tempVal[3] = (rhConversion & 0x00FF);
+	tempVal[4] = (rhConversion & 0xFF00) >> 8;
+
+	retVal = writeRegisterRegion(tempVal, 5);
+
+	if( retVal != 0 )
+		return false;
+
+	return true;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// checkDataStatus()
+//
+// This checks the if the NEWDAT bit is high indicating that new data is ready to be read. 
+// The bit is cleared when data has been read from their registers. 
+
+bool ENS160::checkDataStatus()
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false; 
+
+	tempVal &= 0x02; 
+
+	if( tempVal == 0x02 )
+		return true;
+
+	return false;
+}
+
+
+#if ENS160_FEATURE_GPR
+//////////////////////////////////////////////////////////////////////////////
+// checkGPRStatus()
+//
+// This checks the if the NEWGPR bit is high indicating that there is data in the
+// general purpose read registers. The bit is cleared the relevant registers have been
+// read. 
+
+bool ENS160::checkGPRStatus()
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false; 
+
+	tempVal &= 0x01;
+
+	if( tempVal == 0x01 )
+		return true;
+
+	return false;
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getFlags()
+//
+// This checks the status "flags" of the device (0-3).
+
+uint8_t ENS160::getFlags()
+{
+	return readFlags().value;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// checkOperationStatus()
+//
+// Checks the bit that indicates if an operation mode is running i.e. the device is not off. 
+
+bool ENS160::checkOperationStatus()
+{
+	int32_t retVal;
+	uint8_t tempVal;
+
+	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false; 
+
+	tempVal &= 0x80;
+
+	if( tempVal == 0x80 )
+		return true;
+
+	return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getOperationError()
+//
+// Checks the bit that indicates if an invalid operating mode has been selected. 
+
+bool ENS160::getOperationError()
+{
+	int32_t retVal;
+	uint8_t tempVal; 
+
+	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+
+	if( retVal != 0 )
+		return false; 
+
+	tempVal &= 0x40;
+
+	if( tempVal == 0x40 )
+		return true;
+
+	return false;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getAQI()
+//
+// This reports the calculated Air Quality Index according to UBA which is a value between 1-5. 
+// The AQI-UBA is a guideline developed by the German Federal Environmental Agency and is widely 
+// referenced and adopted by many countries and organizations. 
+//
+// 1 - Excellent, 2 - Good, 3 - Moderate, 4 - Poor, 5 - Unhealthy. 
+
+uint8_t ENS160::getAQI()
+{
+	return readAQI().value;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getTVOC()
+//
+// This reports the Total Volatile Organic Compounds in ppb (parts per billion)
+
+uint16_t ENS160::getTVOC()
+{
+	return readTVOC().value;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getETOH()
+//
+// This reports the ehtanol concentration in ppb (parts per billion). According to 
+// the datasheet this is a "virtual mirror" of the ethanol-calibrated TVOC register, 
+// which is why they share the same register. 
+
+uint16_t ENS160::getETOH()
+{
+	return readETOH().value;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getECO2()
+//
+// This reports the CO2 concentration in ppm (parts per million) based on the detected VOCs and hydrogen. 
+
+uint16_t ENS160::getECO2()
+{
+	return readECO2().value;
+}
+
+
+#if ENS160_FEATURE_FLOAT
+//////////////////////////////////////////////////////////////////////////////
+// getTempKelvin()
+//
+// This reports the temperature compensation value given to the sensor in Kelvin.
+
+float ENS160::getTempKelvin()
+{
+	int32_t retVal;
+	float temperature; 
+	int16_t tempConversion; 
+	uint8_t tempVal[2];
+
+	retVal = readRegisterRegion(SFE_ENS160_DATA_T, tempVal, 2);
+
+	if( retVal != 0 )
+		return 0;
+	
+	tempConversion = (int16_t)ens160DecodeLE16(tempVal);
+	temperature = (float)tempConversion; 
+
+	temperature = temperature/64; // Formula as described on pg. 32 of datasheet.
+
+	return temperature;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getTempCelsius()
+//
+// This reports the temperature compensation value given to the sensor in Celsius.
+
+float ENS160::getTempCelsius()
+{
+	float temperature; 
+
+	temperature = getTempKelvin();
+
+	return (temperature - 273.15);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// getRH()
+//
+// This reports the relative humidity compensation value given to the sensor.
+
+float ENS160::getRH()
+{
+	int32_t retVal;
+	uint16_t rh; 
+	uint8_t tempVal[2];
+
+	retVal = readRegisterRegion(SFE_ENS160_DATA_RH, tempVal, 2);
+
+	if( retVal != 0 )
+		return 0;
+	
+	rh = ens160DecodeLE16(tempVal);
+
+	rh = rh/512; // Formula as described on pg. 33 of datasheet.
+
+	return rh;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// readFrame()
+//
+// Reads the device status and the AQI, TVOC and eCO2 registers in a single burst
+// and attaches the validity reported by that same status byte to the sample.
+//
+// When valid-only mode is enabled, frames that the sensor flags as warm-up, 
+// initial start-up or invalid are counted and rejected. While the sensor is not 
+// valid only the status byte is read, so gated samples cost a single byte transfer.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  frame        Frame to fill in.
+//  retval       true if a frame was delivered, false on bus error or if gated.
+
+bool ENS160::readFrame(ens160_frame_t *frame)
+{
+	int32_t retVal;
+	uint8_t tempVal[6];
+	uint8_t length = 6;
+
+	frame->newData = false;
+	frame->valid = false;
+
+	if( this->validOnly && this->validityState != SFE_ENS160_VALIDITY_NORMAL )
+		length = 1;
+
+	retVal = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, tempVal, length);
+
+	if( retVal != 0 )
+		return false;
+
+	frame->timestamp = to_ms_since_boot(get_absolute_time());
+	frame->status = tempVal[0];
+	frame->validity = (tempVal[0] & SFE_ENS160_STATUS_VALIDITY) >> 2;
+	frame->newData = (tempVal[0] & SFE_ENS160_STATUS_NEWDAT) != 0;
+	frame->valid = (frame->validity == SFE_ENS160_VALIDITY_NORMAL);
+
+	trackValidity(frame->validity, frame->timestamp);
+
+#if ENS160_FEATURE_SNAPSHOT
+	// After a reset or brownout the sensor is out of STANDARD and STATAS is clear
+	restoreIf(this->shadow.opMode == SFE_ENS160_STANDARD && (frame->status & SFE_ENS160_STATUS_STATAS) == 0);
+#endif
+
+	if( !frame->valid )
+	{
+		this->invalidFrames++;
+		if( this->validOnly )
+			return false;
+	}
+
+	// The sensor became valid since the last status-only read: fetch the data
+	if( length == 1 )
+	{
+		retVal = readRegisterRegion(SFE_ENS160_DATA_AQI, &tempVal[1], 5);
+
+		if( retVal != 0 )
+			return false;
+	}
+
+	frame->aqi = tempVal[1] & 0x07;
+	frame->tvoc = ens160DecodeLE16(&tempVal[2]);
+	frame->eco2 = ens160DecodeLE16(&tempVal[4]);
+
+	if( frame->valid )
+		this->validFrames++;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setValidOnly()
+//
+// Only deliver frames the sensor reports as valid from readFrame().
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  enable       Enables or disables valid-only mode. 
+
+void ENS160::setValidOnly(bool enable)
+{
+	this->validOnly = enable;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getValidFrameCount()
+//
+// Number of frames read with the validity flag in normal operation.
+
+uint32_t ENS160::getValidFrameCount()
+{
+	return this->validFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getInvalidFrameCount()
+//
+// Number of frames read during warm-up, initial start-up or with invalid output.
+// In valid-only mode these are the frames that were not delivered.
+
+uint32_t ENS160::getInvalidFrameCount()
+{
+	return this->invalidFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getTimeToValid()
+//
+// Estimates the time in ms until the sensor reports valid data, based on how 
+// long the current phase has been observed. Returns 0 when the data is valid
+// (or the phase should already be over) and ENS160_TIME_UNKNOWN if the output 
+// is invalid or no frame has been read yet. 
+
+uint32_t ENS160::getTimeToValid()
+{
+	uint32_t phase;
+	uint32_t elapsed;
+
+	switch( this->validityState )
+	{
+		case SFE_ENS160_VALIDITY_NORMAL:
+			return 0;
+		case SFE_ENS160_VALIDITY_WARM_UP:
+			phase = ENS160_WARM_UP_TIME_MS;
+			break;
+		case SFE_ENS160_VALIDITY_START_UP:
+			phase = ENS160_START_UP_TIME_MS;
+			break;
+		default:
+			return ENS160_TIME_UNKNOWN;
+	}
+
+	elapsed = to_ms_since_boot(get_absolute_time()) - this->validityStart;
+
+	if( elapsed >= phase )
+		return 0;
+
+	return phase - elapsed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// trackValidity()
+//
+// Remembers when the validity flag last changed so the remaining time in the
+// current phase can be estimated.
+
+void ENS160::trackValidity(uint8_t validity, uint32_t now)
+{
+	if( validity == this->validityState )
+		return;
+
+	this->validityState = validity;
+	this->validityStart = now;
+}
+
+#if ENS160_FEATURE_FIELDS
+//////////////////////////////////////////////////////////////////////////////
+// readFields()
+//
+// Reads any combination of register fields with the fewest transactions the
+// bus cost model allows. The plan is kept and reused while the same set of
+// fields is requested.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  fields       ENS160_FIELD_* mask of the values wanted
+//  result       receives the decoded values; result->fields lists those read
+//  retval       true if every read succeeded
+
+bool ENS160::readFields(uint16_t fields, ens160_fields_t *result)
+{
+	int32_t retVal;
+	uint8_t tempVal[ENS160_PLAN_MAX_BURST];
+	uint8_t i;
+
+	if( fields != this->plan.fields )
+		ens160PlanFields(fields, &this->busCost, &this->plan);
+
+	result->fields = 0;
+
+	for( i = 0; i < this->plan.count; i++ )
+	{
+		retVal = readRegisterRegion(this->plan.segments[i].reg, tempVal, this->plan.segments[i].length);
+
+		if( retVal != 0 )
+			return false;
+
+		ens160DecodeSegment(&this->plan, i, tempVal, result);
+	}
+
+#if ENS160_FEATURE_SNAPSHOT
+	if( result->fields & ENS160_FIELD_OP_MODE )
+		restoreIf(result->opMode != this->shadow.opMode);
+	else if( result->fields & ENS160_FIELD_STATUS )
+		restoreIf(this->shadow.opMode == SFE_ENS160_STANDARD && (result->status & SFE_ENS160_STATUS_STATAS) == 0);
+#endif
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setBusCost()
+//
+// Changes the cost model used by readFields() to decide when to span gaps.
+//
+//  Parameter        Description
+//  ---------        -----------------------------
+//  transactionCost  fixed cost of one register read
+//  byteCost         cost of each byte read, in the same unit
+
+void ENS160::setBusCost(uint16_t transactionCost, uint16_t byteCost)
+{
+	this->busCost.transactionCost = transactionCost;
+	this->busCost.byteCost = byteCost;
+	this->plan.fields = 0;
+}
+#endif
+
+#if ENS160_FEATURE_SNAPSHOT
+//////////////////////////////////////////////////////////////////////////////
+// readSnapshot()
+//
+// Reads OP_MODE through RH_IN in one burst. COMMAND, which sits in between,
+// is read and dropped.
+
+bool ENS160::readSnapshot(ens160_snapshot_t *snapshot)
+{
+	uint8_t tempVal[7];
+
+	if( readRegisterRegion(SFE_ENS160_OP_MODE, tempVal, 7) != 0 )
+		return false;
+
+	snapshot->opMode = tempVal[0];
+	snapshot->config = tempVal[1];
+	snapshot->tempIn = ens160DecodeLE16(&tempVal[3]);
+	snapshot->rhIn = ens160DecodeLE16(&tempVal[5]);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// writeSnapshot()
+//
+// Writes OP_MODE through RH_IN in one burst, with a NOP for COMMAND. The mode
+// lands first, and the sensor takes up CONFIG and the compensation values
+// that follow it before its first measurement.
+
+bool ENS160::writeSnapshot(const ens160_snapshot_t *snapshot)
+{
+	uint8_t tempVal[8];
+
+	tempVal[0] = SFE_ENS160_OP_MODE;
+	tempVal[1] = snapshot->opMode;
+	tempVal[2] = snapshot->config;
+	tempVal[3] = SFE_ENS160_COMMAND_NOP;
+	tempVal[4] = snapshot->tempIn & 0x00FF;
+	tempVal[5] = (snapshot->tempIn & 0xFF00) >> 8;
+	tempVal[6] = snapshot->rhIn & 0x00FF;
+	tempVal[7] = (snapshot->rhIn & 0xFF00) >> 8;
+
+	return writeRegisterRegion(tempVal, 8) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setAutoRestore()
+//
+// Starts from the configuration the sensor has now; from then on every write
+// through the driver keeps it current. readFrame() and readFields() write it
+// back as soon as they see the sensor has lost it, so sampling resumes after
+// a single burst.
+
+bool ENS160::setAutoRestore(bool enable)
+{
+	if( enable && !readSnapshot(&this->shadow) )
+		return false;
+
+	this->autoRestore = enable;
+
+	return true;
+}
+
+uint32_t ENS160::getRestoreCount()
+{
+	return this->restores;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// noteWrite()
+//
+// Copies the configuration bytes of a successful write into the shadow. A
+// RESET is not a mode to go back to and leaves the shadow's mode alone.
+
+void ENS160::noteWrite(const uint8_t *data, uint8_t length)
+{
+	uint8_t i;
+
+	for( i = 1; i < length; i++ )
+	{
+		switch( data[0] + i - 1 )
+		{
+			case SFE_ENS160_OP_MODE:
+				if( data[i] != SFE_ENS160_RESET )
+					this->shadow.opMode = data[i];
+				break;
+			case SFE_ENS160_CONFIG:
+				this->shadow.config = data[i];
+				break;
+			case SFE_ENS160_TEMP_IN:
+				this->shadow.tempIn = (this->shadow.tempIn & 0xFF00) | data[i];
+				break;
+			case SFE_ENS160_TEMP_IN + 1:
+				this->shadow.tempIn = (this->shadow.tempIn & 0x00FF) | (data[i] << 8);
+				break;
+			case SFE_ENS160_RH_IN:
+				this->shadow.rhIn = (this->shadow.rhIn & 0xFF00) | data[i];
+				break;
+			case SFE_ENS160_RH_IN + 1:
+				this->shadow.rhIn = (this->shadow.rhIn & 0x00FF) | (data[i] << 8);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// restoreIf()
+//
+// A suspected reset is confirmed before the configuration is rewritten, as
+// one corrupted status or mode byte looks just like one. OP_MODE is read back,
+// one byte, and only a mode other than the one last written is taken as the
+// sensor having lost its configuration, so an intact sensor costs one extra
+// read per suspicion and is otherwise left alone.
+
+void ENS160::restoreIf(bool suspected)
+{
+	uint8_t mode;
+
+	if( !this->autoRestore || !suspected )
+		return;
+
+	if( readRegisterRegion(SFE_ENS160_OP_MODE, &mode, 1) != 0 || mode == this->shadow.opMode )
+		return;
+
+	if( writeSnapshot(&this->shadow) )
+		this->restores++;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// readUniqueID()
+//
+// Reads PART_ID. On failure value is 0 and error says why.
+
+ens160_result<uint16_t> ENS160::readUniqueID()
+{
+	ens160_result<uint16_t> result;
+	uint8_t tempVal[2];
+
+	result.error = readRegisterRegion(SFE_ENS160_PART_ID, tempVal, 2);
+	result.value = result.ok() ? ens160DecodeLE16(tempVal) : 0;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readOperatingMode()
+//
+// Reads OP_MODE. On failure value is 0xFF and error says why.
+
+ens160_result<uint8_t> ENS160::readOperatingMode()
+{
+	ens160_result<uint8_t> result;
+	uint8_t tempVal = 0;
+
+	result.error = readRegisterRegion(SFE_ENS160_OP_MODE, &tempVal, 1);
+	result.value = result.ok() ? tempVal : 0xFF;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readStatus()
+//
+// Reads DEVICE_STATUS as it is. On failure value is 0 and error says why.
+
+ens160_result<uint8_t> ENS160::readStatus()
+{
+	ens160_result<uint8_t> result;
+	uint8_t tempVal = 0;
+
+	result.error = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+	result.value = result.ok() ? tempVal : 0;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readFlags()
+//
+// Reads the validity flag (0-3). On failure value is 0xFF and error says why.
+
+ens160_result<uint8_t> ENS160::readFlags()
+{
+	ens160_result<uint8_t> result;
+	uint8_t tempVal = 0;
+
+	result.error = readRegisterRegion(SFE_ENS160_DEVICE_STATUS, &tempVal, 1);
+	result.value = result.ok() ? (tempVal & SFE_ENS160_STATUS_VALIDITY) >> 2 : 0xFF;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readAQI()
+//
+// Reads the AQI-UBA index (1-5). On failure value is 0 and error says why.
+
+ens160_result<uint8_t> ENS160::readAQI()
+{
+	ens160_result<uint8_t> result;
+	uint8_t tempVal = 0;
+
+	result.error = readRegisterRegion(SFE_ENS160_DATA_AQI, &tempVal, 1);
+	result.value = result.ok() ? (tempVal & 0x07) : 0;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readTVOC()
+//
+// Reads TVOC in ppb. On failure value is 0 and error says why.
+
+ens160_result<uint16_t> ENS160::readTVOC()
+{
+	ens160_result<uint16_t> result;
+	uint8_t tempVal[2];
+
+	result.error = readRegisterRegion(SFE_ENS160_DATA_TVOC, tempVal, 2);
+	result.value = result.ok() ? ens160DecodeLE16(tempVal) : 0;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readETOH()
+//
+// Reads the ethanol concentration in ppb. On failure value is 0 and error says why.
+
+ens160_result<uint16_t> ENS160::readETOH()
+{
+	ens160_result<uint16_t> result;
+	uint8_t tempVal[2];
+
+	result.error = readRegisterRegion(SFE_ENS160_DATA_ETOH, tempVal, 2);
+	result.value = result.ok() ? ens160DecodeLE16(tempVal) : 0;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readECO2()
+//
+// Reads eCO2 in ppm. On failure value is 0 and error says why.
+
+ens160_result<uint16_t> ENS160::readECO2()
+{
+	ens160_result<uint16_t> result;
+	uint8_t tempVal[2];
+
+	result.error = readRegisterRegion(SFE_ENS160_DATA_ECO2, tempVal, 2);
+	result.value = result.ok() ? ens160DecodeLE16(tempVal) : 0;
+
+	return result;
+}
@@ -1,97 +1,335 @@
-#include "ens160_i2c_regs.h"
-#include "hardware/i2c.h"
-
-#define ENS160_ADDRESS_LOW 0x52
-#define ENS160_ADDRESS_HIGH 0x53
-
-#define ENS160_DEVICE_ID 0x0160
-
-class ENS160 {
-    public:
-        i2c_inst_t *i2cbus;
-        int i2c_address;
-        ENS160(i2c_inst_t *i2c_device_bus, int i2c_device_address);
-        bool ping(int address);
-
-        ///////////////////////////////////////////////////////////////////////
-        // init()
-        // Called to init the system. Connects to the device and sets it up for 
-        // operation
-
-        bool init();
-
-        ///////////////////////////////////////////////////////////////////////
-        // isConnected()
-        //  Parameter   Description
-        //  ---------   -----------------------------
-        //  retval      true if device is connected, false if not connected
-
-        bool isConnected(); // Checks if sensor ack's the I2C request
-                                                    
-        //////////////////////////////////////////////////////////////////////////////////
-        // writeRegisterRegion()
-        //  Parameter    Description
-        //  ---------    -----------------------------
-        //  reg          register to write to
-        //  data         Array to store data in
-        //  length       Length of the data being written in bytes 
-        //  retval       -1 = error, 0 = success
-
-        int32_t writeRegisterRegion(uint8_t *data, uint8_t length);
-        int32_t writeRegisterRegion(uint8_t reg, uint8_t data, uint8_t length);
-
-        //////////////////////////////////////////////////////////////////////////////////
-        // readRegisterRegion()
-        //  Parameter    Description
-        //  ---------    -----------------------------
-        //  reg          register to read from
-        //  data         Array to store data in
-        //  length       Length of the data to read in bytes
-        //  retval       -1 = error, 0 = success
-
-        int32_t readRegisterRegion(uint8_t reg, uint8_t *data, uint8_t length);
-
-        //////////////////////////////////////////////////////////////////////////////////
-        // General Operation
-        bool setOperatingMode(uint8_t);
-        int8_t getOperatingMode();
-        uint32_t getAppVer();
-        uint16_t getUniqueID();
-
-        //////////////////////////////////////////////////////////////////////////////////
-        // Interrupts
-        bool configureInterrupt(uint8_t);
-        bool enableInterrupt(bool enable = true);
-        bool setInterruptPolarity(bool activeHigh = true);
-        int8_t getInterruptPolarity();
-        bool setInterruptDrive(bool pushPull = true);
-        bool setDataInterrupt(bool enable = true);
-        bool setGPRInterrupt(bool);
-
-        //////////////////////////////////////////////////////////////////////////////////
-        // Temperature and Humidity compensation
-        bool setTempCompensation(float);
-        float getTempCompensation();
-        bool setTempCompensationCelsius(float);
-        float getTempCompensationCelsius();
-        bool setRHCompensation(uint16_t);
-        bool setRHCompensationFloat(float);
-            
-        //////////////////////////////////////////////////////////////////////////////////
-        bool checkDataStatus();
-        bool checkGPRStatus();
-        uint8_t getFlags();
-        bool checkOperationStatus();
-        bool getOperationError();
-
-        //////////////////////////////////////////////////////////////////////////////////
-        // Data registers
-        uint8_t getAQI();
-        uint16_t getTVOC();
-        uint16_t getETOH();
-        uint16_t getECO2();
-        float getTempKelvin();
-        float getTempCelsius();
-        float getRH();
-   
+#pragma once
+#include "ens160_i2c_regs.h"
+#include "ens160_planner.h"
+#include "hardware/i2c.h"
+
+// Feature groups, all built by default. Define one as 0 (e.g. with
+// target_compile_definitions) to leave its methods and state out of the driver
+// on targets where flash and RAM are short:
+//  FLOAT        float conversions and compensation setters taking float
+//  INTERRUPT    INTn pin configuration
+//  GPR          application version and general purpose read registers
+//  FIELDS       readFields() and its transaction plan
+//  RECOVERY     stuck-bus recovery through the SDA/SCL pins
+//  CALIBRATION  bus clock verification and calibration
+//  SNAPSHOT     configuration snapshot and restore after a sensor reset
+#ifndef ENS160_FEATURE_FLOAT
+#define ENS160_FEATURE_FLOAT 1
+#endif
+#ifndef ENS160_FEATURE_INTERRUPT
+#define ENS160_FEATURE_INTERRUPT 1
+#endif
+#ifndef ENS160_FEATURE_GPR
+#define ENS160_FEATURE_GPR 1
+#endif
+#ifndef ENS160_FEATURE_FIELDS
+#define ENS160_FEATURE_FIELDS 1
+#endif
+#ifndef ENS160_FEATURE_RECOVERY
+#define ENS160_FEATURE_RECOVERY 1
+#endif
+#ifndef ENS160_FEATURE_CALIBRATION
+#define ENS160_FEATURE_CALIBRATION 1
+#endif
+#ifndef ENS160_FEATURE_SNAPSHOT
+#define ENS160_FEATURE_SNAPSHOT 1
+#endif
+
+#define ENS160_ADDRESS_LOW 0x52
+#define ENS160_ADDRESS_HIGH 0x53
+
+#define ENS160_DEVICE_ID 0x0160
+
+// Nominal length of the warm-up and initial start-up phases, used to estimate
+// how long a sensor will keep reporting data that is not yet valid.
+#define ENS160_WARM_UP_TIME_MS  (3UL * 60UL * 1000UL)
+#define ENS160_START_UP_TIME_MS (60UL * 60UL * 1000UL)
+#define ENS160_TIME_UNKNOWN     0xFFFFFFFF
+
+// Default bus cost model for the planner, in bit times: a register read clocks
+// start, address, register, restart, address and stop (~30 bits) plus SDK call
+// overhead worth ~10 bits at 400 kHz; every data byte is 9 bits with its ACK.
+#define ENS160_DEFAULT_TRANSACTION_COST 40
+#define ENS160_DEFAULT_BYTE_COST        9
+
+// Error codes carried by ens160_result and returned by the register accessors
+#define ENS160_OK              0
+#define ENS160_ERR_NACK       -1 // address or data not acknowledged
+#define ENS160_ERR_TIMEOUT    -2 // transfer did not finish, bus may be stuck
+#define ENS160_ERR_SHORT      -3 // fewer bytes transferred than requested
+#define ENS160_ERR_RECOVERING -4 // bus recovery in progress, nothing was sent
+#define ENS160_ERR_NO_RESULT  -5 // a command did not set NEWGPR in time
+
+// Default retry budget: a failed transfer is retried after 100 us, then 200 us
+#define ENS160_DEFAULT_RETRIES    2
+#define ENS160_DEFAULT_BACKOFF_US 100
+
+// Consecutive failed operations that trigger bus recovery (timeouts trigger it at once)
+#define ENS160_RECOVER_AFTER 3
+
+// Transfer timeout: fixed part plus enough per byte for a 100 kHz bus
+#define ENS160_TIMEOUT_BASE_US     1000
+#define ENS160_TIMEOUT_PER_BYTE_US 100
+
+#define ENS160_PIN_NONE 0xFF
+
+// Commands run in IDLE mode; NEWGPR is polled this often until the result is in
+#define ENS160_COMMAND_POLL_MS    10
+#define ENS160_COMMAND_TIMEOUT_MS 500
+
+// Each candidate clock must pass this many PART_ID and MISR-checked data reads
+#define ENS160_CALIBRATION_READS 16
+
+// A register value, or the reason it could not be read
+template <typename T>
+struct ens160_result
+{
+	T value;
+	int32_t error;
+	bool ok() const { return error == ENS160_OK; }
+};
+
+// One sample: device status together with the data registers it describes,
+// read in a single burst from DEVICE_STATUS (0x20) through DATA_ECO2 (0x25).
+typedef struct
+{
+	uint32_t timestamp; // ms since boot when the frame was read
+	uint8_t status;     // raw DEVICE_STATUS
+	uint8_t validity;   // SFE_ENS160_VALIDITY_*
+	bool newData;       // NEWDAT was set when the frame was read
+	bool valid;         // validity is SFE_ENS160_VALIDITY_NORMAL
+	uint8_t aqi;
+	uint16_t tvoc;
+	uint16_t eco2;
+}	ens160_frame_t;
+
+// The sensor's writable configuration, OP_MODE (0x10) through RH_IN (0x16)
+// except COMMAND, which writeSnapshot() puts back in a single burst.
+typedef struct
+{
+	uint8_t opMode;     // SFE_ENS160_DEEP_SLEEP, _IDLE or _STANDARD
+	uint8_t config;     // raw CONFIG
+	uint16_t tempIn;    // Kelvin * 64
+	uint16_t rhIn;      // %RH * 512
+}	ens160_snapshot_t;
+
+class ENS160 {
+    public:
+        i2c_inst_t *i2cbus;
+        int i2c_address;
+        ENS160(i2c_inst_t *i2c_device_bus, int i2c_device_address);
+        bool ping(int address);
+
+        ///////////////////////////////////////////////////////////////////////
+        // init()
+        // Called to init the system. Connects to the device and sets it up for 
+        // operation
+
+        bool init();
+
+        ///////////////////////////////////////////////////////////////////////
+        // isConnected()
+        //  Parameter   Description
+        //  ---------   -----------------------------
+        //  retval      true if device is connected, false if not connected
+
+        bool isConnected(); // Checks if sensor ack's the I2C request
+                                                    
+        //////////////////////////////////////////////////////////////////////////////////
+        // writeRegisterRegion()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  reg          register to write to
+        //  data         Array to store data in
+        //  length       Length of the data being written in bytes 
+        //  retval       0 = success, ENS160_ERR_* on error
+
+        int32_t writeRegisterRegion(uint8_t *data, uint8_t length);
+        int32_t writeRegisterRegion(uint8_t reg, uint8_t data, uint8_t length);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // readRegisterRegion()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  reg          register to read from
+        //  data         Array to store data in
+        //  length       Length of the data to read in bytes
+        //  retval       0 = success, ENS160_ERR_* on error
+
+        int32_t readRegisterRegion(uint8_t reg, uint8_t *data, uint8_t length);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Error handling and bus recovery
+        void setRetryPolicy(uint8_t retries, uint16_t backoffUs);
+#if ENS160_FEATURE_RECOVERY
+        void setBusPins(uint8_t sda, uint8_t scl, uint32_t baudrate);
+#endif
+        bool serviceBus();
+        bool isRecovering();
+        uint32_t getBusErrorCount();
+        uint32_t getRecoveryCount();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Bus clock
+        uint32_t setBusSpeed(uint32_t baudrate);
+        uint32_t getBusSpeed();
+#if ENS160_FEATURE_CALIBRATION
+        uint32_t calibrateBusSpeed();
+        bool verifyBus(uint8_t reads);
+#endif
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Value-or-error reads
+        ens160_result<uint16_t> readUniqueID();
+        ens160_result<uint8_t> readOperatingMode();
+        ens160_result<uint8_t> readFlags();
+        ens160_result<uint8_t> readAQI();
+        ens160_result<uint16_t> readTVOC();
+        ens160_result<uint16_t> readETOH();
+        ens160_result<uint16_t> readECO2();
+        ens160_result<uint8_t> readStatus();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // General Operation
+        bool setOperatingMode(uint8_t);
+        int8_t getOperatingMode();
+#if ENS160_FEATURE_GPR
+        uint32_t getAppVer();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // writeCommand() / readGPR()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  command      SFE_ENS160_COMMAND_*, only run by the sensor in IDLE mode
+        //  gpr          8 bytes for GPR_READ0..7; reading them clears NEWGPR
+        //  retval       0 = success, ENS160_ERR_* on error
+
+        int32_t writeCommand(uint8_t command);
+        int32_t readGPR(uint8_t *gpr);
+#endif
+        uint16_t getUniqueID();
+
+#if ENS160_FEATURE_INTERRUPT
+        //////////////////////////////////////////////////////////////////////////////////
+        // Interrupts
+        bool configureInterrupt(uint8_t);
+        bool enableInterrupt(bool enable = true);
+        bool setInterruptPolarity(bool activeHigh = true);
+        int8_t getInterruptPolarity();
+        bool setInterruptDrive(bool pushPull = true);
+        bool setDataInterrupt(bool enable = true);
+        bool setGPRInterrupt(bool);
+#endif
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Temperature and Humidity compensation
+#if ENS160_FEATURE_FLOAT
+        bool setTempCompensation(float);
+        float getTempCompensation();
+        bool setTempCompensationCelsius(float);
+        float getTempCompensationCelsius();
+#endif
+        bool setRHCompensation(uint16_t);
+#if ENS160_FEATURE_FLOAT
+        bool setRHCompensationFloat(float);
+        bool setCompensation(float tempCelsius, float humidity);
+#endif
+            
+        //////////////////////////////////////////////////////////////////////////////////
+        bool checkDataStatus();
+#if ENS160_FEATURE_GPR
+        bool checkGPRStatus();
+#endif
+        uint8_t getFlags();
+        bool checkOperationStatus();
+        bool getOperationError();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Data registers
+        uint8_t getAQI();
+        uint16_t getTVOC();
+        uint16_t getETOH();
+        uint16_t getECO2();
+#if ENS160_FEATURE_FLOAT
+        float getTempKelvin();
+        float getTempCelsius();
+        float getRH();
+#endif
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Frame acquisition
+        bool readFrame(ens160_frame_t *frame);
+        void setValidOnly(bool enable = true);
+        uint32_t getValidFrameCount();
+        uint32_t getInvalidFrameCount();
+        uint32_t getTimeToValid();
+
+#if ENS160_FEATURE_FIELDS
+        //////////////////////////////////////////////////////////////////////////////////
+        // Coalesced field reads
+        //
+        // readFields() reads the ENS160_FIELD_* set in as few bursts as the
+        // bus cost model allows, discarding the registers between fields where
+        // one burst is cheaper. It never reads across reserved addresses, nor
+        // across DATA_AQI through DATA_ECO2 unless one of AQI, TVOC or ECO2 is
+        // requested, so asking for e.g. STATUS and DATA_T leaves NEWDAT set.
+        bool readFields(uint16_t fields, ens160_fields_t *result);
+        void setBusCost(uint16_t transactionCost, uint16_t byteCost);
+#endif
+
+#if ENS160_FEATURE_SNAPSHOT
+        //////////////////////////////////////////////////////////////////////////////////
+        // readSnapshot() / writeSnapshot()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  snapshot     configuration read from or written to the sensor, one burst each
+        //  retval       false on bus error
+
+        bool readSnapshot(ens160_snapshot_t *snapshot);
+        bool writeSnapshot(const ens160_snapshot_t *snapshot);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // setAutoRestore()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  enable       put the configuration back when a read shows the sensor has reset
+        //  retval       false if the configuration to restore could not be read
+
+        bool setAutoRestore(bool enable = true);
+        uint32_t getRestoreCount();
+#endif
+
+    private:
+        bool validOnly;
+        uint8_t validityState;
+        uint32_t validityStart;
+        uint32_t validFrames;
+        uint32_t invalidFrames;
+        void trackValidity(uint8_t validity, uint32_t now);
+#if ENS160_FEATURE_FIELDS
+        ens160_bus_cost_t busCost;
+        ens160_plan_t plan;
+#endif
+        uint8_t retries;
+        uint16_t backoffUs;
+        uint8_t failureStreak;
+        uint8_t recoveryState;
+#if ENS160_FEATURE_RECOVERY
+        uint8_t sdaPin;
+        uint8_t sclPin;
+#endif
+        uint32_t baudrate;
+        uint32_t busErrors;
+        uint32_t recoveries;
+#if ENS160_FEATURE_SNAPSHOT
+        ens160_snapshot_t shadow; // configuration as last written through the driver
+        bool autoRestore;
+        uint32_t restores;
+        void noteWrite(const uint8_t *data, uint8_t length);
+        void restoreIf(bool suspected);
+#endif
+        int32_t readOnce(uint8_t reg, uint8_t *data, uint8_t length);
+        int32_t writeOnce(const uint8_t *data, uint8_t length);
+        int32_t finishTransfer(int32_t retVal);
+
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////
+// Transaction planner
+//
+// Turns a set of requested register fields into the fewest register reads. 
+// Neighbouring fields are merged into one burst, and small gaps between them
+// are read and discarded when that is cheaper than starting another transaction
+// according to the bus cost model. Gaps over reserved addresses, or over
+// DATA_AQI through DATA_ECO2 when none of those is requested, are never read,
+// as that would clear NEWDAT and lose a sample no one asked for.
+
+// Fields that can be requested together
+#define ENS160_FIELD_PART_ID  0x0001
+#define ENS160_FIELD_OP_MODE  0x0002
+#define ENS160_FIELD_CONFIG   0x0004
+#define ENS160_FIELD_TEMP_IN  0x0008
+#define ENS160_FIELD_RH_IN    0x0010
+#define ENS160_FIELD_STATUS   0x0020
+#define ENS160_FIELD_AQI      0x0040
+#define ENS160_FIELD_TVOC     0x0080
+#define ENS160_FIELD_ECO2     0x0100
+#define ENS160_FIELD_DATA_T   0x0200
+#define ENS160_FIELD_DATA_RH  0x0400
+#define ENS160_FIELD_MISR     0x0800
+#define ENS160_FIELD_GPR_READ 0x1000
+#define ENS160_FIELD_COUNT    13
+
+#define ENS160_FIELD_FRAME    (ENS160_FIELD_STATUS | ENS160_FIELD_AQI | ENS160_FIELD_TVOC | ENS160_FIELD_ECO2)
+
+// Largest burst the planner can produce: PART_ID (0x00) through GPR_READ7 (0x4F)
+#define ENS160_PLAN_MAX_BURST 0x50
+
+// Cost of a register read, in any unit as long as both terms use the same one.
+// A read costs transactionCost plus byteCost for every byte clocked in, so a
+// gap is spanned when gap * byteCost <= transactionCost.
+typedef struct
+{
+	uint16_t transactionCost; // start, address, register, restart, address, stop and software overhead
+	uint16_t byteCost;        // one data byte
+}	ens160_bus_cost_t;
+
+typedef struct
+{
+	uint8_t reg;
+	uint8_t length;
+}	ens160_segment_t;
+
+typedef struct
+{
+	uint16_t fields;
+	uint8_t count;
+	ens160_segment_t segments[ENS160_FIELD_COUNT];
+	uint32_t cost;
+}	ens160_plan_t;
+
+// Decoded values; only the members named in fields are meaningful
+typedef struct
+{
+	uint16_t fields;
+	uint16_t partId;
+	uint8_t opMode;
+	uint8_t config;
+	uint16_t tempIn;
+	uint16_t rhIn;
+	uint8_t status;
+	uint8_t aqi;
+	uint16_t tvoc;
+	uint16_t eco2;
+	uint16_t dataT;
+	uint16_t dataRH;
+	uint8_t misr;
+	uint8_t gpr[8];
+}	ens160_fields_t;
+
+// A little-endian register pair, decoded where the read left it
+inline uint16_t ens160DecodeLE16(const uint8_t *data)
+{
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160PlanFields()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  fields       ENS160_FIELD_* mask of the values wanted
+//  cost         bus cost model used to decide whether to span gaps
+//  plan         receives the reads to perform, in register order
+
+void ens160PlanFields(uint16_t fields, const ens160_bus_cost_t *cost, ens160_plan_t *plan);
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160DecodeSegment()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  plan         plan the segment belongs to
+//  segment      index of the segment that was read
+//  data         bytes read for that segment
+//  result       receives every requested field contained in the segment
+
+void ens160DecodeSegment(const ens160_plan_t *plan, uint8_t segment, const uint8_t *data, ens160_fields_t *result);
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+//////////////////////////////////////////////////////////////////////////////////
+// SampleQueue
+//
+// Lock-free single-producer/single-consumer ring used to hand samples from the
+// acquisition core to the output core. Each index is only written by its own 
+// side, so plain atomic loads and stores are enough; the Cortex-M0+ has no 
+// atomic read-modify-write instructions. When the ring is full the newest
+// sample is dropped and counted rather than blocking the producer.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  T            Sample type, copied into the ring.
+//  N            Number of slots, must be a power of two.
+
+template <typename T, uint32_t N>
+class SampleQueue {
+    static_assert((N & (N - 1)) == 0, "SampleQueue size must be a power of two");
+
+    public:
+        SampleQueue() : head(0), tail(0), dropped(0) {}
+
+        // Producer side
+        bool push(const T &item)
+        {
+            uint32_t h = head.load(std::memory_order_relaxed);
+
+            if( h - tail.load(std::memory_order_acquire) == N )
+            {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            slots[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool pop(T *item)
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+
+            if( t == head.load(std::memory_order_acquire) )
+                return false;
+
+            *item = slots[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        uint32_t getDropped()
+        {
+            return dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        T slots[N];
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> dropped;
+};
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "i2c_sim.h"
+#include "ens160_i2c.h"
+#include "ens160_async.h"
+
+// Sensors spread over two simulated buses. The simulator does not limit them
+// to the two addresses the part supports, which stands in for a bus mux.
+#define DEMO_SENSORS    24
+#define DEMO_BUSES      2
+#define DEMO_RUN_MS     (5UL * 60UL * 1000UL)
+#define DEMO_REPORT_MS  (60UL * 1000UL)
+
+typedef struct
+{
+	uint32_t frames;
+	uint32_t timeouts;
+	uint32_t lastEco2;
+}	demo_stats_t;
+
+static ENS160Sim devices[DEMO_SENSORS];
+static demo_stats_t stats[DEMO_SENSORS];
+
+static ENS160Task sensorTask(ENS160AsyncSensor *sensor, demo_stats_t *stat, uint64_t end)
+{
+	ens160_frame_t frame;
+
+	sensor->getSensor()->setOperatingMode(SFE_ENS160_STANDARD);
+	sensor->getSensor()->setValidOnly();
+
+	while( time_us_64() < end )
+	{
+		if( !co_await sensor->waitDataReady() )
+		{
+			stat->timeouts++;
+			continue;
+		}
+
+		if( co_await sensor->readFrame(&frame) && frame.valid && frame.newData )
+		{
+			stat->frames++;
+			stat->lastEco2 = frame.eco2;
+		}
+	}
+}
+
+static ENS160Task reportTask(ENS160Executor *executor, uint64_t end)
+{
+	uint32_t frames;
+	uint8_t i;
+
+	while( time_us_64() < end )
+	{
+		co_await executor->sleep(DEMO_REPORT_MS);
+
+		frames = 0;
+		for( i = 0; i < DEMO_SENSORS; i++ )
+			frames += stats[i].frames;
+
+		printf("t=%4lus frames=%lu pending=%lu\n", (unsigned long)(time_us_64() / 1000000), 
+			(unsigned long)frames, (unsigned long)executor->getPendingCount());
+	}
+}
+
+int main()
+{
+	static ENS160 *sensors[DEMO_SENSORS];
+	static ENS160AsyncSensor *asyncSensors[DEMO_SENSORS];
+	ENS160Executor executor;
+	ens160_sim_config_t config;
+	i2c_inst_t *bus;
+	uint64_t end;
+	uint8_t i;
+
+	for( i = 0; i < DEMO_BUSES; i++ )
+		i2c_init(i2c_get_instance(i), 400 * 1000);
+
+	end = time_us_64() + DEMO_RUN_MS * 1000ULL;
+
+	for( i = 0; i < DEMO_SENSORS; i++ )
+	{
+		bus = i2c_get_instance(i % DEMO_BUSES);
+
+		config.periodUs = ENS160_SIM_PERIOD_US;
+		config.phaseUs = i * 37 * 1000;
+		config.warmUpUs = 5 * 1000000;
+		config.startUpUs = 0;
+		config.seed = i + 1;
+		devices[i].configure(&config);
+		i2c_sim_attach(bus, ENS160_ADDRESS_LOW + i / DEMO_BUSES, &devices[i]);
+
+		sensors[i] = new ENS160(bus, ENS160_ADDRESS_LOW + i / DEMO_BUSES);
+		if( !sensors[i]->init() )
+		{
+			printf("sensor %u did not answer\n", i);
+			return 1;
+		}
+
+		asyncSensors[i] = new ENS160AsyncSensor(&executor, sensors[i]);
+		sensorTask(asyncSensors[i], &stats[i], end);
+	}
+
+	reportTask(&executor, end);
+	executor.run();
+
+	for( i = 0; i < DEMO_SENSORS; i++ )
+		printf("sensor %2u: %lu frames, %lu timeouts, last eCO2 %lu ppm\n", i, (unsigned long)stats[i].frames, 
+			(unsigned long)stats[i].timeouts, (unsigned long)stats[i].lastEco2);
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "pico/stdlib.h"
+#include "i2c_sim.h"
+#include "ens160_i2c.h"
+#include "ens160_format.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Driver benchmarks
+//
+// Times the driver's hot paths against a simulated sensor and counts the bus
+// traffic each one causes. Host time per operation covers the driver and the
+// in-memory bus only; bus time is what the transfers would take on the wire at
+// the chosen clock. One JSON object per benchmark is printed on its own line.
+//
+//  ens160_bench [iterations] [baudrate]
+
+#define BENCH_ITERATIONS 100000
+#define BENCH_BAUDRATE   (400 * 1000)
+
+typedef struct
+{
+	const char *name;
+	bool warmingUp;                 // sensor still reports warm-up
+	void (*setup)(ENS160 *sensor);
+	bool (*run)(ENS160 *sensor);
+}	bench_case_t;
+
+static ENS160Sim device;
+
+static bool benchInit(ENS160 *sensor)
+{
+	ENS160 fresh(sensor->i2cbus, sensor->i2c_address);
+
+	return fresh.init();
+}
+
+static bool benchStatus(ENS160 *sensor)
+{
+	sensor->checkDataStatus();
+	return true;
+}
+
+static bool benchFrame(ENS160 *sensor)
+{
+	ens160_frame_t frame;
+
+	return sensor->readFrame(&frame);
+}
+
+static void setupGated(ENS160 *sensor)
+{
+	sensor->setValidOnly();
+}
+
+static bool benchFrameGated(ENS160 *sensor)
+{
+	ens160_frame_t frame;
+
+	sensor->readFrame(&frame);
+	return !frame.valid;
+}
+
+static bool benchFields(ENS160 *sensor)
+{
+	ens160_fields_t result;
+
+	return sensor->readFields(ENS160_FIELD_FRAME | ENS160_FIELD_DATA_T | ENS160_FIELD_DATA_RH, &result);
+}
+
+static bool benchCompensation(ENS160 *sensor)
+{
+	return sensor->setCompensation(23.5f, 41.0f);
+}
+
+static bool benchCompensationSeparate(ENS160 *sensor)
+{
+	// setRHCompensationFloat() reports success as false
+	return sensor->setTempCompensationCelsius(23.5f) && !sensor->setRHCompensationFloat(41.0f);
+}
+
+// A sample's CSV line and compensation values as the examples print them,
+// through printf and through ens160_format.h; no bus traffic is involved
+static ens160_frame_t formatFrame = { 0 };
+static ens160_fields_t formatFields = { 0 };
+static char formatLine[128];
+
+static bool benchFormatPrintf(ENS160 *sensor)
+{
+	formatFrame.eco2++;
+
+	return snprintf(formatLine, sizeof(formatLine), "%u,%u,%u,%u,%f,%f\r\n", formatFrame.validity, formatFrame.aqi,
+		formatFrame.tvoc, formatFrame.eco2, formatFields.dataT / 64.0f - 273.15f, formatFields.dataRH / 512.0f) > 0;
+}
+
+static bool benchFormatFixed(ENS160 *sensor)
+{
+	char *end = formatLine;
+
+	formatFrame.eco2++;
+	end += ens160FormatUnsigned(end, formatFrame.validity, 0);
+	*end++ = ',';
+	end += ens160FormatUnsigned(end, formatFrame.aqi, 0);
+	*end++ = ',';
+	end += ens160FormatUnsigned(end, formatFrame.tvoc, 0);
+	*end++ = ',';
+	end += ens160FormatUnsigned(end, formatFrame.eco2, 0);
+	*end++ = ',';
+	end += ens160FormatFixed(end, ens160CentiCelsius(formatFields.dataT), 2, 0);
+	*end++ = ',';
+	end += ens160FormatFixed(end, ens160CentiPercent(formatFields.dataRH), 2, 0);
+	*end++ = '\r';
+	*end++ = '\n';
+	*end = 0;
+
+	return true;
+}
+
+static void setupFormat(ENS160 *sensor)
+{
+	sensor->readFrame(&formatFrame);
+	sensor->readFields(ENS160_FIELD_DATA_T | ENS160_FIELD_DATA_RH, &formatFields);
+}
+
+static const bench_case_t cases[] = {
+	{ "init",                  false, 0,          benchInit },
+	{ "status_check",          false, 0,          benchStatus },
+	{ "read_frame",            false, 0,          benchFrame },
+	{ "read_frame_gated",      true,  setupGated, benchFrameGated },
+	{ "read_fields",           false, 0,          benchFields },
+	{ "compensation_burst",    false, 0,          benchCompensation },
+	{ "compensation_separate", false, 0,          benchCompensationSeparate },
+	{ "format_printf",         false, setupFormat, benchFormatPrintf },
+	{ "format_fixed",          false, setupFormat, benchFormatFixed },
+};
+
+static void runCase(const bench_case_t *bench, i2c_inst_t *bus, uint32_t iterations, uint baudrate)
+{
+	ens160_sim_config_t config;
+	i2c_sim_stats_t stats;
+	uint32_t failures = 0;
+	uint32_t i;
+
+	config.periodUs = ENS160_SIM_PERIOD_US;
+	config.phaseUs = 0;
+	config.warmUpUs = bench->warmingUp ? ~0ULL >> 1 : 0;
+	config.startUpUs = 0;
+	config.seed = 1;
+	device.configure(&config);
+	i2c_sim_attach(bus, ENS160_ADDRESS_HIGH, &device);
+
+	ENS160 sensor(bus, ENS160_ADDRESS_HIGH);
+	sensor.setOperatingMode(SFE_ENS160_STANDARD);
+	sleep_ms(1500);
+	if( bench->setup )
+		bench->setup(&sensor);
+
+	i2c_sim_reset_stats(bus);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for( i = 0; i < iterations; i++ )
+	{
+		if( !bench->run(&sensor) )
+			failures++;
+	}
+
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+	i2c_sim_get_stats(bus, &stats);
+
+	printf("{\"benchmark\":\"%s\",\"iterations\":%lu,\"baudrate\":%u,\"ns_per_op\":%.1f,"
+		"\"transactions_per_op\":%.2f,\"bus_bytes_per_op\":%.2f,\"bus_us_per_op\":%.2f,\"failures\":%lu}\n",
+		bench->name, (unsigned long)iterations, baudrate,
+		std::chrono::duration<double, std::nano>(stop - start).count() / iterations,
+		(double)stats.transactions / iterations, (double)stats.bytes / iterations,
+		(double)stats.busTimeUs / iterations, (unsigned long)failures);
+}
+
+int main(int argc, char **argv)
+{
+	i2c_inst_t *bus = i2c_get_instance(0);
+	uint32_t iterations = BENCH_ITERATIONS;
+	uint baudrate = BENCH_BAUDRATE;
+	size_t i;
+
+	if( argc > 1 )
+		iterations = strtoul(argv[1], 0, 0);
+	if( argc > 2 )
+		baudrate = strtoul(argv[2], 0, 0);
+	if( iterations == 0 )
+		iterations = 1;
+
+	i2c_init(bus, baudrate);
+
+	for( i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+		runCase(&cases[i], bus, iterations, baudrate);
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <thread>
+#include "mbed.h"
+#include "rtos.h"
+#include "ens160_bus_arbiter.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Bus arbiter stress test
+//
+// Runs the mbed library's ENS160BusArbiter on host threads against a fake bus
+// (mbed/mbed.h). Four threads read another device's data registers, one
+// writes its configuration and runs a pin-driving step now and then, and one
+// drives an ENS160 driver attached to the arbiter, with a mode write between
+// frame reads. The fake bus counts transfers that one thread began while
+// another held the bus; there must be none. It also counts the transfers each
+// call carried out on its thread, which one batch bounds: a thread that served
+// the queue until it was empty would carry out the others' requests, and be
+// kept from returning, for as long as they kept the queue busy. One JSON
+// object is printed; build with -fsanitize=thread to check the arbiter for
+// data races as well.
+//
+//  ens160_bus_stress [requests per thread]
+
+#define STRESS_REQUESTS 20000
+#define STRESS_READERS  4
+#define STRESS_THREADS  (STRESS_READERS + 2)
+#define STRESS_DEVICE   0x40
+
+// The pin-driving step runs every this many configuration writes
+#define STRESS_RUN_EVERY 64
+
+typedef struct
+{
+	uint32_t requests;
+	uint32_t failed;
+	uint32_t worstTransfers; // carried out on this thread by one call
+	uint64_t worstUs;
+}	stress_result_t;
+
+static ENS160 sensor(p9, p10, 0x52);
+static ENS160BusArbiter arbiter;
+static stress_result_t results[STRESS_THREADS];
+static uint32_t perThread = STRESS_REQUESTS;
+
+static uint64_t monotonicUs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int32_t holdPins(void *context)
+{
+	(void)context;
+	wait_us(20);
+
+	return ENS160_OK;
+}
+
+static void timed(stress_result_t *result, int32_t error, uint64_t start, uint32_t transfers)
+{
+	uint64_t waited = monotonicUs() - start;
+
+	transfers = I2C::getThreadTransferCount() - transfers;
+	if( transfers > result->worstTransfers )
+		result->worstTransfers = transfers;
+	result->requests++;
+	if( error != ENS160_OK )
+		result->failed++;
+	if( waited > result->worstUs )
+		result->worstUs = waited;
+}
+
+static void reader(stress_result_t *result)
+{
+	char reg = 0x02;
+	char data[6];
+	ens160_bus_request_t request = { &sensor.i2c, STRESS_DEVICE << 1, ENS160_BUS_PRIORITY_DATA,
+		&reg, 1, data, sizeof(data), 0, 0 };
+	uint64_t start;
+	uint32_t transfers;
+	uint32_t i;
+
+	for( i = 0; i < perThread; i++ )
+	{
+		start = monotonicUs();
+		transfers = I2C::getThreadTransferCount();
+		timed(result, arbiter.transfer(&request), start, transfers);
+	}
+}
+
+static void configurer(stress_result_t *result)
+{
+	char config[3] = { 0x10, 0x00, 0x00 };
+	ens160_bus_request_t write = { &sensor.i2c, STRESS_DEVICE << 1, ENS160_BUS_PRIORITY_CONFIG,
+		config, sizeof(config), 0, 0, 0, 0 };
+	ens160_bus_request_t run = { &sensor.i2c, STRESS_DEVICE << 1, ENS160_BUS_PRIORITY_CONFIG,
+		0, 0, 0, 0, holdPins, 0 };
+	uint64_t start;
+	uint32_t transfers;
+	uint32_t i;
+
+	for( i = 0; i < perThread; i++ )
+	{
+		start = monotonicUs();
+		transfers = I2C::getThreadTransferCount();
+		timed(result, arbiter.transfer(i % STRESS_RUN_EVERY ? &write : &run), start, transfers);
+	}
+}
+
+static void driver(stress_result_t *result)
+{
+	ens160_frame_t frame;
+	uint64_t start;
+	uint32_t transfers;
+	uint32_t i;
+
+	for( i = 0; i < perThread; i++ )
+	{
+		start = monotonicUs();
+		transfers = I2C::getThreadTransferCount();
+		if( i % 8 )
+			timed(result, sensor.readFrame(&frame) ? ENS160_OK : ENS160_ERR_NACK, start, transfers);
+		else
+			timed(result, sensor.setOperatingMode(SFE_ENS160_STANDARD) ? ENS160_OK : ENS160_ERR_NACK, start, transfers);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::thread threads[STRESS_THREADS];
+	uint32_t requests = 0;
+	uint32_t failed = 0;
+	uint32_t worstTransfers = 0;
+	uint64_t worstUs = 0;
+	uint64_t dataWorstUs = 0;
+	uint64_t start;
+	uint64_t elapsed;
+	int i;
+
+	if( argc > 1 )
+		perThread = strtoul(argv[1], 0, 0);
+
+	arbiter.attach(&sensor);
+
+	start = monotonicUs();
+	for( i = 0; i < STRESS_READERS; i++ )
+		threads[i] = std::thread(reader, &results[i]);
+	threads[STRESS_READERS] = std::thread(configurer, &results[STRESS_READERS]);
+	threads[STRESS_READERS + 1] = std::thread(driver, &results[STRESS_READERS + 1]);
+	for( i = 0; i < STRESS_THREADS; i++ )
+		threads[i].join();
+	elapsed = monotonicUs() - start;
+
+	for( i = 0; i < STRESS_THREADS; i++ )
+	{
+		requests += results[i].requests;
+		failed += results[i].failed;
+		if( results[i].worstTransfers > worstTransfers )
+			worstTransfers = results[i].worstTransfers;
+		if( results[i].worstUs > worstUs )
+			worstUs = results[i].worstUs;
+		if( i < STRESS_READERS && results[i].worstUs > dataWorstUs )
+			dataWorstUs = results[i].worstUs;
+	}
+
+	printf("{\"threads\":%d,\"calls\":%lu,\"requests\":%lu,\"sessions\":%lu,\"transfers\":%lu,\"starts\":%lu,"
+		"\"overlaps\":%lu,\"failed\":%lu,\"worst_call_transfers\":%lu,\"worst_wait_us\":%llu,\"data_worst_us\":%llu,\"config_worst_us\":%llu,"
+		"\"driver_worst_us\":%llu,\"elapsed_ms\":%llu}\n",
+		STRESS_THREADS, (unsigned long)requests, (unsigned long)arbiter.getRequestCount(),
+		(unsigned long)arbiter.getSessionCount(), (unsigned long)sensor.i2c.getTransferCount(),
+		(unsigned long)sensor.i2c.getStartCount(), (unsigned long)sensor.i2c.getOverlapCount(),
+		(unsigned long)failed, (unsigned long)worstTransfers, (unsigned long long)worstUs, (unsigned long long)dataWorstUs,
+		(unsigned long long)results[STRESS_READERS].worstUs, (unsigned long long)results[STRESS_READERS + 1].worstUs,
+		(unsigned long long)(elapsed / 1000));
+
+	return sensor.i2c.getOverlapCount() == 0 && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "i2c_sim.h"
+#include "ens160_i2c.h"
+#include "ens160_poll.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Fault recovery benchmark
+//
+// Runs the examples' polling loop against a simulated sensor while a schedule
+// of bus faults plays on its bus, one fault type at a time. A fault counts as
+// recovered at the first read after it that delivers new data; the time until
+// then is its recovery time, and the sensor results that went by unread are
+// its lost samples. The driver's auto-restore puts a sensor that has dropped
+// out of STANDARD mode after a device reset back into it with its
+// configuration; the sensor's warm-up is not simulated. Schedules are
+// generated from the seed, so a run replays exactly, or read from a script
+// with one fault per line in the format of i2c_sim_parse_fault(). One JSON
+// object per schedule is printed on its own line.
+//
+//  ens160_fault_bench [seed] [faults per type] [retries] [backoff us]
+//  ens160_fault_bench -f script [retries] [backoff us]
+
+#define BENCH_SEED       1
+#define BENCH_FAULTS     20
+#define BENCH_MAX_FAULTS 1024
+#define BENCH_BAUDRATE   (400 * 1000)
+#define BENCH_SDA_PIN    4
+#define BENCH_SCL_PIN    5
+
+// Transactions between generated faults, enough for any of them to recover
+#define BENCH_SPACING 400
+
+// A schedule that has not recovered after this much sensor time is abandoned
+#define BENCH_LIMIT_US (24ULL * 60ULL * 60ULL * 1000000ULL)
+
+typedef struct
+{
+	uint32_t fired;
+	uint32_t recovered;
+	uint32_t overlapped;    // faults that fired while an earlier one was still being recovered from
+	uint64_t recoveryUs;
+	uint64_t worstUs;
+	uint32_t lost;
+}	bench_result_t;
+
+static ENS160Sim device;
+static i2c_sim_fault_t faults[BENCH_MAX_FAULTS];
+
+static uint32_t nextRandom(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// generate()
+//
+// A schedule of one fault type with its repeat counts and parameters spread
+// around the driver's defaults: runs of NACKs both shorter and longer than
+// the retry budget, stretches both within and past the transfer timeout, and
+// SDA held for more SCL pulses than one recovery gives.
+
+static size_t generate(uint8_t type, size_t count, uint32_t *random)
+{
+	uint64_t at = BENCH_SPACING;
+	size_t i;
+
+	for( i = 0; i < count; i++ )
+	{
+		faults[i].at = at;
+		faults[i].type = type;
+		faults[i].repeat = 1;
+		faults[i].param = 0;
+
+		switch( type )
+		{
+			case I2C_SIM_FAULT_NACK_ADDRESS:
+				faults[i].repeat = (uint16_t)(1 + nextRandom(random) % 6);
+				break;
+			case I2C_SIM_FAULT_NACK_DATA:
+				faults[i].repeat = (uint16_t)(1 + nextRandom(random) % 4);
+				faults[i].param = nextRandom(random) % 6;
+				break;
+			case I2C_SIM_FAULT_STRETCH:
+				faults[i].repeat = (uint16_t)(1 + nextRandom(random) % 4);
+				faults[i].param = 100 + nextRandom(random) % 2900;
+				break;
+			case I2C_SIM_FAULT_STUCK_SDA:
+				faults[i].param = 1 + nextRandom(random) % 16;
+				break;
+			case I2C_SIM_FAULT_BIT_FLIP:
+				faults[i].param = nextRandom(random) % 48;
+				break;
+			default:
+				break;
+		}
+
+		at += BENCH_SPACING + nextRandom(random) % BENCH_SPACING;
+	}
+
+	return count;
+}
+
+static int compareFaults(const void *a, const void *b)
+{
+	uint64_t left = ((const i2c_sim_fault_t *)a)->at;
+	uint64_t right = ((const i2c_sim_fault_t *)b)->at;
+
+	return left < right ? -1 : left > right;
+}
+
+static size_t loadScript(const char *path)
+{
+	char line[128];
+	size_t count = 0;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if( file == 0 )
+		return 0;
+
+	while( count < BENCH_MAX_FAULTS && fgets(line, sizeof(line), file) )
+	{
+		if( i2c_sim_parse_fault(line, &faults[count]) )
+			count++;
+	}
+
+	fclose(file);
+	qsort(faults, count, sizeof(faults[0]), compareFaults);
+
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// run()
+//
+// Polls with the predictive scheduler until every fault has fired and been
+// recovered from. A failed read counts as a poll without new data, so the
+// scheduler retries densely and widens the search as the outage goes on.
+
+static void run(const char *name, size_t count, uint8_t retries, uint16_t backoffUs, uint32_t seed)
+{
+	i2c_inst_t *bus = i2c_get_instance(0);
+	ens160_sim_config_t config;
+	i2c_sim_stats_t stats;
+	bench_result_t result;
+	ENS160PollScheduler scheduler;
+	ens160_frame_t frame;
+	uint64_t start, now, readUs, next, faultUs = 0, lastSampleUs = 0, gap;
+	uint64_t seen = 0;
+	bool pending = false;
+	bool ok;
+
+	memset(&result, 0, sizeof(result));
+
+	config.periodUs = ENS160_SIM_PERIOD_US;
+	config.phaseUs = 0;
+	config.warmUpUs = 0;
+	config.startUpUs = 0;
+	config.seed = seed;
+	device.configure(&config);
+	i2c_sim_set_faults(bus, 0, 0);
+	i2c_sim_attach(bus, ENS160_ADDRESS_HIGH, &device);
+	i2c_sim_set_pins(bus, BENCH_SDA_PIN, BENCH_SCL_PIN);
+
+	ENS160 sensor(bus, ENS160_ADDRESS_HIGH);
+	sensor.setBusPins(BENCH_SDA_PIN, BENCH_SCL_PIN, BENCH_BAUDRATE);
+	sensor.setRetryPolicy(retries, backoffUs);
+	sensor.setOperatingMode(SFE_ENS160_STANDARD);
+	sensor.setAutoRestore();
+
+	i2c_sim_reset_stats(bus);
+	i2c_sim_set_faults(bus, faults, count);
+	start = time_us_64();
+
+	while( (seen < count || pending) && time_us_64() - start < BENCH_LIMIT_US )
+	{
+		ok = sensor.readFrame(&frame);
+		readUs = time_us_64();
+
+		i2c_sim_get_stats(bus, &stats);
+		if( stats.faults != seen )
+		{
+			result.fired += (uint32_t)(stats.faults - seen);
+			if( pending )
+				result.overlapped += (uint32_t)(stats.faults - seen);
+			else
+			{
+				result.overlapped += (uint32_t)(stats.faults - seen - 1);
+				faultUs = stats.lastFaultUs;
+				pending = true;
+			}
+			seen = stats.faults;
+		}
+
+		if( ok && frame.newData )
+		{
+			if( pending && lastSampleUs )
+			{
+				result.recovered++;
+				result.recoveryUs += readUs - faultUs;
+				if( readUs - faultUs > result.worstUs )
+					result.worstUs = readUs - faultUs;
+
+				gap = (readUs - lastSampleUs + ENS160_SIM_PERIOD_US / 2) / ENS160_SIM_PERIOD_US;
+				if( gap > 1 )
+					result.lost += (uint32_t)(gap - 1);
+			}
+			pending = false;
+			lastSampleUs = readUs;
+		}
+
+		scheduler.observe(ok && frame.newData, readUs);
+		next = scheduler.getNextPoll();
+		now = time_us_64();
+		if( next > now )
+			sleep_us(next - now);
+	}
+
+	i2c_sim_get_stats(bus, &stats);
+
+	printf("{\"faults\":\"%s\",\"retries\":%u,\"backoff_us\":%u,\"fired\":%lu,\"recovered\":%lu,\"overlapped\":%lu,"
+		"\"recovery_ms_mean\":%.2f,\"recovery_ms_max\":%.2f,\"lost_samples\":%lu,\"restarts\":%lu,"
+		"\"bus_errors\":%lu,\"bus_recoveries\":%lu,\"nacks\":%llu,\"timeouts\":%llu,\"polls\":%lu}\n",
+		name, retries, backoffUs, (unsigned long)result.fired, (unsigned long)result.recovered,
+		(unsigned long)result.overlapped,
+		result.recovered ? (double)result.recoveryUs / result.recovered / 1000.0 : 0.0,
+		(double)result.worstUs / 1000.0, (unsigned long)result.lost, (unsigned long)sensor.getRestoreCount(),
+		(unsigned long)sensor.getBusErrorCount(), (unsigned long)sensor.getRecoveryCount(),
+		(unsigned long long)stats.nacks, (unsigned long long)stats.timeouts,
+		(unsigned long)scheduler.getPollCount());
+
+	i2c_sim_set_faults(bus, 0, 0);
+	i2c_sim_detach(bus, ENS160_ADDRESS_HIGH);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seed = BENCH_SEED;
+	uint32_t random;
+	size_t perType = BENCH_FAULTS;
+	uint8_t retries = ENS160_DEFAULT_RETRIES;
+	uint16_t backoffUs = ENS160_DEFAULT_BACKOFF_US;
+	const char *script = 0;
+	size_t count;
+	uint8_t type;
+	int arg = 1;
+
+	i2c_init(i2c_get_instance(0), BENCH_BAUDRATE);
+
+	if( argc > 2 && strcmp(argv[1], "-f") == 0 )
+	{
+		script = argv[2];
+		arg = 3;
+	}
+	else
+	{
+		if( argc > 1 )
+			seed = strtoul(argv[1], 0, 0);
+		if( argc > 2 )
+			perType = strtoul(argv[2], 0, 0);
+		arg = 3;
+	}
+
+	if( argc > arg )
+		retries = (uint8_t)strtoul(argv[arg], 0, 0);
+	if( argc > arg + 1 )
+		backoffUs = (uint16_t)strtoul(argv[arg + 1], 0, 0);
+
+	if( script )
+	{
+		count = loadScript(script);
+		if( count == 0 )
+		{
+			fprintf(stderr, "no faults in %s\n", script);
+			return 1;
+		}
+
+		run("script", count, retries, backoffUs, seed);
+		return 0;
+	}
+
+	if( perType > BENCH_MAX_FAULTS )
+		perType = BENCH_MAX_FAULTS;
+	if( seed == 0 )
+		seed = 1;
+
+	for( type = 0; type < I2C_SIM_FAULT_TYPES; type++ )
+	{
+		random = seed + type;
+		count = generate(type, perType, &random);
+		run(i2c_sim_fault_name(type), count, retries, backoffUs, seed);
+	}
+
+	return 0;
+}
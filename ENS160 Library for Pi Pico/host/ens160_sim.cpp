@@ -0,0 +1,329 @@
+#include <string.h>
+#include "ens160_sim.h"
+#include "ens160_i2c_regs.h"
+
+// Registers whose reads clear NEWDAT and are folded into DATA_MISR
+#define SIM_DATA_FIRST SFE_ENS160_DATA_AQI
+#define SIM_DATA_LAST  0x37
+
+// Register file size; reads beyond it return 0xFF like an unimplemented address
+#define SIM_REGISTERS 0x50
+
+static uint8_t misrUpdate(uint8_t misr, uint8_t data)
+{
+	uint8_t misrXor = (uint8_t)((misr << 1) ^ data);
+
+	if( (misr & 0x80) == 0 )
+		return misrXor;
+
+	return misrXor ^ POLY;
+}
+
+ENS160Sim::ENS160Sim()
+{
+	this->config.periodUs = ENS160_SIM_PERIOD_US;
+	this->config.phaseUs = 0;
+	this->config.warmUpUs = ENS160_SIM_WARM_UP_US;
+	this->config.startUpUs = ENS160_SIM_START_UP_US;
+	this->config.seed = 1;
+	powerOn(0);
+}
+
+void ENS160Sim::configure(const ens160_sim_config_t *config)
+{
+	this->config = *config;
+	if( this->config.periodUs == 0 )
+		this->config.periodUs = ENS160_SIM_PERIOD_US;
+	this->signal = this->config.seed ? this->config.seed : 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// powerOn()
+//
+// Puts the model in its reset state: DEEP_SLEEP, compensation at 25 C/50 %rH,
+// no result available. Also used for the RESET operating mode.
+
+void ENS160Sim::powerOn(uint64_t now)
+{
+	memset(this->regs, 0, sizeof(this->regs));
+	this->regs[SFE_ENS160_PART_ID] = 0x60;
+	this->regs[SFE_ENS160_PART_ID + 1] = 0x01;
+	this->regs[SFE_ENS160_TEMP_IN] = (uint8_t)(298 * 64);
+	this->regs[SFE_ENS160_TEMP_IN + 1] = (uint8_t)((298 * 64) >> 8);
+	this->regs[SFE_ENS160_RH_IN] = (uint8_t)(50 * 512);
+	this->regs[SFE_ENS160_RH_IN + 1] = (uint8_t)((50 * 512) >> 8);
+	this->pointer = 0;
+	this->opMode = SFE_ENS160_DEEP_SLEEP;
+	this->status = 0;
+	this->now = now;
+	this->standardSince = now;
+	this->nextResult = 0;
+	this->results = 0;
+	this->signal = this->config.seed ? this->config.seed : 1;
+}
+
+size_t ENS160Sim::write(const uint8_t *data, size_t length, uint64_t now)
+{
+	size_t i;
+
+	advance(now);
+
+	if( length == 0 )
+		return 0;
+
+	this->pointer = data[0];
+
+	for( i = 1; i < length; i++ )
+		writeRegister(this->pointer++, data[i]);
+
+	return length;
+}
+
+size_t ENS160Sim::read(uint8_t *data, size_t length, uint64_t now)
+{
+	size_t i;
+	uint8_t reg;
+
+	advance(now);
+
+	for( i = 0; i < length; i++ )
+	{
+		reg = this->pointer++;
+		data[i] = readRegister(reg);
+
+		if( reg >= SIM_DATA_FIRST && reg <= SIM_DATA_LAST )
+		{
+			this->status &= ~SFE_ENS160_STATUS_NEWDAT;
+			this->regs[SFE_ENS160_DATA_MISR] = misrUpdate(this->regs[SFE_ENS160_DATA_MISR], data[i]);
+		}
+		else if( reg >= SFE_ENS160_GPR_READ0 && reg <= SFE_ENS160_GPR_READ7 )
+		{
+			this->status &= ~SFE_ENS160_STATUS_NEWGPR;
+		}
+	}
+
+	return length;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// interruptAsserted()
+//
+// Level of the INTn pin as configured in CONFIG, true meaning asserted.
+
+bool ENS160Sim::interruptAsserted(uint64_t now)
+{
+	uint8_t config;
+
+	advance(now);
+
+	config = this->regs[SFE_ENS160_CONFIG];
+
+	if( (config & 0x01) == 0 )
+		return false;
+
+	if( (config & 0x02) && (this->status & SFE_ENS160_STATUS_NEWDAT) )
+		return true;
+
+	if( (config & 0x08) && (this->status & SFE_ENS160_STATUS_NEWGPR) )
+		return true;
+
+	return false;
+}
+
+uint32_t ENS160Sim::getResultCount()
+{
+	return this->results;
+}
+
+uint8_t ENS160Sim::getOperatingMode()
+{
+	return this->opMode;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// advance()
+//
+// Brings the model up to the given time. Results missed while nobody was 
+// looking are skipped over; only the latest one is kept, as on the device.
+
+void ENS160Sim::advance(uint64_t now)
+{
+	uint64_t behind;
+
+	if( now > this->now )
+		this->now = now;
+
+	if( this->opMode != SFE_ENS160_STANDARD || this->now < this->nextResult )
+		return;
+
+	behind = (this->now - this->nextResult) / this->config.periodUs;
+	this->results += (uint32_t)behind;
+	this->nextResult += behind * this->config.periodUs;
+
+	produceResult();
+	this->nextResult += this->config.periodUs;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// produceResult()
+//
+// Moves eCO2 along a bounded random walk and derives TVOC and AQI from it so 
+// that the three values stay plausible together.
+
+void ENS160Sim::produceResult()
+{
+	int32_t eco2;
+	uint16_t tvoc;
+	uint8_t aqi;
+
+	this->signal ^= this->signal << 13;
+	this->signal ^= this->signal >> 17;
+	this->signal ^= this->signal << 5;
+
+	eco2 = this->regs[SFE_ENS160_DATA_ECO2] | (this->regs[SFE_ENS160_DATA_ECO2 + 1] << 8);
+	if( eco2 < 400 )
+		eco2 = 600;
+	eco2 += (int32_t)(this->signal % 61) - 30;
+	if( eco2 < 400 )
+		eco2 = 400;
+	if( eco2 > 2000 )
+		eco2 = 2000;
+
+	tvoc = (uint16_t)((eco2 - 400) * 5 / 8);
+
+	if( eco2 < 600 )
+		aqi = 1;
+	else if( eco2 < 800 )
+		aqi = 2;
+	else if( eco2 < 1000 )
+		aqi = 3;
+	else if( eco2 < 1500 )
+		aqi = 4;
+	else
+		aqi = 5;
+
+	this->regs[SFE_ENS160_DATA_AQI] = aqi;
+	this->regs[SFE_ENS160_DATA_TVOC] = (uint8_t)tvoc;
+	this->regs[SFE_ENS160_DATA_TVOC + 1] = (uint8_t)(tvoc >> 8);
+	this->regs[SFE_ENS160_DATA_ECO2] = (uint8_t)eco2;
+	this->regs[SFE_ENS160_DATA_ECO2 + 1] = (uint8_t)(eco2 >> 8);
+
+	this->status |= SFE_ENS160_STATUS_NEWDAT;
+	this->results++;
+}
+
+uint8_t ENS160Sim::validity()
+{
+	uint64_t running = this->now - this->standardSince;
+
+	if( running < this->config.warmUpUs )
+		return SFE_ENS160_VALIDITY_WARM_UP;
+
+	if( running < this->config.warmUpUs + this->config.startUpUs )
+		return SFE_ENS160_VALIDITY_START_UP;
+
+	return SFE_ENS160_VALIDITY_NORMAL;
+}
+
+uint8_t ENS160Sim::readRegister(uint8_t reg)
+{
+	uint8_t value;
+
+	if( reg == SFE_ENS160_DEVICE_STATUS )
+	{
+		value = this->status;
+		if( this->opMode == SFE_ENS160_STANDARD )
+			value |= SFE_ENS160_STATUS_STATAS | (validity() << 2);
+		return value;
+	}
+
+	if( reg == SFE_ENS160_OP_MODE )
+		return this->opMode;
+
+	if( reg >= SIM_REGISTERS )
+		return 0xFF;
+
+	return this->regs[reg];
+}
+
+void ENS160Sim::writeRegister(uint8_t reg, uint8_t value)
+{
+	switch( reg )
+	{
+		case SFE_ENS160_OP_MODE:
+			if( value == SFE_ENS160_RESET )
+			{
+				powerOn(this->now);
+			}
+			else if( value == SFE_ENS160_DEEP_SLEEP || value == SFE_ENS160_IDLE )
+			{
+				this->opMode = value;
+				this->status &= ~SFE_ENS160_STATUS_STATER;
+			}
+			else if( value == SFE_ENS160_STANDARD )
+			{
+				if( this->opMode != SFE_ENS160_STANDARD )
+				{
+					this->standardSince = this->now;
+					this->nextResult = this->now + this->config.phaseUs + this->config.periodUs;
+				}
+				this->opMode = value;
+				this->status &= ~SFE_ENS160_STATUS_STATER;
+			}
+			else
+			{
+				this->status |= SFE_ENS160_STATUS_STATER;
+			}
+			break;
+
+		case SFE_ENS160_COMMAND:
+			this->regs[reg] = value;
+			runCommand(value);
+			break;
+
+		case SFE_ENS160_CONFIG:
+		case SFE_ENS160_TEMP_IN:
+		case SFE_ENS160_TEMP_IN + 1:
+		case SFE_ENS160_RH_IN:
+		case SFE_ENS160_RH_IN + 1:
+			this->regs[reg] = value;
+			// The sensor reports the compensation values it is using
+			if( reg >= SFE_ENS160_TEMP_IN )
+				this->regs[SFE_ENS160_DATA_T + reg - SFE_ENS160_TEMP_IN] = value;
+			break;
+
+		default:
+			if( reg >= SFE_ENS160_GPR_WRITE0 && reg <= SFE_ENS160_GPR_WRITE7 )
+				this->regs[reg] = value;
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// runCommand()
+//
+// Commands only run in IDLE mode; results appear in GPR_READ with NEWGPR set.
+
+void ENS160Sim::runCommand(uint8_t command)
+{
+	if( this->opMode != SFE_ENS160_IDLE )
+		return;
+
+	switch( command )
+	{
+		case SFE_ENS160_COMMAND_GET_APPVER:
+			this->regs[SFE_ENS160_GPR_READ4] = ENS160_SIM_APPVER_MAJOR;
+			this->regs[SFE_ENS160_GPR_READ5] = ENS160_SIM_APPVER_MINOR;
+			this->regs[SFE_ENS160_GPR_READ6] = ENS160_SIM_APPVER_RELEASE;
+			this->status |= SFE_ENS160_STATUS_NEWGPR;
+			break;
+
+		case SFE_ENS160_COMMAND_CLRGPR:
+			memset(&this->regs[SFE_ENS160_GPR_READ0], 0, 8);
+			this->status &= ~SFE_ENS160_STATUS_NEWGPR;
+			break;
+
+		default:
+			break;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Default timing: one result per second in STANDARD mode, 3 minutes of warm-up
+#define ENS160_SIM_PERIOD_US     1000000UL
+#define ENS160_SIM_WARM_UP_US    (3ULL * 60ULL * 1000000ULL)
+#define ENS160_SIM_START_UP_US   0ULL
+
+// Application firmware version reported by GET_APPVER
+#define ENS160_SIM_APPVER_MAJOR 5
+#define ENS160_SIM_APPVER_MINOR 4
+#define ENS160_SIM_APPVER_RELEASE 6
+
+typedef struct
+{
+	uint32_t periodUs;   // time between results in STANDARD mode
+	uint32_t phaseUs;    // extra delay before the first result
+	uint64_t warmUpUs;   // reported as warm-up after entering STANDARD
+	uint64_t startUpUs;  // then reported as initial start-up
+	uint32_t seed;       // seeds the generated air quality signal
+}	ens160_sim_config_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160Sim
+//
+// Register-level model of an ENS160 for host builds. It follows the register
+// pointer and auto-increment rules of the real part, produces a new result
+// every period while in STANDARD mode, reports warm-up and start-up validity,
+// clears NEWDAT and folds bytes into DATA_MISR when data registers are read,
+// and answers the IDLE mode commands through GPR_READ. Time is passed in by
+// the bus so the model never reads a clock of its own.
+
+class ENS160Sim {
+    public:
+        ENS160Sim();
+        void configure(const ens160_sim_config_t *config);
+        void powerOn(uint64_t now);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // write() / read()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  data         bytes of the transfer, the first write byte sets the register pointer
+        //  length       number of bytes
+        //  now          bus time of the transfer in us
+        //  retval       number of bytes acknowledged or returned
+
+        size_t write(const uint8_t *data, size_t length, uint64_t now);
+        size_t read(uint8_t *data, size_t length, uint64_t now);
+
+        bool interruptAsserted(uint64_t now);
+        uint32_t getResultCount();
+        uint8_t getOperatingMode();
+
+    private:
+        ens160_sim_config_t config;
+        uint8_t regs[0x50];
+        uint8_t pointer;
+        uint8_t opMode;
+        uint8_t status;
+        uint64_t now;
+        uint64_t standardSince;
+        uint64_t nextResult;
+        uint32_t results;
+        uint32_t signal;
+        void advance(uint64_t now);
+        void produceResult();
+        uint8_t validity();
+        uint8_t readRegister(uint8_t reg);
+        void writeRegister(uint8_t reg, uint8_t value);
+        void runCommand(uint8_t command);
+};
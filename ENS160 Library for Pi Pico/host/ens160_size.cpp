@@ -0,0 +1,10 @@
+#include <stdio.h>
+#include "ens160_i2c.h"
+
+// Reports the RAM one driver instance takes in this feature configuration
+int main()
+{
+	printf("{\"config\":\"%s\",\"instance_bytes\":%u}\n", ENS160_SIZE_CONFIG, (unsigned)sizeof(ENS160));
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+#include "hardware/gpio.h"
+#include "i2c_sim.h"
+
+// Pins read high, as with idle pull-ups, unless a simulated bus holds SDA low
+
+void gpio_init(uint gpio)
+{
+	(void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+	(void)gpio;
+	(void)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+	i2c_sim_pin_direction(gpio, out);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+	(void)gpio;
+	(void)value;
+}
+
+bool gpio_get(uint gpio)
+{
+	return i2c_sim_pin_level(gpio);
+}
+
+void gpio_pull_up(uint gpio)
+{
+	(void)gpio;
+}
@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <string.h>
+#include "i2c_sim.h"
+#include "pico/time.h"
+
+#define I2C_SIM_ADDRESSES 128
+#define I2C_SIM_NO_PIN    0xFFFFFFFF
+
+// A blocking transfer on a stuck bus would never return; the simulation gives
+// up after this long instead
+#define I2C_SIM_HANG_US 1000000
+
+struct i2c_inst
+{
+	uint index;
+	uint baudrate;
+	ENS160Sim *devices[I2C_SIM_ADDRESSES];
+	i2c_sim_stats_t stats;
+	const i2c_sim_fault_t *faults;
+	size_t faultCount;
+	size_t nextFault;
+	uint64_t sequence;               // transactions since the schedule was set
+	const i2c_sim_fault_t *active;
+	uint32_t activeLeft;             // transactions active still affects
+	uint32_t sdaClocks;              // SCL pulses until SDA is released, 0 if free
+	uint sdaPin;
+	uint sclPin;
+	bool sclLow;
+};
+
+static i2c_inst_t buses[I2C_SIM_BUSES] = {
+	{ 0, 100 * 1000, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, I2C_SIM_NO_PIN, I2C_SIM_NO_PIN, false },
+	{ 1, 100 * 1000, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, I2C_SIM_NO_PIN, I2C_SIM_NO_PIN, false },
+	{ 2, 100 * 1000, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, I2C_SIM_NO_PIN, I2C_SIM_NO_PIN, false },
+	{ 3, 100 * 1000, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, I2C_SIM_NO_PIN, I2C_SIM_NO_PIN, false },
+};
+
+static const char *faultNames[I2C_SIM_FAULT_TYPES] = {
+	"nack_address", "nack_data", "stretch", "stuck_sda", "bit_flip", "reset",
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// transferUs()
+//
+// Start, address byte, the data bytes with their ACKs, and stop.
+
+static uint64_t transferUs(i2c_inst_t *i2c, size_t len)
+{
+	uint64_t bits = 2 + 9 * (1 + (uint64_t)len);
+
+	return (bits * 1000000 + i2c->baudrate - 1) / i2c->baudrate;
+}
+
+static void transferTime(i2c_inst_t *i2c, size_t len)
+{
+	uint64_t us = transferUs(i2c, len);
+
+	i2c->stats.transactions++;
+	i2c->stats.bytes += 1 + len;
+	i2c->stats.busTimeUs += us;
+	sim_clock_advance(us);
+}
+
+// A transfer that ends at the controller's timeout
+static int timeOut(i2c_inst_t *i2c, uint timeout_us)
+{
+	uint64_t us = timeout_us ? timeout_us : I2C_SIM_HANG_US;
+
+	i2c->stats.transactions++;
+	i2c->stats.timeouts++;
+	i2c->stats.busTimeUs += us;
+	sim_clock_advance(us);
+
+	return PICO_ERROR_TIMEOUT;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// nextFault()
+//
+// Counts one transaction against the schedule, fires the faults that are due
+// and returns the one affecting this transaction, if any. A new fault takes
+// over from one still active.
+
+static const i2c_sim_fault_t *nextFault(i2c_inst_t *i2c, ENS160Sim *device)
+{
+	const i2c_sim_fault_t *fault;
+
+	i2c->sequence++;
+
+	while( i2c->nextFault < i2c->faultCount && i2c->faults[i2c->nextFault].at <= i2c->sequence )
+	{
+		fault = &i2c->faults[i2c->nextFault++];
+		i2c->stats.faults++;
+		i2c->stats.lastFaultUs = time_us_64();
+
+		if( fault->type == I2C_SIM_FAULT_STUCK_SDA )
+		{
+			i2c->sdaClocks = fault->param ? fault->param : 1;
+		}
+		else if( fault->type == I2C_SIM_FAULT_RESET )
+		{
+			if( device )
+				device->powerOn(time_us_64());
+		}
+		else
+		{
+			i2c->active = fault;
+			i2c->activeLeft = fault->repeat ? fault->repeat : 1;
+		}
+	}
+
+	if( i2c->activeLeft == 0 )
+		return 0;
+
+	i2c->activeLeft--;
+
+	return i2c->active;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// startTransfer()
+//
+// The bus side of one transaction: its faults and its time on the wire.
+// Returns 0 with *length cut to the bytes the device gets to handle, or the
+// error the transfer ends with before the device sees any of it.
+
+static int startTransfer(i2c_inst_t *i2c, ENS160Sim *device, const i2c_sim_fault_t *fault, size_t *length, uint timeout_us)
+{
+	uint8_t type = fault ? fault->type : I2C_SIM_FAULT_TYPES;
+
+	// Not even a start condition can be sent while SDA is held low
+	if( i2c->sdaClocks )
+		return timeOut(i2c, timeout_us);
+
+	if( device == 0 || type == I2C_SIM_FAULT_NACK_ADDRESS )
+	{
+		transferTime(i2c, 0);
+		i2c->stats.nacks++;
+		return PICO_ERROR_GENERIC;
+	}
+
+	if( type == I2C_SIM_FAULT_STRETCH )
+	{
+		if( timeout_us && transferUs(i2c, *length) + fault->param > timeout_us )
+			return timeOut(i2c, timeout_us);
+
+		i2c->stats.busTimeUs += fault->param;
+		sim_clock_advance(fault->param);
+	}
+
+	if( type == I2C_SIM_FAULT_NACK_DATA && fault->param < *length )
+	{
+		*length = fault->param;
+		i2c->stats.nacks++;
+	}
+
+	transferTime(i2c, *length);
+
+	return 0;
+}
+
+static void flipBit(const i2c_sim_fault_t *fault, uint8_t *data, size_t length)
+{
+	if( fault && fault->type == I2C_SIM_FAULT_BIT_FLIP && length )
+		data[fault->param / 8 % length] ^= (uint8_t)(1 << (fault->param % 8));
+}
+
+i2c_inst_t *i2c_get_instance(uint num)
+{
+	return &buses[num % I2C_SIM_BUSES];
+}
+
+void i2c_sim_attach(i2c_inst_t *bus, uint8_t address, ENS160Sim *device)
+{
+	bus->devices[address % I2C_SIM_ADDRESSES] = device;
+	device->powerOn(time_us_64());
+}
+
+void i2c_sim_detach(i2c_inst_t *bus, uint8_t address)
+{
+	bus->devices[address % I2C_SIM_ADDRESSES] = 0;
+}
+
+void i2c_sim_get_stats(i2c_inst_t *bus, i2c_sim_stats_t *stats)
+{
+	*stats = bus->stats;
+}
+
+void i2c_sim_reset_stats(i2c_inst_t *bus)
+{
+	memset(&bus->stats, 0, sizeof(bus->stats));
+}
+
+void i2c_sim_set_faults(i2c_inst_t *bus, const i2c_sim_fault_t *faults, size_t count)
+{
+	bus->faults = faults;
+	bus->faultCount = faults ? count : 0;
+	bus->nextFault = 0;
+	bus->sequence = 0;
+	bus->active = 0;
+	bus->activeLeft = 0;
+	bus->sdaClocks = 0;
+}
+
+bool i2c_sim_parse_fault(const char *line, i2c_sim_fault_t *fault)
+{
+	unsigned long long at;
+	unsigned int repeat = 1;
+	unsigned int param = 0;
+	char name[16];
+	uint8_t type;
+
+	if( sscanf(line, "%llu %15s %u %u", &at, name, &repeat, &param) < 2 )
+		return false;
+
+	for( type = 0; type < I2C_SIM_FAULT_TYPES; type++ )
+	{
+		if( strcmp(name, faultNames[type]) == 0 )
+			break;
+	}
+
+	if( type == I2C_SIM_FAULT_TYPES )
+		return false;
+
+	fault->at = at;
+	fault->type = type;
+	fault->repeat = (uint16_t)repeat;
+	fault->param = param;
+
+	return true;
+}
+
+const char *i2c_sim_fault_name(uint8_t type)
+{
+	return type < I2C_SIM_FAULT_TYPES ? faultNames[type] : "none";
+}
+
+void i2c_sim_set_pins(i2c_inst_t *bus, uint sda, uint scl)
+{
+	bus->sdaPin = sda;
+	bus->sclPin = scl;
+	bus->sclLow = false;
+}
+
+bool i2c_sim_pin_level(uint gpio)
+{
+	size_t i;
+
+	for( i = 0; i < I2C_SIM_BUSES; i++ )
+	{
+		if( buses[i].sdaPin == gpio && buses[i].sdaClocks )
+			return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// i2c_sim_pin_direction()
+//
+// SCL is driven open-drain: output pulls it low, input lets it rise. Each
+// rising edge clocks one bit out of a device holding SDA.
+
+void i2c_sim_pin_direction(uint gpio, bool out)
+{
+	size_t i;
+
+	for( i = 0; i < I2C_SIM_BUSES; i++ )
+	{
+		if( buses[i].sclPin != gpio )
+			continue;
+
+		if( !out && buses[i].sclLow && buses[i].sdaClocks )
+			buses[i].sdaClocks--;
+
+		buses[i].sclLow = out;
+	}
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+	return i2c_set_baudrate(i2c, baudrate);
+}
+
+void i2c_deinit(i2c_inst_t *i2c)
+{
+	(void)i2c;
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate)
+{
+	if( baudrate == 0 )
+		baudrate = 100 * 1000;
+
+	i2c->baudrate = baudrate;
+
+	return baudrate;
+}
+
+uint i2c_hw_index(i2c_inst_t *i2c)
+{
+	return i2c->index;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us)
+{
+	ENS160Sim *device = i2c->devices[addr % I2C_SIM_ADDRESSES];
+	const i2c_sim_fault_t *fault = nextFault(i2c, device);
+	uint8_t corrupted[256];
+	size_t length = len;
+	int ret;
+
+	(void)nostop;
+
+	ret = startTransfer(i2c, device, fault, &length, timeout_us);
+	if( ret != 0 )
+		return ret;
+
+	if( fault && fault->type == I2C_SIM_FAULT_BIT_FLIP && length <= sizeof(corrupted) )
+	{
+		memcpy(corrupted, src, length);
+		flipBit(fault, corrupted, length);
+		src = corrupted;
+	}
+
+	ret = (int)device->write(src, length, time_us_64());
+
+	return length < len ? PICO_ERROR_GENERIC : ret;
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us)
+{
+	ENS160Sim *device = i2c->devices[addr % I2C_SIM_ADDRESSES];
+	const i2c_sim_fault_t *fault = nextFault(i2c, device);
+	size_t length = len;
+	int ret;
+
+	(void)nostop;
+
+	ret = startTransfer(i2c, device, fault, &length, timeout_us);
+	if( ret != 0 )
+		return ret;
+
+	ret = (int)device->read(dst, length, time_us_64());
+	flipBit(fault, dst, length);
+
+	return length < len ? PICO_ERROR_GENERIC : ret;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+	return i2c_write_timeout_us(i2c, addr, src, len, nostop, 0);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+	return i2c_read_timeout_us(i2c, addr, dst, len, nostop, 0);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "hardware/i2c.h"
+#include "ens160_sim.h"
+
+#define I2C_SIM_BUSES 4
+
+// Traffic seen by one bus. Every read or write call is one transaction; its
+// address byte is counted in bytes along with the data.
+typedef struct
+{
+	uint64_t transactions;
+	uint64_t bytes;
+	uint64_t busTimeUs;
+	uint64_t nacks;
+	uint64_t timeouts;
+	uint64_t faults;       // scheduled faults that have fired
+	uint64_t lastFaultUs;  // when the last one fired
+}	i2c_sim_stats_t;
+
+// Fault types
+#define I2C_SIM_FAULT_NACK_ADDRESS 0 // address byte not acknowledged
+#define I2C_SIM_FAULT_NACK_DATA    1 // transfer aborted after param bytes, which the device has handled
+#define I2C_SIM_FAULT_STRETCH      2 // device holds SCL for param us; longer than the timeout times out
+#define I2C_SIM_FAULT_STUCK_SDA    3 // device holds SDA low until SCL is clocked param times
+#define I2C_SIM_FAULT_BIT_FLIP     4 // bit param % 8 of byte param / 8 (modulo the length) inverted
+#define I2C_SIM_FAULT_RESET        5 // addressed device powers on again, back in DEEP_SLEEP
+#define I2C_SIM_FAULT_TYPES        6
+
+// One scheduled fault. It fires on the bus's at-th transaction and affects
+// repeat transactions in a row (stuck SDA and reset fire once). Transactions
+// are counted from i2c_sim_set_faults(), so a schedule replays exactly.
+typedef struct
+{
+	uint64_t at;
+	uint8_t type;     // I2C_SIM_FAULT_*
+	uint16_t repeat;
+	uint32_t param;
+}	i2c_sim_fault_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// Simulated I2C buses and clock for host builds
+//
+// The hardware/i2c.h and pico/time.h stand-ins are implemented on top of these.
+// Transfers take the time their bits would take at the bus clock, and sleeping
+// advances a virtual clock instead of waiting, so a day of sensor time runs in
+// well under a second. Real time can be selected for code that waits on the OS.
+// A scheduled list of faults can be played against a bus to exercise the
+// driver's retry and recovery paths.
+
+void i2c_sim_attach(i2c_inst_t *bus, uint8_t address, ENS160Sim *device);
+void i2c_sim_detach(i2c_inst_t *bus, uint8_t address);
+void i2c_sim_get_stats(i2c_inst_t *bus, i2c_sim_stats_t *stats);
+void i2c_sim_reset_stats(i2c_inst_t *bus);
+
+//////////////////////////////////////////////////////////////////////////////////
+// i2c_sim_set_faults()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  faults       schedule ordered by at, not copied; 0 clears it
+//  count        number of entries
+
+void i2c_sim_set_faults(i2c_inst_t *bus, const i2c_sim_fault_t *faults, size_t count);
+
+//////////////////////////////////////////////////////////////////////////////////
+// i2c_sim_parse_fault()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  line         "at type [repeat [param]]", type by name, e.g. "1200 stretch 2 5000"
+//  fault        entry to fill in
+//  retval       false if the line is not a fault
+
+bool i2c_sim_parse_fault(const char *line, i2c_sim_fault_t *fault);
+const char *i2c_sim_fault_name(uint8_t type);
+
+// Pins of a bus as wired to the GPIO stand-in, so that a stuck SDA reads low
+// and SCL pulses driven by bus recovery are seen by the device holding it
+void i2c_sim_set_pins(i2c_inst_t *bus, uint sda, uint scl);
+bool i2c_sim_pin_level(uint gpio);
+void i2c_sim_pin_direction(uint gpio, bool out);
+
+void sim_clock_set_realtime(bool realtime);
+void sim_clock_advance(uint64_t us);
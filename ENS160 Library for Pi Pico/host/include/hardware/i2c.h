@@ -0,0 +1,23 @@
+#pragma once
+#include "pico/types.h"
+
+// Host stand-in for the Pico SDK's hardware/i2c.h. Every instance is a
+// simulated bus; devices are attached to it with i2c_sim_attach().
+
+typedef struct i2c_inst i2c_inst_t;
+
+i2c_inst_t *i2c_get_instance(uint num);
+
+#define i2c0 i2c_get_instance(0)
+#define i2c1 i2c_get_instance(1)
+#define i2c_default i2c0
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+uint i2c_hw_index(i2c_inst_t *i2c);
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us);
@@ -0,0 +1,8 @@
+#pragma once
+#include "pico/types.h"
+
+// Host stand-in for the Pico SDK's hardware/sync.h. The simulator raises no
+// interrupts, so there is nothing to mask.
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
@@ -0,0 +1,13 @@
+#pragma once
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+// Host stand-in for the Pico SDK's pico/stdlib.h
+
+#define PICO_DEFAULT_I2C         0
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+#define PICO_DEFAULT_LED_PIN     25
+
+static inline bool stdio_init_all(void) { return true; }
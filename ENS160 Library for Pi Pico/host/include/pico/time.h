@@ -0,0 +1,18 @@
+#pragma once
+#include "pico/types.h"
+
+// Host stand-in for the Pico SDK's pico/time.h. Time comes from the simulator
+// clock (see i2c_sim.h), which is virtual unless real time has been selected.
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint64_t to_us_since_boot(absolute_time_t t);
+absolute_time_t make_timeout_time_us(uint64_t us);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void sleep_until(absolute_time_t t);
+void busy_wait_us_32(uint32_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
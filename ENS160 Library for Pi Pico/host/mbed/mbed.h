@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Host stand-in for the parts of mbed.h the mbed library uses, enough to run
+// its driver and bus arbiter on threads against a fake bus (see
+// ens160_bus_stress.cpp). Waits sleep for real.
+
+typedef enum { p9 = 9, p10 = 10, NC = -1 } PinName;
+enum PinMode { PullUp, PullDown, PullNone, OpenDrain };
+
+// A bus that acknowledges everything and reads back zeros. Each transfer takes
+// a few microseconds, and what a logic analyser would show is counted: start
+// conditions, transfers begun by one thread while another had the bus
+// between its start and stop, and the transfers each thread has carried out.
+class I2C {
+public:
+    I2C(PinName sda, PinName scl);
+    void frequency(int hz);
+    int read(int address, char *data, int length, bool repeated = false);
+    int write(int address, const char *data, int length, bool repeated = false);
+    void stop(void);
+
+    uint32_t getTransferCount();
+    uint32_t getStartCount();
+    uint32_t getOverlapCount();
+    static uint32_t getThreadTransferCount();
+
+private:
+    std::atomic<int> owner;  // thread holding the bus, 0 while it is idle
+    std::atomic<uint32_t> transfers;
+    std::atomic<uint32_t> starts;
+    std::atomic<uint32_t> overlaps;
+    void begin();
+    void end(bool repeated);
+};
+
+class DigitalInOut {
+public:
+    DigitalInOut(PinName pin) : level(1) { (void)pin; }
+    void output() {}
+    void input() {}
+    void mode(PinMode pull) { (void)pull; }
+    void write(int value) { this->level = value; }
+    int read() { return 1; }
+    DigitalInOut &operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    int level;
+};
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+uint32_t us_ticker_read(void);
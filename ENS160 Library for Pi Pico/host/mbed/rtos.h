@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+
+// Host stand-in for the parts of rtos.h the bus arbiter uses, on std::thread.
+// Signals are kept per thread, as in RTX.
+
+typedef enum { osOK = 0, osEventSignal = 0x08, osEventTimeout = 0x40 } osStatus;
+#define osWaitForever 0xFFFFFFFF
+
+typedef struct { osStatus status; union { int32_t signals; } value; } osEvent;
+typedef struct os_thread_cb *osThreadId;
+
+class Mutex {
+public:
+    osStatus lock(uint32_t ms = osWaitForever) { (void)ms; this->mutex.lock(); return osOK; }
+    osStatus unlock() { this->mutex.unlock(); return osOK; }
+
+private:
+    std::mutex mutex;
+};
+
+class Thread {
+public:
+    static osEvent signal_wait(int32_t signals, uint32_t millisec = osWaitForever);
+};
+
+osThreadId osThreadGetId(void);
+int32_t osSignalSet(osThreadId thread_id, int32_t signals);
@@ -0,0 +1,118 @@
+#include <time.h>
+#include "i2c_sim.h"
+#include "pico/time.h"
+
+static bool realtime = false;
+static uint64_t virtualNow = 0;
+static uint64_t realtimeStart = 0;
+
+static uint64_t monotonicUs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// sim_clock_set_realtime()
+//
+// Switches between the virtual clock and the host's monotonic clock. Time 
+// carries on from where it was so that nothing sees it jump backwards.
+
+void sim_clock_set_realtime(bool enable)
+{
+	if( enable == realtime )
+		return;
+
+	if( enable )
+		realtimeStart = monotonicUs() - virtualNow;
+	else
+		virtualNow = monotonicUs() - realtimeStart;
+
+	realtime = enable;
+}
+
+void sim_clock_advance(uint64_t us)
+{
+	struct timespec ts;
+
+	if( !realtime )
+	{
+		virtualNow += us;
+		return;
+	}
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (long)(us % 1000000) * 1000;
+	nanosleep(&ts, 0);
+}
+
+uint64_t time_us_64(void)
+{
+	if( realtime )
+		return monotonicUs() - realtimeStart;
+
+	return virtualNow;
+}
+
+uint32_t time_us_32(void)
+{
+	return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void)
+{
+	return time_us_64();
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t)
+{
+	return (uint32_t)(t / 1000);
+}
+
+uint64_t to_us_since_boot(absolute_time_t t)
+{
+	return t;
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us)
+{
+	return time_us_64() + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+	return time_us_64() + (uint64_t)ms * 1000;
+}
+
+void sleep_us(uint64_t us)
+{
+	sim_clock_advance(us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+	sim_clock_advance((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t t)
+{
+	uint64_t now = time_us_64();
+
+	if( t > now )
+		sim_clock_advance(t - now);
+}
+
+void busy_wait_us_32(uint32_t us)
+{
+	sim_clock_advance(us);
+}
+
+// Nothing raises events on the host, so this always waits out the timeout
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+	sleep_until(timeout_timestamp);
+	return true;
+}
@@ -0,0 +1,499 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "pico/stdlib.h"
+#include "i2c_linux.h"
+#include "i2c_linux_fake.h"
+#include "gpio_linux.h"
+#include "ens160_i2c.h"
+#include "ens160_latency.h"
+#include "ens160_shm.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160_gateway
+//
+// Collects frames from many ENS160s spread over several /dev/i2c-N adapters
+// and writes one line per new frame to stdout. Every adapter gets a worker
+// thread of its own, which owns the sensors on it and sleeps in epoll_wait()
+// until one of them has data:
+//  - a sensor with INTn wired to a GPIO line is read when the line's falling
+//    edge event arrives, with a status poll two periods later in case an edge
+//    was missed;
+//  - a sensor without is polled from the worker's timerfd, first shortly
+//    before its next result is due and then every GATEWAY_POLL_US until it
+//    has arrived.
+// One timerfd per worker serves all of its sensors, so the number of file
+// descriptors grows only with the wired INTn lines. Read latency is bounded
+// by the bus time of the sensors on one adapter plus GATEWAY_POLL_US.
+//
+// Sensors are listed in a file, one per line: bus, address and optionally the
+// GPIO chip and line INTn is wired to, e.g. "1 0x52 0 17". -f N runs against
+// N simulated sensors on fake adapters instead, every other row with INTn.
+// -m publishes the frames to local readers through a shared memory ring too
+// (see ens160_shm.h), -q leaves stdout quiet.
+
+#define GATEWAY_MAX_SENSORS 512
+#define GATEWAY_PERIOD_US   1000000 // STANDARD mode result period
+#define GATEWAY_GUARD_US    40000   // first poll this long before a result is due
+#define GATEWAY_POLL_US     20000   // then poll this often until it arrives
+#define GATEWAY_REPORT_US   (60ULL * 1000000ULL)
+#define GATEWAY_MAX_EVENTS  32
+
+// Simulated sensors are given addresses from here up on each fake adapter
+#define GATEWAY_FAKE_FIRST_ADDRESS 0x08
+#define GATEWAY_FAKE_LAST_ADDRESS  0x77
+
+typedef struct
+{
+	uint bus;
+	uint8_t address;
+	int gpioChip;      // -1 when INTn is not wired
+	uint gpioLine;
+	int lineFd;        // edge events of INTn, -1 when polled
+	ENS160 *sensor;
+	uint64_t due;      // next status poll
+	uint64_t lastPoll; // last read that found no new data
+	uint32_t frames;
+}	gateway_sensor_t;
+
+typedef struct
+{
+	uint bus;
+	pthread_t thread;
+	int epollFd;
+	int timerFd;
+	gateway_sensor_t *sensors[GATEWAY_MAX_SENSORS];
+	uint count;
+	ENS160LatencyMonitor latency;
+	uint32_t frames;
+}	gateway_worker_t;
+
+static gateway_sensor_t sensors[GATEWAY_MAX_SENSORS];
+static uint sensorCount;
+static gateway_worker_t *workers[I2C_LINUX_BUSES];
+static ENS160Sim *fakeDevices;
+static int stopFd;
+static ENS160ShmWriter ring;
+static bool ringEnabled;
+static bool quiet;
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-q] [-m shm-name] [-t seconds] (-f sensors | sensor-list)\n", name);
+	exit(1);
+}
+
+static bool addSensor(uint bus, uint8_t address, int gpioChip, uint gpioLine)
+{
+	gateway_sensor_t *s;
+
+	if( sensorCount >= GATEWAY_MAX_SENSORS || bus >= I2C_LINUX_BUSES )
+		return false;
+
+	s = &sensors[sensorCount++];
+	s->bus = bus;
+	s->address = address;
+	s->gpioChip = gpioChip;
+	s->gpioLine = gpioLine;
+	s->lineFd = -1;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readSensorList()
+//
+// Blank lines and everything after a # are ignored.
+
+static bool readSensorList(const char *path)
+{
+	char line[128];
+	uint bus, chip, offset;
+	int address;
+	FILE *file;
+	int fields;
+
+	file = fopen(path, "r");
+	if( file == 0 )
+	{
+		perror(path);
+		return false;
+	}
+
+	while( fgets(line, sizeof(line), file) )
+	{
+		line[strcspn(line, "#\r\n")] = 0;
+
+		fields = sscanf(line, "%u %i %u %u", &bus, &address, &chip, &offset);
+		if( fields <= 0 )
+			continue;
+
+		if( (fields != 2 && fields != 4) || !addSensor(bus, (uint8_t)address, fields == 4 ? (int)chip : -1, offset) )
+		{
+			fprintf(stderr, "%s: bad sensor \"%s\"\n", path, line);
+			fclose(file);
+			return false;
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// setupFake()
+//
+// Spreads the simulated sensors over the fake adapters, with their results
+// out of phase with each other, and wires INTn of every other row of them to a line
+// on fake GPIO chip 0.
+
+static bool setupFake(uint count)
+{
+	const uint perBus = GATEWAY_FAKE_LAST_ADDRESS - GATEWAY_FAKE_FIRST_ADDRESS + 1;
+	ens160_sim_config_t config;
+	uint bus, address, i;
+
+	if( count == 0 || count > GATEWAY_MAX_SENSORS || count > perBus * I2C_LINUX_FAKE_BUSES )
+		return false;
+
+	i2c_linux_fake_install(false);
+	fakeDevices = new ENS160Sim[count];
+
+	for( i = 0; i < count; i++ )
+	{
+		bus = i % I2C_LINUX_FAKE_BUSES;
+		address = GATEWAY_FAKE_FIRST_ADDRESS + i / I2C_LINUX_FAKE_BUSES;
+
+		config.periodUs = GATEWAY_PERIOD_US;
+		config.phaseUs = (uint32_t)(((uint64_t)i * 7919 * 1000) % GATEWAY_PERIOD_US);
+		config.warmUpUs = 0;
+		config.startUpUs = 0;
+		config.seed = i + 1;
+		fakeDevices[i].configure(&config);
+		i2c_linux_fake_attach(bus, (uint8_t)address, &fakeDevices[i]);
+
+		if( (i / I2C_LINUX_FAKE_BUSES) % 2 )
+		{
+			addSensor(bus, (uint8_t)address, 0, i);
+			i2c_linux_fake_connect_interrupt(bus, (uint8_t)address, 0, i);
+		}
+		else
+			addSensor(bus, (uint8_t)address, -1, 0);
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// armTimer()
+//
+// Points the worker's timerfd at the earliest due poll of its sensors.
+
+static void armTimer(gateway_worker_t *worker, uint64_t now)
+{
+	struct itimerspec spec;
+	uint64_t next = UINT64_MAX;
+	uint64_t wait;
+	uint i;
+
+	for( i = 0; i < worker->count; i++ )
+		if( worker->sensors[i]->due < next )
+			next = worker->sensors[i]->due;
+
+	memset(&spec, 0, sizeof(spec));
+	if( next != UINT64_MAX )
+	{
+		// A zero value would disarm the timer, so an overdue poll waits 1 us
+		wait = next > now ? next - now : 1;
+		spec.it_value.tv_sec = wait / 1000000;
+		spec.it_value.tv_nsec = (long)(wait % 1000000) * 1000;
+	}
+
+	timerfd_settime(worker->timerFd, 0, &spec, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// readSensor()
+//
+// Reads one frame and schedules the next poll. The device update time of a
+// new frame is taken as the edge for a wired sensor, and as halfway since the
+// previous fruitless poll for a polled one.
+
+static void readSensor(gateway_worker_t *worker, gateway_sensor_t *s, uint64_t edgeUs)
+{
+	ens160_shm_sample_t sample;
+	ens160_frame_t frame;
+	uint64_t readUs, updateUs;
+
+	if( !s->sensor->readFrame(&frame) )
+	{
+		s->due = time_us_64() + GATEWAY_POLL_US;
+		return;
+	}
+
+	readUs = time_us_64();
+
+	if( !frame.newData )
+	{
+		s->lastPoll = readUs;
+		s->due = readUs + (s->lineFd >= 0 ? 2 * GATEWAY_PERIOD_US : GATEWAY_POLL_US);
+		return;
+	}
+
+	updateUs = edgeUs ? edgeUs : s->lastPoll + (readUs - s->lastPoll) / 2;
+	s->lastPoll = readUs;
+	s->due = readUs + (s->lineFd >= 0 ? 2 * GATEWAY_PERIOD_US : GATEWAY_PERIOD_US - GATEWAY_GUARD_US);
+	s->frames++;
+	worker->frames++;
+
+	if( ringEnabled )
+	{
+		sample.readUs = readUs;
+		sample.updateUs = updateUs;
+		sample.bus = (uint8_t)s->bus;
+		sample.address = s->address;
+		sample.status = frame.status;
+		sample.validity = frame.validity;
+		sample.aqi = frame.aqi;
+		sample.reserved = 0;
+		sample.tvoc = frame.tvoc;
+		sample.eco2 = frame.eco2;
+		ring.publish(&sample);
+	}
+
+	if( !quiet )
+		printf("%.3f %u 0x%02x %u %u %u %u\n", readUs / 1e6, s->bus, s->address, frame.validity,
+			frame.aqi, frame.tvoc, frame.eco2);
+
+	worker->latency.record(updateUs, readUs, time_us_64());
+}
+
+static void report(gateway_worker_t *worker)
+{
+	ens160_latency_summary_t read, age;
+
+	worker->latency.summarize(ENS160_LATENCY_READ, &read);
+	worker->latency.summarize(ENS160_LATENCY_AGE, &age);
+
+	fprintf(stderr, "i2c-%u: %u sensors, %lu frames, read p50 %lu us p99 %lu us, age p99 %lu us max %lu us\n",
+		worker->bus, worker->count, (unsigned long)worker->frames, (unsigned long)read.p50,
+		(unsigned long)read.p99, (unsigned long)age.p99, (unsigned long)age.max);
+
+	worker->latency.reset();
+	worker->frames = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// workerThread()
+//
+// Brings up the sensors on one adapter, then serves their edges and polls
+// until the stop descriptor becomes readable.
+
+static void *workerThread(void *arg)
+{
+	gateway_worker_t *worker = (gateway_worker_t *)arg;
+	struct epoll_event events[GATEWAY_MAX_EVENTS];
+	struct epoll_event event;
+	gateway_sensor_t *s;
+	uint64_t expirations, now, nextReport, edgeUs;
+	bool stop = false;
+	int ready, i;
+	uint j;
+
+	i2c_init(i2c_get_instance(worker->bus), 400 * 1000);
+
+	worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	worker->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	event.events = EPOLLIN;
+	event.data.ptr = 0;
+	epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, stopFd, &event);
+	event.data.ptr = worker;
+	epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, worker->timerFd, &event);
+
+	for( j = 0; j < worker->count; j++ )
+	{
+		s = worker->sensors[j];
+		s->sensor = new ENS160(i2c_get_instance(s->bus), s->address);
+		s->due = time_us_64();
+		s->lastPoll = s->due;
+
+		if( !s->sensor->init() || !s->sensor->setOperatingMode(SFE_ENS160_STANDARD) )
+		{
+			fprintf(stderr, "i2c-%u 0x%02x: no ENS160\n", s->bus, s->address);
+			s->due = UINT64_MAX;
+			continue;
+		}
+
+		if( s->gpioChip < 0 )
+			continue;
+
+		s->lineFd = gpio_linux_request_edges((uint)s->gpioChip, s->gpioLine, true);
+		if( s->lineFd < 0 || !s->sensor->enableInterrupt() || !s->sensor->setDataInterrupt() )
+		{
+			fprintf(stderr, "i2c-%u 0x%02x: gpiochip%d line %u unavailable, polling\n", s->bus, s->address,
+				s->gpioChip, s->gpioLine);
+			gpio_linux_release(s->lineFd);
+			s->lineFd = -1;
+			continue;
+		}
+
+		event.data.ptr = s;
+		epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, s->lineFd, &event);
+	}
+
+	nextReport = time_us_64() + GATEWAY_REPORT_US;
+	armTimer(worker, time_us_64());
+
+	while( !stop )
+	{
+		ready = epoll_wait(worker->epollFd, events, GATEWAY_MAX_EVENTS, -1);
+		if( ready < 0 && errno != EINTR )
+			break;
+
+		for( i = 0; i < ready; i++ )
+		{
+			if( events[i].data.ptr == 0 )
+			{
+				stop = true;
+			}
+			else if( events[i].data.ptr == worker )
+			{
+				if( read(worker->timerFd, &expirations, sizeof(expirations)) < 0 )
+					continue;
+
+				now = time_us_64();
+				for( j = 0; j < worker->count; j++ )
+					if( worker->sensors[j]->due <= now )
+						readSensor(worker, worker->sensors[j], 0);
+			}
+			else
+			{
+				s = (gateway_sensor_t *)events[i].data.ptr;
+				if( gpio_linux_read_edges(s->lineFd, &edgeUs) )
+					readSensor(worker, s, edgeUs);
+			}
+		}
+
+		now = time_us_64();
+		if( now >= nextReport )
+		{
+			report(worker);
+			nextReport += GATEWAY_REPORT_US;
+		}
+
+		armTimer(worker, now);
+	}
+
+	report(worker);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct signalfd_siginfo info;
+	struct itimerspec spec;
+	struct timespec wallClock;
+	struct epoll_event event;
+	uint32_t seconds = 0;
+	uint32_t fakeSensors = 0;
+	const char *ringName = 0;
+	uint64_t one = 1;
+	sigset_t signals;
+	int signalFd, timerFd, epollFd;
+	uint i;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "f:m:qt:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'f': fakeSensors = strtoul(optarg, 0, 0); break;
+			case 'm': ringName = optarg; break;
+			case 'q': quiet = true; break;
+			case 't': seconds = strtoul(optarg, 0, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if( fakeSensors ? !setupFake(fakeSensors) : (optind != argc - 1 || !readSensorList(argv[optind])) )
+		usage(argv[0]);
+
+	if( ringName )
+	{
+		ringEnabled = ring.create(ringName, ENS160_SHM_DEFAULT_SLOTS);
+		if( !ringEnabled )
+		{
+			perror(ringName);
+			return 1;
+		}
+
+		clock_gettime(CLOCK_REALTIME, &wallClock);
+		ring.setEpoch((uint64_t)wallClock.tv_sec * 1000000 + wallClock.tv_nsec / 1000 - time_us_64());
+	}
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+
+	// Stop on SIGINT/SIGTERM or when the run time is up
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, 0);
+	signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+
+	stopFd = eventfd(0, EFD_CLOEXEC);
+
+	for( i = 0; i < sensorCount; i++ )
+	{
+		if( workers[sensors[i].bus] == 0 )
+		{
+			workers[sensors[i].bus] = new gateway_worker_t();
+			workers[sensors[i].bus]->bus = sensors[i].bus;
+		}
+		workers[sensors[i].bus]->sensors[workers[sensors[i].bus]->count++] = &sensors[i];
+	}
+
+	for( i = 0; i < I2C_LINUX_BUSES; i++ )
+		if( workers[i] )
+			pthread_create(&workers[i]->thread, 0, workerThread, workers[i]);
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	event.events = EPOLLIN;
+	event.data.fd = signalFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+
+	if( seconds )
+	{
+		timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		memset(&spec, 0, sizeof(spec));
+		spec.it_value.tv_sec = seconds;
+		timerfd_settime(timerFd, 0, &spec, 0);
+		event.data.fd = timerFd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+	}
+
+	while( epoll_wait(epollFd, &event, 1, -1) < 0 && errno == EINTR )
+		;
+
+	if( event.data.fd == signalFd && read(signalFd, &info, sizeof(info)) > 0 )
+		fprintf(stderr, "signal %u, stopping\n", info.ssi_signo);
+
+	if( write(stopFd, &one, sizeof(one)) < 0 )
+		return 1;
+
+	for( i = 0; i < I2C_LINUX_BUSES; i++ )
+		if( workers[i] )
+			pthread_join(workers[i]->thread, 0);
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "i2c_linux.h"
+#include "i2c_linux_fake.h"
+#include "ens160_i2c.h"
+
+// Reads every ENS160 found on the given /dev/i2c-N adapters for a while and
+// reports how many system calls each read took. -f runs against fake adapters
+// with simulated sensors, -s against fake SMBus-only adapters like i2c-stub.
+
+#define LINUX_MAX_SENSORS (2 * I2C_LINUX_BUSES)
+#define LINUX_POLL_MS     50
+#define LINUX_DEFAULT_BUS 1 // the 40 pin header bus on a Raspberry Pi
+
+static const uint8_t addresses[] = { ENS160_ADDRESS_LOW, ENS160_ADDRESS_HIGH };
+
+static ENS160Sim fakeDevices[2 * I2C_LINUX_FAKE_BUSES];
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-f | -s] [-t seconds] [bus ...]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	static ENS160 *sensors[LINUX_MAX_SENSORS];
+	bool used[I2C_LINUX_BUSES] = { false };
+	i2c_linux_stats_t stats;
+	ens160_sim_config_t config;
+	ens160_frame_t frame;
+	bool fake = false;
+	bool smbusOnly = false;
+	uint32_t seconds = 10;
+	uint32_t reads = 0;
+	uint32_t frames = 0;
+	uint64_t ioctls = 0;
+	uint64_t end;
+	uint8_t count = 0;
+	uint8_t i;
+	uint num;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "fst:")) != -1 )
+	{
+		switch( opt )
+		{
+			case 's': smbusOnly = true; // fall through
+			case 'f': fake = true; break;
+			case 't': seconds = strtoul(optarg, 0, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+
+	for( i = optind; i < argc; i++ )
+	{
+		num = strtoul(argv[i], 0, 0);
+		if( num >= I2C_LINUX_BUSES )
+		{
+			fprintf(stderr, "%s: only buses 0 to %d are supported\n", argv[i], I2C_LINUX_BUSES - 1);
+			return 1;
+		}
+		used[num] = true;
+	}
+	if( optind == argc )
+		used[fake ? 0 : LINUX_DEFAULT_BUS] = true;
+
+	if( fake )
+	{
+		i2c_linux_fake_install(smbusOnly);
+		for( i = 0; i < 2 * I2C_LINUX_FAKE_BUSES; i++ )
+		{
+			config.periodUs = ENS160_SIM_PERIOD_US;
+			config.phaseUs = i * 97 * 1000;
+			config.warmUpUs = 0;
+			config.startUpUs = 0;
+			config.seed = i + 1;
+			fakeDevices[i].configure(&config);
+			i2c_linux_fake_attach(i / 2, addresses[i % 2], &fakeDevices[i]);
+		}
+	}
+
+	for( num = 0; num < I2C_LINUX_BUSES; num++ )
+	{
+		if( !used[num] )
+			continue;
+
+		i2c_init(i2c_get_instance(num), 400 * 1000);
+
+		for( i = 0; i < 2; i++ )
+		{
+			sensors[count] = new ENS160(i2c_get_instance(num), addresses[i]);
+			if( !sensors[count]->init() )
+			{
+				delete sensors[count];
+				continue;
+			}
+
+			sensors[count]->setOperatingMode(SFE_ENS160_STANDARD);
+			printf("i2c-%u 0x%02x: ENS160%s\n", num, addresses[i], 
+				i2c_linux_is_smbus(i2c_get_instance(num)) ? " (SMBus)" : "");
+			count++;
+		}
+
+		i2c_linux_reset_stats(i2c_get_instance(num));
+	}
+
+	if( count == 0 )
+	{
+		fprintf(stderr, "no sensors found\n");
+		return 1;
+	}
+
+	end = time_us_64() + (uint64_t)seconds * 1000000;
+
+	while( time_us_64() < end )
+	{
+		for( i = 0; i < count; i++ )
+		{
+			reads++;
+			if( !sensors[i]->readFrame(&frame) || !frame.newData )
+				continue;
+
+			frames++;
+			printf("%7.3f i2c-%u 0x%02x validity=%u aqi=%u tvoc=%u eco2=%u\n", time_us_64() / 1e6, 
+				i2c_hw_index(sensors[i]->i2cbus), sensors[i]->i2c_address, frame.validity, 
+				frame.aqi, frame.tvoc, frame.eco2);
+		}
+
+		sleep_ms(LINUX_POLL_MS);
+	}
+
+	for( num = 0; num < I2C_LINUX_BUSES; num++ )
+	{
+		if( !used[num] )
+			continue;
+
+		i2c_linux_get_stats(i2c_get_instance(num), &stats);
+		ioctls += stats.ioctls;
+	}
+
+	printf("%lu frame reads, %lu new frames, %llu ioctls (%.2f per read)\n", (unsigned long)reads, 
+		(unsigned long)frames, (unsigned long long)ioctls, (double)ioctls / reads);
+
+	return 0;
+}
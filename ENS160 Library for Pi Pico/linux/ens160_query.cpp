@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include "ens160_record.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Queries a recording made by ens160_record
+//
+// Prints the number of rows and the minimum, mean and maximum AQI, TVOC and
+// eCO2 over a time range, optionally for one sensor only, along with how many
+// blocks were answered from their footer, read, or never touched. -l lists
+// the rows instead and -b the block index.
+//
+//  ens160_query [-f from] [-t to] [-s bus:address] [-l | -b] file
+//
+// Times are seconds since 1970 and may have decimals.
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t sumTvoc;
+	uint64_t sumEco2;
+	uint64_t sumAqi;
+	uint16_t minTvoc, maxTvoc;
+	uint16_t minEco2, maxEco2;
+	uint8_t minAqi, maxAqi;
+}	query_totals_t;
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-f from] [-t to] [-s bus:address] [-l | -b] file\n", name);
+	exit(1);
+}
+
+static uint64_t parseTime(const char *text)
+{
+	return (uint64_t)(strtod(text, 0) * 1e6);
+}
+
+static void addRow(query_totals_t *totals, uint8_t aqi, uint16_t tvoc, uint16_t eco2)
+{
+	if( totals->count == 0 || aqi < totals->minAqi ) totals->minAqi = aqi;
+	if( totals->count == 0 || aqi > totals->maxAqi ) totals->maxAqi = aqi;
+	if( totals->count == 0 || tvoc < totals->minTvoc ) totals->minTvoc = tvoc;
+	if( totals->count == 0 || tvoc > totals->maxTvoc ) totals->maxTvoc = tvoc;
+	if( totals->count == 0 || eco2 < totals->minEco2 ) totals->minEco2 = eco2;
+	if( totals->count == 0 || eco2 > totals->maxEco2 ) totals->maxEco2 = eco2;
+	totals->sumAqi += aqi;
+	totals->sumTvoc += tvoc;
+	totals->sumEco2 += eco2;
+	totals->count++;
+}
+
+static void addFooter(query_totals_t *totals, const ens160_record_footer_t *footer)
+{
+	if( totals->count == 0 || footer->minAqi < totals->minAqi ) totals->minAqi = footer->minAqi;
+	if( totals->count == 0 || footer->maxAqi > totals->maxAqi ) totals->maxAqi = footer->maxAqi;
+	if( totals->count == 0 || footer->minTvoc < totals->minTvoc ) totals->minTvoc = footer->minTvoc;
+	if( totals->count == 0 || footer->maxTvoc > totals->maxTvoc ) totals->maxTvoc = footer->maxTvoc;
+	if( totals->count == 0 || footer->minEco2 < totals->minEco2 ) totals->minEco2 = footer->minEco2;
+	if( totals->count == 0 || footer->maxEco2 > totals->maxEco2 ) totals->maxEco2 = footer->maxEco2;
+	totals->sumAqi += footer->sumAqi;
+	totals->sumTvoc += footer->sumTvoc;
+	totals->sumEco2 += footer->sumEco2;
+	totals->count += footer->count;
+}
+
+static void listBlocks(ENS160RecordReader *reader)
+{
+	const ens160_record_footer_t *footer;
+	uint64_t block;
+
+	for( block = 0; block < reader->getBlockCount(); block++ )
+	{
+		footer = reader->getFooter(block);
+		printf("%llu rows=%u time=%.6f..%.6f sensors=%u:0x%02x..%u:0x%02x aqi=%u..%u tvoc=%u..%u eco2=%u..%u status=0x%02x\n",
+			(unsigned long long)block, footer->count, footer->minTime / 1e6, footer->maxTime / 1e6,
+			footer->minSensor >> 8, footer->minSensor & 0xFF, footer->maxSensor >> 8, footer->maxSensor & 0xFF,
+			footer->minAqi, footer->maxAqi, footer->minTvoc, footer->maxTvoc, footer->minEco2, footer->maxEco2,
+			footer->statusOr);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::chrono::steady_clock::time_point start, stop;
+	const ens160_record_footer_t *footer;
+	const uint64_t *times;
+	const uint16_t *sensors;
+	ENS160RecordReader reader;
+	query_totals_t totals;
+	uint64_t fromUs = 0;
+	uint64_t toUs = UINT64_MAX;
+	uint64_t first, end, block;
+	uint64_t whole = 0;
+	uint64_t decoded = 0;
+	bool filter = false;
+	bool list = false;
+	bool index = false;
+	unsigned bus, address;
+	uint16_t sensor = 0;
+	uint32_t i;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "f:t:s:lb")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'f': fromUs = parseTime(optarg); break;
+			case 't': toUs = parseTime(optarg); break;
+			case 's':
+				if( sscanf(optarg, "%u:%i", &bus, (int *)&address) != 2 )
+					usage(argv[0]);
+				sensor = ENS160_RECORD_SENSOR(bus, address);
+				filter = true;
+				break;
+			case 'l': list = true; break;
+			case 'b': index = true; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if( optind != argc - 1 )
+		usage(argv[0]);
+
+	if( !reader.open(argv[optind]) )
+	{
+		fprintf(stderr, "%s: not a recording\n", argv[optind]);
+		return 1;
+	}
+
+	if( index )
+	{
+		listBlocks(&reader);
+		return 0;
+	}
+
+	start = std::chrono::steady_clock::now();
+	memset(&totals, 0, sizeof(totals));
+	reader.findBlocks(fromUs, toUs, &first, &end);
+
+	for( block = first; block < end; block++ )
+	{
+		footer = reader.getFooter(block);
+
+		if( filter && (sensor < footer->minSensor || sensor > footer->maxSensor) )
+			continue;
+
+		// Wholly inside the range and the filter: the footer has the answer
+		if( !list && footer->minTime >= fromUs && footer->maxTime <= toUs && 
+			(!filter || (footer->minSensor == sensor && footer->maxSensor == sensor)) )
+		{
+			addFooter(&totals, footer);
+			whole++;
+			continue;
+		}
+
+		times = reader.getTimes(block);
+		sensors = reader.getSensors(block);
+		decoded++;
+
+		for( i = 0; i < footer->count; i++ )
+		{
+			if( times[i] < fromUs || times[i] > toUs || (filter && sensors[i] != sensor) )
+				continue;
+
+			if( list )
+				printf("%.6f %u 0x%02x 0x%02x %u %u %u\n", times[i] / 1e6, sensors[i] >> 8, sensors[i] & 0xFF,
+					reader.getStatus(block)[i], reader.getAQI(block)[i], reader.getTVOC(block)[i], 
+					reader.getECO2(block)[i]);
+			else
+				addRow(&totals, reader.getAQI(block)[i], reader.getTVOC(block)[i], reader.getECO2(block)[i]);
+		}
+	}
+
+	stop = std::chrono::steady_clock::now();
+
+	if( list )
+		return 0;
+
+	printf("rows %llu\n", (unsigned long long)totals.count);
+	if( totals.count )
+	{
+		printf("aqi  min %u mean %.2f max %u\n", totals.minAqi, (double)totals.sumAqi / totals.count, totals.maxAqi);
+		printf("tvoc min %u mean %.1f max %u ppb\n", totals.minTvoc, (double)totals.sumTvoc / totals.count, totals.maxTvoc);
+		printf("eco2 min %u mean %.1f max %u ppm\n", totals.minEco2, (double)totals.sumEco2 / totals.count, totals.maxEco2);
+	}
+	printf("blocks %llu from footer, %llu read, %llu skipped, %.3f ms\n", (unsigned long long)whole, 
+		(unsigned long long)decoded, (unsigned long long)(reader.getBlockCount() - whole - decoded),
+		std::chrono::duration<double, std::milli>(stop - start).count());
+
+	return 0;
+}
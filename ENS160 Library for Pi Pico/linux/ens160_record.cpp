@@ -0,0 +1,387 @@
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ens160_record.h"
+
+static off_t blockOffset(uint64_t block)
+{
+	return (off_t)(ENS160_RECORD_HEADER_BYTES + block * ENS160_RECORD_BLOCK_BYTES);
+}
+
+static void emptyFooter(ens160_record_footer_t *footer)
+{
+	memset(footer, 0, sizeof(*footer));
+	footer->magic = ENS160_RECORD_BLOCK_MAGIC;
+	footer->minSensor = UINT16_MAX;
+	footer->minTvoc = UINT16_MAX;
+	footer->minEco2 = UINT16_MAX;
+	footer->minAqi = UINT8_MAX;
+}
+
+ENS160RecordWriter::ENS160RecordWriter()
+{
+	this->fd = -1;
+	this->block = 0;
+	this->blockRows = 0;
+	this->floorTime = 0;
+	this->rejected = 0;
+	this->buffer = new uint8_t[ENS160_RECORD_BLOCK_BYTES];
+	this->dirty = false;
+}
+
+ENS160RecordWriter::~ENS160RecordWriter()
+{
+	close();
+	delete[] this->buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// open()
+//
+// Creates the file, or picks up where it ends. Trailing bytes short of a
+// whole block, left by a write cut off part way, are overwritten.
+
+bool ENS160RecordWriter::open(const char *path)
+{
+	uint8_t headerPage[ENS160_RECORD_HEADER_BYTES];
+	ens160_record_header_t *header = (ens160_record_header_t *)headerPage;
+	ens160_record_footer_t *footer = (ens160_record_footer_t *)(this->buffer + ENS160_RECORD_FOOTER_OFFSET);
+	ens160_record_footer_t previous;
+	struct timespec now;
+	struct stat info;
+	uint64_t blocks;
+
+	close();
+
+	this->fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if( this->fd < 0 || fstat(this->fd, &info) < 0 )
+	{
+		close();
+		return false;
+	}
+
+	memset(this->buffer, 0, ENS160_RECORD_BLOCK_BYTES);
+	emptyFooter(footer);
+	this->block = 0;
+	this->blockRows = 0;
+	this->floorTime = 0;
+	this->rejected = 0;
+	this->dirty = false;
+
+	if( info.st_size < ENS160_RECORD_HEADER_BYTES )
+	{
+		memset(headerPage, 0, sizeof(headerPage));
+		memcpy(header->magic, ENS160_RECORD_MAGIC, sizeof(header->magic));
+		header->blockRows = ENS160_RECORD_BLOCK_ROWS;
+		header->blockBytes = ENS160_RECORD_BLOCK_BYTES;
+		clock_gettime(CLOCK_REALTIME, &now);
+		header->createdUs = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+		if( pwrite(this->fd, headerPage, sizeof(headerPage), 0) != (ssize_t)sizeof(headerPage) )
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	if( pread(this->fd, headerPage, sizeof(headerPage), 0) != (ssize_t)sizeof(headerPage) ||
+		memcmp(header->magic, ENS160_RECORD_MAGIC, sizeof(header->magic)) != 0 ||
+		header->blockRows != ENS160_RECORD_BLOCK_ROWS || header->blockBytes != ENS160_RECORD_BLOCK_BYTES )
+	{
+		close();
+		return false;
+	}
+
+	blocks = (uint64_t)(info.st_size - ENS160_RECORD_HEADER_BYTES) / ENS160_RECORD_BLOCK_BYTES;
+	if( blocks == 0 )
+		return true;
+
+	if( pread(this->fd, this->buffer, ENS160_RECORD_BLOCK_BYTES, blockOffset(blocks - 1)) != ENS160_RECORD_BLOCK_BYTES ||
+		footer->magic != ENS160_RECORD_BLOCK_MAGIC || footer->count > ENS160_RECORD_BLOCK_ROWS )
+	{
+		close();
+		return false;
+	}
+
+	if( footer->count < ENS160_RECORD_BLOCK_ROWS )
+	{
+		this->block = blocks - 1;
+		this->blockRows = this->block * ENS160_RECORD_BLOCK_ROWS;
+		if( this->block == 0 )
+			return true;
+
+		// The floor comes from the full block before the one continued
+		if( pread(this->fd, &previous, sizeof(previous), blockOffset(this->block - 1) + ENS160_RECORD_FOOTER_OFFSET)
+			!= (ssize_t)sizeof(previous) || previous.magic != ENS160_RECORD_BLOCK_MAGIC )
+		{
+			close();
+			return false;
+		}
+		this->floorTime = previous.maxTime;
+		return true;
+	}
+
+	this->floorTime = footer->maxTime;
+	this->block = blocks;
+	this->blockRows = blocks * ENS160_RECORD_BLOCK_ROWS;
+	memset(this->buffer, 0, ENS160_RECORD_BLOCK_BYTES);
+	emptyFooter(footer);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// append()
+//
+// A row older than the floor is counted and dropped, which is not an error:
+// true is returned all the same. false means the block could not be written.
+
+bool ENS160RecordWriter::append(const ens160_record_row_t *row)
+{
+	ens160_record_footer_t *footer = (ens160_record_footer_t *)(this->buffer + ENS160_RECORD_FOOTER_OFFSET);
+	uint64_t time = row->timeUs;
+	uint32_t i;
+
+	if( this->fd < 0 )
+		return false;
+
+	if( time < this->floorTime )
+	{
+		this->rejected++;
+		return true;
+	}
+
+	i = footer->count;
+
+	((uint64_t *)(this->buffer + ENS160_RECORD_TIME_OFFSET))[i] = time;
+	((uint16_t *)(this->buffer + ENS160_RECORD_SENSOR_OFFSET))[i] = row->sensor;
+	((uint16_t *)(this->buffer + ENS160_RECORD_TVOC_OFFSET))[i] = row->tvoc;
+	((uint16_t *)(this->buffer + ENS160_RECORD_ECO2_OFFSET))[i] = row->eco2;
+	this->buffer[ENS160_RECORD_AQI_OFFSET + i] = row->aqi;
+	this->buffer[ENS160_RECORD_STATUS_OFFSET + i] = row->status;
+
+	if( i == 0 || time < footer->minTime )
+		footer->minTime = time;
+	if( time > footer->maxTime )
+		footer->maxTime = time;
+	footer->sumTvoc += row->tvoc;
+	footer->sumEco2 += row->eco2;
+	footer->sumAqi += row->aqi;
+	if( row->sensor < footer->minSensor ) footer->minSensor = row->sensor;
+	if( row->sensor > footer->maxSensor ) footer->maxSensor = row->sensor;
+	if( row->tvoc < footer->minTvoc ) footer->minTvoc = row->tvoc;
+	if( row->tvoc > footer->maxTvoc ) footer->maxTvoc = row->tvoc;
+	if( row->eco2 < footer->minEco2 ) footer->minEco2 = row->eco2;
+	if( row->eco2 > footer->maxEco2 ) footer->maxEco2 = row->eco2;
+	if( row->aqi < footer->minAqi ) footer->minAqi = row->aqi;
+	if( row->aqi > footer->maxAqi ) footer->maxAqi = row->aqi;
+	footer->statusOr |= row->status;
+	footer->count = i + 1;
+
+	this->dirty = true;
+
+	if( footer->count < ENS160_RECORD_BLOCK_ROWS )
+		return true;
+
+	// Block full: write it out and start the next one
+	if( !flush() )
+		return false;
+
+	this->floorTime = footer->maxTime;
+	this->block++;
+	this->blockRows += ENS160_RECORD_BLOCK_ROWS;
+	memset(this->buffer, 0, ENS160_RECORD_BLOCK_BYTES);
+	emptyFooter(footer);
+
+	return true;
+}
+
+bool ENS160RecordWriter::flush()
+{
+	if( this->fd < 0 )
+		return false;
+
+	if( !this->dirty )
+		return true;
+
+	if( pwrite(this->fd, this->buffer, ENS160_RECORD_BLOCK_BYTES, blockOffset(this->block)) != ENS160_RECORD_BLOCK_BYTES )
+		return false;
+
+	this->dirty = false;
+
+	return true;
+}
+
+void ENS160RecordWriter::close()
+{
+	if( this->fd < 0 )
+		return;
+
+	flush();
+	::close(this->fd);
+	this->fd = -1;
+}
+
+uint64_t ENS160RecordWriter::getRowCount()
+{
+	return this->blockRows + ((ens160_record_footer_t *)(this->buffer + ENS160_RECORD_FOOTER_OFFSET))->count;
+}
+
+// Rows dropped for being older than an earlier block's newest row
+uint64_t ENS160RecordWriter::getRejectedCount()
+{
+	return this->rejected;
+}
+
+ENS160RecordReader::ENS160RecordReader()
+{
+	this->fd = -1;
+	this->map = 0;
+	this->size = 0;
+	this->blocks = 0;
+}
+
+ENS160RecordReader::~ENS160RecordReader()
+{
+	close();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// open()
+//
+// Maps the blocks the file holds now; rows appended later are not seen. A
+// last block without a valid footer, being written as the file was opened,
+// is left out.
+
+bool ENS160RecordReader::open(const char *path)
+{
+	const ens160_record_header_t *header;
+	struct stat info;
+	void *mapped;
+
+	close();
+
+	this->fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if( this->fd < 0 || fstat(this->fd, &info) < 0 || info.st_size < ENS160_RECORD_HEADER_BYTES )
+	{
+		close();
+		return false;
+	}
+
+	mapped = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, this->fd, 0);
+	if( mapped == MAP_FAILED )
+	{
+		close();
+		return false;
+	}
+
+	this->map = (const uint8_t *)mapped;
+	this->size = (size_t)info.st_size;
+	header = (const ens160_record_header_t *)this->map;
+
+	if( memcmp(header->magic, ENS160_RECORD_MAGIC, sizeof(header->magic)) != 0 ||
+		header->blockRows != ENS160_RECORD_BLOCK_ROWS || header->blockBytes != ENS160_RECORD_BLOCK_BYTES )
+	{
+		close();
+		return false;
+	}
+
+	this->blocks = (this->size - ENS160_RECORD_HEADER_BYTES) / ENS160_RECORD_BLOCK_BYTES;
+	if( this->blocks && getFooter(this->blocks - 1)->magic != ENS160_RECORD_BLOCK_MAGIC )
+		this->blocks--;
+
+	return true;
+}
+
+void ENS160RecordReader::close()
+{
+	if( this->map )
+		munmap((void *)this->map, this->size);
+	if( this->fd >= 0 )
+		::close(this->fd);
+
+	this->fd = -1;
+	this->map = 0;
+	this->size = 0;
+	this->blocks = 0;
+}
+
+uint64_t ENS160RecordReader::getBlockCount()
+{
+	return this->blocks;
+}
+
+const uint8_t *ENS160RecordReader::column(uint64_t block, size_t offset)
+{
+	return this->map + blockOffset(block) + offset;
+}
+
+const ens160_record_footer_t *ENS160RecordReader::getFooter(uint64_t block)
+{
+	return (const ens160_record_footer_t *)column(block, ENS160_RECORD_FOOTER_OFFSET);
+}
+
+void ENS160RecordReader::findBlocks(uint64_t fromUs, uint64_t toUs, uint64_t *first, uint64_t *end)
+{
+	uint64_t low, high, mid;
+
+	// First block ending at or after fromUs
+	low = 0;
+	high = this->blocks;
+	while( low < high )
+	{
+		mid = low + (high - low) / 2;
+		if( getFooter(mid)->maxTime < fromUs )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*first = low;
+
+	// First block starting after toUs
+	high = this->blocks;
+	while( low < high )
+	{
+		mid = low + (high - low) / 2;
+		if( getFooter(mid)->minTime <= toUs )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*end = low;
+}
+
+const uint64_t *ENS160RecordReader::getTimes(uint64_t block)
+{
+	return (const uint64_t *)column(block, ENS160_RECORD_TIME_OFFSET);
+}
+
+const uint16_t *ENS160RecordReader::getSensors(uint64_t block)
+{
+	return (const uint16_t *)column(block, ENS160_RECORD_SENSOR_OFFSET);
+}
+
+const uint16_t *ENS160RecordReader::getTVOC(uint64_t block)
+{
+	return (const uint16_t *)column(block, ENS160_RECORD_TVOC_OFFSET);
+}
+
+const uint16_t *ENS160RecordReader::getECO2(uint64_t block)
+{
+	return (const uint16_t *)column(block, ENS160_RECORD_ECO2_OFFSET);
+}
+
+const uint8_t *ENS160RecordReader::getAQI(uint64_t block)
+{
+	return column(block, ENS160_RECORD_AQI_OFFSET);
+}
+
+const uint8_t *ENS160RecordReader::getStatus(uint64_t block)
+{
+	return column(block, ENS160_RECORD_STATUS_OFFSET);
+}
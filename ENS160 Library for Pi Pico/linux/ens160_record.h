@@ -0,0 +1,153 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENS160_RECORD_MAGIC       "ENS160R1"
+#define ENS160_RECORD_BLOCK_MAGIC 0x314B4C42 // "BLK1"
+
+// Rows per block and on-disk sizes. Header and blocks are multiples of the page
+// size so that every column of a mapped file starts page aligned, and the
+// footer has a page to itself so that going through the block index touches
+// one page per block.
+#define ENS160_RECORD_BLOCK_ROWS   4096
+#define ENS160_RECORD_HEADER_BYTES 4096
+#define ENS160_RECORD_BLOCK_BYTES  (17 * 4096)
+
+// Sensor id of a row: bus number in the high byte, I2C address in the low one
+#define ENS160_RECORD_SENSOR(bus, address) ((uint16_t)(((bus) << 8) | (address)))
+
+// One sample, as appended and as listed
+typedef struct
+{
+	uint64_t timeUs; // wall clock, us since 1970
+	uint16_t sensor;
+	uint8_t status;
+	uint8_t aqi;
+	uint16_t tvoc;
+	uint16_t eco2;
+}	ens160_record_row_t;
+
+typedef struct
+{
+	char magic[8];
+	uint32_t blockRows;
+	uint32_t blockBytes;
+	uint64_t createdUs;
+}	ens160_record_header_t;
+
+// Block index, stored at the end of each block. Answers whether a block can
+// be skipped, and range aggregates over whole blocks, without its columns.
+typedef struct
+{
+	uint32_t magic;
+	uint32_t count;
+	uint64_t minTime;
+	uint64_t maxTime;
+	uint64_t sumTvoc;
+	uint64_t sumEco2;
+	uint32_t sumAqi;
+	uint16_t minSensor;
+	uint16_t maxSensor;
+	uint16_t minTvoc;
+	uint16_t maxTvoc;
+	uint16_t minEco2;
+	uint16_t maxEco2;
+	uint8_t minAqi;
+	uint8_t maxAqi;
+	uint8_t statusOr;  // every status bit seen in the block
+	uint8_t reserved[5];
+}	ens160_record_footer_t;
+
+// Block layout: one column after the other, then the footer
+#define ENS160_RECORD_TIME_OFFSET   0
+#define ENS160_RECORD_SENSOR_OFFSET (ENS160_RECORD_TIME_OFFSET + 8 * ENS160_RECORD_BLOCK_ROWS)
+#define ENS160_RECORD_TVOC_OFFSET   (ENS160_RECORD_SENSOR_OFFSET + 2 * ENS160_RECORD_BLOCK_ROWS)
+#define ENS160_RECORD_ECO2_OFFSET   (ENS160_RECORD_TVOC_OFFSET + 2 * ENS160_RECORD_BLOCK_ROWS)
+#define ENS160_RECORD_AQI_OFFSET    (ENS160_RECORD_ECO2_OFFSET + 2 * ENS160_RECORD_BLOCK_ROWS)
+#define ENS160_RECORD_STATUS_OFFSET (ENS160_RECORD_AQI_OFFSET + ENS160_RECORD_BLOCK_ROWS)
+#define ENS160_RECORD_FOOTER_OFFSET (ENS160_RECORD_STATUS_OFFSET + ENS160_RECORD_BLOCK_ROWS)
+
+static_assert(ENS160_RECORD_FOOTER_OFFSET + sizeof(ens160_record_footer_t) <= ENS160_RECORD_BLOCK_BYTES,
+	"block columns and footer must fit the block");
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160RecordWriter / ENS160RecordReader
+//
+// Session recordings in a columnar file: a header, then fixed size blocks of
+// ENS160_RECORD_BLOCK_ROWS rows, each block holding the time, sensor, TVOC,
+// eCO2, AQI and status columns in native little endian order followed by a
+// footer with the count, minimum, maximum and sums of its rows.
+//
+// Rows are stored with the time they are given. Within a block they may be
+// out of order, as samples from different buses read microseconds apart can
+// reach the writer, but no row may be older than the newest row of an earlier
+// block; one that is, from unsorted input or a clock stepped back, is rejected
+// and counted instead of being stored with a time it did not have. As block
+// time ranges are then ordered, a reader finds the blocks of a time range by
+// binary search on the footers, skips those no row of which can match from
+// the footer alone, aggregates the ones that lie wholly inside the range from
+// the footer alone, and only reads the columns it needs of the rest, straight
+// from the mapping.
+//
+// The block being filled is kept in memory and written out whole, footer
+// included, when it is full or flush() is called, so a file is readable at any
+// time and a crash loses at most the rows since the last flush. Opening an
+// existing file continues its last block if that is not full yet.
+
+class ENS160RecordWriter {
+    public:
+        ENS160RecordWriter();
+        ~ENS160RecordWriter();
+        bool open(const char *path);
+        bool append(const ens160_record_row_t *row);
+        bool flush();
+        void close();
+        uint64_t getRowCount();
+        uint64_t getRejectedCount();
+
+    private:
+        int fd;
+        uint64_t block;     // index of the block being filled
+        uint64_t blockRows; // rows in full blocks before it
+        uint64_t floorTime; // newest time in the full blocks, the oldest a row may have
+        uint64_t rejected;
+        uint8_t *buffer;    // the block being filled, ENS160_RECORD_BLOCK_BYTES
+        bool dirty;
+};
+
+class ENS160RecordReader {
+    public:
+        ENS160RecordReader();
+        ~ENS160RecordReader();
+        bool open(const char *path);
+        void close();
+
+        uint64_t getBlockCount();
+        const ens160_record_footer_t *getFooter(uint64_t block);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // findBlocks()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  fromUs       first time of the range
+        //  toUs         last time of the range, inclusive
+        //  first        first block holding rows of the range
+        //  end          one past the last such block; equal to first if there are none
+
+        void findBlocks(uint64_t fromUs, uint64_t toUs, uint64_t *first, uint64_t *end);
+
+        // Columns of one block, getFooter(block)->count rows long
+        const uint64_t *getTimes(uint64_t block);
+        const uint16_t *getSensors(uint64_t block);
+        const uint16_t *getTVOC(uint64_t block);
+        const uint16_t *getECO2(uint64_t block);
+        const uint8_t *getAQI(uint64_t block);
+        const uint8_t *getStatus(uint64_t block);
+
+    private:
+        int fd;
+        const uint8_t *map;
+        size_t size;
+        uint64_t blocks;
+        const uint8_t *column(uint64_t block, size_t offset);
+};
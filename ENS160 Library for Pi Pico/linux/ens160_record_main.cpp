@@ -0,0 +1,158 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pico/time.h"
+#include "ens160_i2c_regs.h"
+#include "ens160_record.h"
+#include "ens160_shm.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Records a session to a columnar file (see ens160_record.h)
+//
+// Follows the shared memory ring of a running gateway (ens160_gateway -m) and
+// appends every frame to the file, flushing the open block every
+// RECORD_FLUSH_US and on SIGINT/SIGTERM. With -i it imports gateway text
+// output from stdin instead, its times taken as seconds since 1970, and the
+// status rebuilt from the validity.
+//
+//  ens160_record [-n shm-name | -i] file
+
+#define RECORD_POLL_US  100000
+#define RECORD_FLUSH_US (10ULL * 1000000ULL)
+
+static volatile sig_atomic_t stopping;
+
+static void stop(int signal)
+{
+	(void)signal;
+	stopping = 1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n shm-name | -i] file\n", name);
+	exit(1);
+}
+
+static bool importText(ENS160RecordWriter *writer)
+{
+	ens160_record_row_t row;
+	unsigned bus, address, validity, aqi, tvoc, eco2;
+	char line[128];
+	double seconds;
+
+	while( fgets(line, sizeof(line), stdin) )
+	{
+		if( sscanf(line, "%lf %u %x %u %u %u %u", &seconds, &bus, &address, &validity, &aqi, &tvoc, &eco2) != 7 )
+			continue;
+
+		row.timeUs = (uint64_t)(seconds * 1e6);
+		row.sensor = ENS160_RECORD_SENSOR(bus, address);
+		row.status = (uint8_t)((validity << 2) & SFE_ENS160_STATUS_VALIDITY);
+		row.aqi = (uint8_t)aqi;
+		row.tvoc = (uint16_t)tvoc;
+		row.eco2 = (uint16_t)eco2;
+
+		if( !writer->append(&row) )
+			return false;
+	}
+
+	return true;
+}
+
+static bool followRing(ENS160RecordWriter *writer, const char *name)
+{
+	ENS160ShmReader reader;
+	ens160_shm_sample_t sample;
+	ens160_record_row_t row;
+	uint64_t nextFlush, lost = 0;
+	uint32_t reattaches = 0;
+
+	if( !reader.attach(name) )
+	{
+		fprintf(stderr, "%s: no sample ring\n", name);
+		return false;
+	}
+
+	nextFlush = time_us_64() + RECORD_FLUSH_US;
+
+	while( !stopping )
+	{
+		while( reader.read(&sample) )
+		{
+			row.timeUs = reader.getEpoch() + sample.readUs;
+			row.sensor = ENS160_RECORD_SENSOR(sample.bus, sample.address);
+			row.status = sample.status;
+			row.aqi = sample.aqi;
+			row.tvoc = sample.tvoc;
+			row.eco2 = sample.eco2;
+
+			if( !writer->append(&row) )
+				return false;
+		}
+
+		if( reader.getLost() != lost )
+		{
+			fprintf(stderr, "%llu frames lost\n", (unsigned long long)(reader.getLost() - lost));
+			lost = reader.getLost();
+		}
+
+		if( reader.getReattachCount() != reattaches )
+		{
+			fprintf(stderr, "%s: gateway restarted, following the new ring\n", name);
+			reattaches = reader.getReattachCount();
+		}
+
+		if( time_us_64() >= nextFlush )
+		{
+			if( !writer->flush() )
+				return false;
+			nextFlush += RECORD_FLUSH_US;
+		}
+
+		sleep_us(RECORD_POLL_US);
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	ENS160RecordWriter writer;
+	const char *name = ENS160_SHM_DEFAULT_NAME;
+	bool import = false;
+	bool ok;
+	int opt;
+
+	while( (opt = getopt(argc, argv, "n:i")) != -1 )
+	{
+		switch( opt )
+		{
+			case 'n': name = optarg; break;
+			case 'i': import = true; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if( optind != argc - 1 )
+		usage(argv[0]);
+
+	if( !writer.open(argv[optind]) )
+	{
+		fprintf(stderr, "%s: cannot open recording\n", argv[optind]);
+		return 1;
+	}
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	ok = import ? importText(&writer) : followRing(&writer, name);
+	ok = writer.flush() && ok;
+
+	fprintf(stderr, "%llu rows recorded\n", (unsigned long long)writer.getRowCount());
+	if( writer.getRejectedCount() )
+		fprintf(stderr, "%llu rows older than already recorded ones rejected\n", (unsigned long long)writer.getRejectedCount());
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,403 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ens160_shm.h"
+
+static size_t ringSize(uint32_t slots)
+{
+	return sizeof(ens160_shm_header_t) + (size_t)slots * sizeof(ens160_shm_slot_t);
+}
+
+ENS160ShmWriter::ENS160ShmWriter()
+{
+	this->fd = -1;
+	this->size = 0;
+	this->header = 0;
+	this->slots = 0;
+}
+
+ENS160ShmWriter::~ENS160ShmWriter()
+{
+	close();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// retire()
+//
+// Marks the ring under name, if there is one, as replaced. Clearing the magic
+// first keeps readers from attaching to it again once they see the bump. The
+// object is only unlinked, never truncated, so readers that still have it
+// mapped can go on reading it safely until they move over. Returns the
+// generation the new ring is to have.
+
+static uint32_t retire(const char *name)
+{
+	ens160_shm_header_t *old;
+	struct stat info;
+	uint32_t generation = 1;
+	void *map;
+	int fd;
+
+	fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+	if( fd < 0 )
+		return generation;
+
+	if( fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(ens160_shm_header_t) )
+	{
+		map = mmap(0, sizeof(ens160_shm_header_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if( map != MAP_FAILED )
+		{
+			old = (ens160_shm_header_t *)map;
+			old->magic.store(0, std::memory_order_relaxed);
+			generation = old->generation.load(std::memory_order_relaxed) + 1;
+			old->generation.store(generation, std::memory_order_release);
+			munmap(map, sizeof(ens160_shm_header_t));
+		}
+	}
+
+	::close(fd);
+	shm_unlink(name);
+
+	return generation;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// create()
+//
+// A new object starts out zeroed, so every slot starts with sequence 0, which
+// no sample number matches. The magic goes in last: a reader that attaches
+// before then is turned away instead of seeing a half set up ring.
+
+bool ENS160ShmWriter::create(const char *name, uint32_t slots)
+{
+	uint32_t generation;
+	void *map;
+
+	close();
+
+	if( slots == 0 )
+		return false;
+
+	generation = retire(name);
+
+	this->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+	if( this->fd < 0 )
+		return false;
+
+	this->size = ringSize(slots);
+
+	if( ftruncate(this->fd, (off_t)this->size) < 0 )
+	{
+		close();
+		return false;
+	}
+
+	map = mmap(0, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+	if( map == MAP_FAILED )
+	{
+		close();
+		return false;
+	}
+
+	this->header = (ens160_shm_header_t *)map;
+	this->slots = (ens160_shm_slot_t *)(this->header + 1);
+	this->header->slotCount = slots;
+	this->header->slotSize = sizeof(ens160_shm_slot_t);
+	this->header->generation.store(generation, std::memory_order_relaxed);
+	this->header->magic.store(ENS160_SHM_MAGIC, std::memory_order_release);
+
+	return true;
+}
+
+void ENS160ShmWriter::close()
+{
+	if( this->header )
+		munmap(this->header, this->size);
+	if( this->fd >= 0 )
+		::close(this->fd);
+
+	this->fd = -1;
+	this->header = 0;
+	this->slots = 0;
+}
+
+void ENS160ShmWriter::publish(const ens160_shm_sample_t *sample)
+{
+	ens160_shm_slot_t *slot;
+	uint64_t n;
+
+	if( this->header == 0 )
+		return;
+
+	n = this->header->head.fetch_add(1, std::memory_order_relaxed);
+	slot = &this->slots[n % this->header->slotCount];
+
+	slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot->sample = *sample;
+	slot->sequence.store(2 * n + 2, std::memory_order_release);
+}
+
+// Lets readers turn sample times into wall clock time
+void ENS160ShmWriter::setEpoch(uint64_t epochUs)
+{
+	if( this->header )
+		this->header->epochUs = epochUs;
+}
+
+uint64_t ENS160ShmWriter::getPublished()
+{
+	return this->header ? this->header->head.load(std::memory_order_relaxed) : 0;
+}
+
+ENS160ShmReader::ENS160ShmReader()
+{
+	this->fd = -1;
+	this->size = 0;
+	this->header = 0;
+	this->slots = 0;
+	this->slotCount = 0;
+	this->generation = 0;
+	this->cursor = 0;
+	this->head = 0;
+	this->lost = 0;
+	this->reattaches = 0;
+	this->name[0] = 0;
+}
+
+ENS160ShmReader::~ENS160ShmReader()
+{
+	detach();
+}
+
+bool ENS160ShmReader::attach(const char *name)
+{
+	const ens160_shm_header_t *mapped;
+	struct stat info;
+	void *map;
+
+	detach();
+
+	if( strlen(name) > NAME_MAX )
+		return false;
+
+	this->fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if( this->fd < 0 )
+		return false;
+
+	if( fstat(this->fd, &info) < 0 || (size_t)info.st_size < sizeof(ens160_shm_header_t) )
+	{
+		detach();
+		return false;
+	}
+
+	map = mmap(0, (size_t)info.st_size, PROT_READ, MAP_SHARED, this->fd, 0);
+	if( map == MAP_FAILED )
+	{
+		detach();
+		return false;
+	}
+
+	mapped = (const ens160_shm_header_t *)map;
+	this->header = mapped;
+	this->size = (size_t)info.st_size;
+
+	if( mapped->magic.load(std::memory_order_acquire) != ENS160_SHM_MAGIC ||
+		mapped->slotSize != sizeof(ens160_shm_slot_t) || mapped->slotCount == 0 ||
+		ringSize(mapped->slotCount) > this->size )
+	{
+		detach();
+		return false;
+	}
+
+	this->slots = (const ens160_shm_slot_t *)(mapped + 1);
+	this->slotCount = mapped->slotCount;
+	this->generation = mapped->generation.load(std::memory_order_relaxed);
+	this->cursor = mapped->head.load(std::memory_order_acquire);
+	this->head = this->cursor;
+	this->lost = 0;
+	this->reattaches = 0;
+	strcpy(this->name, name);
+
+	return true;
+}
+
+void ENS160ShmReader::detach()
+{
+	if( this->header )
+		munmap((void *)this->header, this->size);
+	if( this->fd >= 0 )
+		::close(this->fd);
+
+	this->fd = -1;
+	this->header = 0;
+	this->slots = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// reattach()
+//
+// Moves to the ring that has replaced this one. The old mapping is kept until
+// the new ring can be attached, so a reader that gets there before the new
+// writer has finished creating it simply tries again on the next peek().
+// Everything in the new ring is new to the reader, so it is read from its
+// first sample. Samples lost so far carry over.
+
+bool ENS160ShmReader::reattach()
+{
+	ENS160ShmReader next;
+
+	if( !next.attach(this->name) || next.generation == this->generation )
+		return false;
+
+	detach();
+	this->fd = next.fd;
+	this->size = next.size;
+	this->header = next.header;
+	this->slots = next.slots;
+	this->slotCount = next.slotCount;
+	this->generation = next.generation;
+	this->cursor = 0;
+	this->head = 0;
+	this->reattaches++;
+
+	next.fd = -1;
+	next.header = 0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// peek()
+//
+// head is only read again once the reader has caught up with the value it
+// last saw, to keep the readers off the writers' cache line; the generation,
+// on the same line, is checked then and while waiting for a slot. A head behind the cursor, which only
+// a ring reset under the reader can produce, resyncs the cursor to it. A
+// reader more than a ring behind jumps to the oldest sample still there. A
+// slot whose sequence is below the cursor's has been claimed but not yet
+// written, so the reader waits for it rather than skip it; one above has been
+// overwritten.
+
+const ens160_shm_sample_t *ENS160ShmReader::peek()
+{
+	const ens160_shm_slot_t *slot;
+	uint64_t sequence;
+
+	if( this->header == 0 )
+		return 0;
+
+	for( ;; )
+	{
+		if( this->cursor == this->head )
+		{
+			if( this->header->generation.load(std::memory_order_relaxed) != this->generation && !reattach() )
+				return 0;
+
+			this->head = this->header->head.load(std::memory_order_acquire);
+			if( this->head < this->cursor )
+				this->cursor = this->head;
+			if( this->cursor == this->head )
+				return 0;
+		}
+
+		if( this->head - this->cursor > this->slotCount )
+		{
+			this->lost += this->head - this->slotCount - this->cursor;
+			this->cursor = this->head - this->slotCount;
+		}
+
+		slot = &this->slots[this->cursor % this->slotCount];
+		sequence = slot->sequence.load(std::memory_order_acquire);
+
+		if( sequence == 2 * this->cursor + 2 )
+			return &slot->sample;
+
+		if( sequence < 2 * this->cursor + 2 )
+		{
+			// A writer that went away mid-sample never finishes it
+			if( this->header->generation.load(std::memory_order_relaxed) != this->generation && reattach() )
+				continue;
+			return 0;
+		}
+
+		// Overwritten: see how far the writers have got before skipping ahead
+		this->head = this->header->head.load(std::memory_order_acquire);
+		if( this->head < this->cursor )
+			this->cursor = this->head;
+		else if( this->head - this->cursor <= this->slotCount )
+		{
+			this->lost++;
+			this->cursor++;
+		}
+	}
+}
+
+bool ENS160ShmReader::release()
+{
+	const ens160_shm_slot_t *slot;
+	bool intact;
+
+	if( this->header == 0 )
+		return false;
+
+	slot = &this->slots[this->cursor % this->slotCount];
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	intact = slot->sequence.load(std::memory_order_relaxed) == 2 * this->cursor + 2;
+
+	if( !intact )
+		this->lost++;
+	this->cursor++;
+
+	return intact;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// read()
+//
+// Copies the next intact sample, skipping any rewritten while being copied.
+
+bool ENS160ShmReader::read(ens160_shm_sample_t *sample)
+{
+	const ens160_shm_sample_t *next;
+
+	while( (next = peek()) != 0 )
+	{
+		*sample = *next;
+		if( release() )
+			return true;
+	}
+
+	return false;
+}
+
+uint64_t ENS160ShmReader::getEpoch()
+{
+	return this->header ? this->header->epochUs : 0;
+}
+
+uint64_t ENS160ShmReader::getLag()
+{
+	uint64_t head;
+
+	if( this->header == 0 )
+		return 0;
+
+	head = this->header->head.load(std::memory_order_relaxed);
+
+	return head > this->cursor ? head - this->cursor : 0;
+}
+
+uint64_t ENS160ShmReader::getLost()
+{
+	return this->lost;
+}
+
+// Times the reader has followed a restarted writer to its new ring
+uint32_t ENS160ShmReader::getReattachCount()
+{
+	return this->reattaches;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define ENS160_SHM_MAGIC         0x31484545 // "EEH1", written once the ring is ready
+#define ENS160_SHM_DEFAULT_NAME  "/ens160"
+#define ENS160_SHM_DEFAULT_SLOTS 4096
+
+// One frame as published by the gateway
+typedef struct
+{
+	uint64_t readUs;   // gateway clock time of the read
+	uint64_t updateUs; // estimated device update time, same clock
+	uint8_t bus;
+	uint8_t address;
+	uint8_t status;
+	uint8_t validity;
+	uint8_t aqi;
+	uint8_t reserved;
+	uint16_t tvoc;
+	uint16_t eco2;
+}	ens160_shm_sample_t;
+
+// Shared memory layout: this header, then slotCount slots
+typedef struct
+{
+	std::atomic<uint32_t> magic;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	std::atomic<uint32_t> generation; // bumped in a ring when a new one replaces it
+	uint64_t epochUs;           // wall clock time (us since 1970) at sample time 0
+	std::atomic<uint64_t> head; // samples claimed by writers so far
+}	ens160_shm_header_t;
+
+typedef struct
+{
+	std::atomic<uint64_t> sequence; // 2n+1 while sample n is written, 2n+2 once done
+	ens160_shm_sample_t sample;
+}	ens160_shm_slot_t;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs lock-free 64 bit atomics");
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160ShmWriter / ENS160ShmReader
+//
+// A ring of samples in a POSIX shared memory object, for consumers on the same
+// host. Any number of reader processes map it read-only and follow it with
+// their own cursor; the writer never waits for them and they never make a
+// system call or take a lock after attaching, except to follow a restarted
+// writer to its new ring.
+//
+// Sample n goes to slot n % slotCount. A writer claims n by incrementing head,
+// marks the slot odd while writing it and even once it is complete, so several
+// threads may publish at once. A reader uses a sample in place and then checks
+// that its sequence is unchanged; a sample rewritten meanwhile, or one already
+// overwritten when the reader gets to it, is counted as lost and skipped. This
+// is the same protocol as the mbed SampleBus, with the cursors kept by the
+// readers themselves so that the writer does not need to know about them.
+//
+// A writer starting up never resets a ring in place, as readers may still
+// have it mapped. It retires the old one, clearing its magic and bumping its
+// generation, unlinks it and creates a new one with the next generation under
+// the same name. Readers notice the bump when they next look at head and
+// attach to the new ring, reading it from its first sample.
+
+class ENS160ShmWriter {
+    public:
+        ENS160ShmWriter();
+        ~ENS160ShmWriter();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // create()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  name         shared memory object name, e.g. ENS160_SHM_DEFAULT_NAME
+        //  slots        ring size in samples
+        //  retval       true if the ring is ready; an existing one is retired
+
+        bool create(const char *name, uint32_t slots);
+        void close();
+        void setEpoch(uint64_t epochUs);
+        void publish(const ens160_shm_sample_t *sample);
+        uint64_t getPublished();
+
+    private:
+        int fd;
+        size_t size;
+        ens160_shm_header_t *header;
+        ens160_shm_slot_t *slots;
+};
+
+class ENS160ShmReader {
+    public:
+        ENS160ShmReader();
+        ~ENS160ShmReader();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // attach()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  name         shared memory object name used by the writer
+        //  retval       true if attached; reading starts with the next sample published
+
+        bool attach(const char *name);
+        void detach();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // peek() / release()
+        // peek() returns the next sample in place, or NULL if there is none yet.
+        // release() moves past it and returns false if it was rewritten while in
+        // use, in which case whatever was read from it must be discarded.
+
+        const ens160_shm_sample_t *peek();
+        bool release();
+
+        bool read(ens160_shm_sample_t *sample);
+        uint64_t getEpoch();
+        uint64_t getLag();
+        uint64_t getLost();
+        uint32_t getReattachCount();
+
+    private:
+        int fd;
+        size_t size;
+        const ens160_shm_header_t *header;
+        const ens160_shm_slot_t *slots;
+        uint32_t slotCount;
+        uint32_t generation; // of the ring attached to
+        uint64_t cursor;
+        uint64_t head;   // head as last read from the ring
+        uint64_t lost;
+        uint32_t reattaches;
+        char name[NAME_MAX + 1];
+        bool reattach();
+};
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <chrono>
+#include "ens160_shm.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// Shared memory ring benchmark
+//
+// One writer publishes samples as fast as it can while reader processes, each
+// attached before the first sample, consume them in place. Every sample
+// carries its own number in two fields; a reader checks they agree on every
+// sample it keeps, so a torn read that slipped past the sequence check would
+// show up as torn. A reader that cannot keep up loses samples rather than
+// slowing the writer. One JSON object per process is printed on its own line.
+//
+//  ens160_shm_bench [samples] [readers] [slots]
+
+#define SHM_BENCH_SAMPLES 10000000
+#define SHM_BENCH_READERS 2
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static void runReader(const char *name, uint32_t id, uint64_t samples, int readyFd)
+{
+	const ens160_shm_sample_t *sample;
+	ENS160ShmReader reader;
+	bench_clock_t::time_point start, stop;
+	uint64_t consumed = 0;
+	uint64_t torn = 0;
+	bool first = true;
+	bool agree;
+	char ready = 1;
+
+	if( !reader.attach(name) || write(readyFd, &ready, 1) != 1 )
+		_exit(1);
+
+	while( consumed + reader.getLost() < samples )
+	{
+		// Give the CPU up when caught up, which matters on small hosts
+		sample = reader.peek();
+		if( sample == 0 )
+		{
+			sched_yield();
+			continue;
+		}
+
+		if( first )
+		{
+			start = bench_clock_t::now();
+			first = false;
+		}
+
+		agree = sample->readUs == sample->updateUs;
+		if( reader.release() )
+		{
+			consumed++;
+			torn += !agree;
+		}
+	}
+
+	stop = bench_clock_t::now();
+
+	printf("{\"benchmark\":\"shm_reader\",\"reader\":%u,\"consumed\":%llu,\"lost\":%llu,\"torn\":%llu,"
+		"\"ns_per_sample\":%.1f}\n", id, (unsigned long long)consumed, (unsigned long long)reader.getLost(),
+		(unsigned long long)torn, std::chrono::duration<double, std::nano>(stop - start).count() / samples);
+	fflush(stdout);
+	_exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t samples = argc > 1 ? strtoull(argv[1], 0, 0) : SHM_BENCH_SAMPLES;
+	uint32_t readers = argc > 2 ? strtoul(argv[2], 0, 0) : SHM_BENCH_READERS;
+	uint32_t slots = argc > 3 ? strtoul(argv[3], 0, 0) : ENS160_SHM_DEFAULT_SLOTS;
+	bench_clock_t::time_point start, stop;
+	ens160_shm_sample_t sample = {};
+	ENS160ShmWriter writer;
+	char name[64];
+	int readyFds[2];
+	uint64_t n;
+	uint32_t i;
+	char ready;
+
+	snprintf(name, sizeof(name), "/ens160_bench_%d", (int)getpid());
+
+	if( samples == 0 || !writer.create(name, slots) || pipe(readyFds) < 0 )
+	{
+		fprintf(stderr, "cannot create %s\n", name);
+		return 1;
+	}
+
+	fflush(stdout);
+	for( i = 0; i < readers; i++ )
+		if( fork() == 0 )
+			runReader(name, i, samples, readyFds[1]);
+
+	for( i = 0; i < readers; i++ )
+		if( read(readyFds[0], &ready, 1) != 1 )
+			break;
+
+	start = bench_clock_t::now();
+	for( n = 0; n < samples; n++ )
+	{
+		sample.readUs = n;
+		sample.updateUs = n;
+		sample.eco2 = (uint16_t)n;
+		writer.publish(&sample);
+	}
+	stop = bench_clock_t::now();
+
+	printf("{\"benchmark\":\"shm_writer\",\"samples\":%llu,\"slots\":%u,\"readers\":%u,\"ns_per_sample\":%.1f}\n",
+		(unsigned long long)samples, slots, readers,
+		std::chrono::duration<double, std::nano>(stop - start).count() / samples);
+	fflush(stdout);
+
+	while( wait(0) > 0 )
+		;
+
+	writer.close();
+	shm_unlink(name);
+
+	return 0;
+}
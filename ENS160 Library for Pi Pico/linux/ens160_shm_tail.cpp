@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <unistd.h>
+#include "ens160_shm.h"
+
+// Prints the frames a running gateway publishes (ens160_gateway -m), in the
+// gateway's own output format. Checks for new ones every POLL_US when idle.
+//
+//  ens160_shm_tail [shm-name]
+
+#define POLL_US 10000
+
+int main(int argc, char **argv)
+{
+	const char *name = argc > 1 ? argv[1] : ENS160_SHM_DEFAULT_NAME;
+	const ens160_shm_sample_t *sample;
+	ENS160ShmReader reader;
+	uint64_t lost = 0;
+
+	if( !reader.attach(name) )
+	{
+		fprintf(stderr, "%s: no sample ring\n", name);
+		return 1;
+	}
+
+	for( ;; )
+	{
+		while( (sample = reader.peek()) != 0 )
+		{
+			printf("%.3f %u 0x%02x %u %u %u %u\n", sample->readUs / 1e6, sample->bus, sample->address,
+				sample->validity, sample->aqi, sample->tvoc, sample->eco2);
+			reader.release();
+		}
+
+		if( reader.getLost() != lost )
+		{
+			fprintf(stderr, "%llu frames lost\n", (unsigned long long)(reader.getLost() - lost));
+			lost = reader.getLost();
+		}
+
+		fflush(stdout);
+		usleep(POLL_US);
+	}
+}
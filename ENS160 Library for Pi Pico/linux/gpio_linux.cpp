@@ -0,0 +1,136 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "pico/time.h"
+#include "gpio_linux.h"
+
+#define GPIO_LINUX_CONSUMER "ens160"
+
+// Events drained per read() call
+#define GPIO_LINUX_EVENT_BATCH 16
+
+static int sysOpen(const char *path, int flags)
+{
+	return open(path, flags);
+}
+
+static int sysIoctl(int fd, unsigned long request, void *arg)
+{
+	return ioctl(fd, request, arg);
+}
+
+static int sysClose(int fd)
+{
+	return close(fd);
+}
+
+static const i2c_linux_ops_t sysOps = { sysOpen, sysIoctl, sysClose };
+static const i2c_linux_ops_t *ops = &sysOps;
+
+// Chip descriptors, opened on first use and kept for further requests
+static int chips[GPIO_LINUX_CHIPS];
+static bool chipOpened[GPIO_LINUX_CHIPS];
+static pthread_mutex_t chipsLock = PTHREAD_MUTEX_INITIALIZER;
+
+void gpio_linux_set_ops(const i2c_linux_ops_t *newOps)
+{
+	ops = newOps ? newOps : &sysOps;
+}
+
+int gpio_linux_request_edges(uint chip, uint line, bool falling)
+{
+	struct gpio_v2_line_request request;
+	char path[32];
+	int flags;
+
+	if( chip >= GPIO_LINUX_CHIPS )
+		return -1;
+
+	pthread_mutex_lock(&chipsLock);
+	if( !chipOpened[chip] )
+	{
+		snprintf(path, sizeof(path), "/dev/gpiochip%u", chip);
+		chips[chip] = ops->open(path, O_RDWR | O_CLOEXEC);
+		chipOpened[chip] = true;
+	}
+	pthread_mutex_unlock(&chipsLock);
+
+	if( chips[chip] < 0 )
+		return -1;
+
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = line;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | 
+		(falling ? GPIO_V2_LINE_FLAG_EDGE_FALLING : GPIO_V2_LINE_FLAG_EDGE_RISING);
+	strncpy(request.consumer, GPIO_LINUX_CONSUMER, sizeof(request.consumer) - 1);
+
+	if( ops->ioctl(chips[chip], GPIO_V2_GET_LINE_IOCTL, &request) < 0 )
+		return -1;
+
+	flags = fcntl(request.fd, F_GETFL);
+	fcntl(request.fd, F_SETFL, flags | O_NONBLOCK);
+
+	return request.fd;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// toTimeUs()
+//
+// Edge timestamps are on CLOCK_MONOTONIC, as is time_us_64(), counted from a
+// later origin. The edge's age is taken on the monotonic clock and subtracted
+// from time_us_64() read just before it.
+
+static uint64_t toTimeUs(uint64_t timestampNs)
+{
+	struct timespec ts;
+	uint64_t now = time_us_64();
+	uint64_t monotonicUs;
+	uint64_t age = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	monotonicUs = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	if( monotonicUs > timestampNs / 1000 )
+		age = monotonicUs - timestampNs / 1000;
+
+	return now > age ? now - age : 0;
+}
+
+uint32_t gpio_linux_read_edges(int fd, uint64_t *edgeUs)
+{
+	struct gpio_v2_line_event events[GPIO_LINUX_EVENT_BATCH];
+	uint64_t newestNs = 0;
+	uint32_t count = 0;
+	uint32_t batch;
+	ssize_t len;
+
+	do
+	{
+		len = read(fd, events, sizeof(events));
+		if( len > 0 )
+		{
+			batch = (uint32_t)(len / sizeof(events[0]));
+			count += batch;
+			if( batch )
+				newestNs = events[batch - 1].timestamp_ns;
+		}
+	}
+	while( len == (ssize_t)sizeof(events) );
+
+	if( count )
+		*edgeUs = toTimeUs(newestNs);
+
+	return count;
+}
+
+void gpio_linux_release(int fd)
+{
+	if( fd >= 0 )
+		close(fd);
+}
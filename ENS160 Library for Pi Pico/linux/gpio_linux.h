@@ -0,0 +1,38 @@
+#pragma once
+#include "i2c_linux.h"
+
+#define GPIO_LINUX_CHIPS 8
+
+//////////////////////////////////////////////////////////////////////////////////
+// GPIO line events through the character device (/dev/gpiochipN, v2 uAPI)
+//
+// Each requested line gets its own file descriptor that becomes readable when
+// an edge has been seen, so INTn pins can be waited on with poll() or epoll
+// alongside anything else. The kernel timestamps and queues the edges, so one
+// that arrives while its reader is busy is not lost. The chip is reached
+// through the same kind of replaceable system call table as the I2C adapters.
+
+//////////////////////////////////////////////////////////////////////////////////
+// gpio_linux_request_edges()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  chip         N of /dev/gpiochipN
+//  line         line offset on the chip
+//  falling      watch falling edges (active low INTn), otherwise rising
+//  retval       non-blocking event descriptor, -1 on error
+
+int gpio_linux_request_edges(uint chip, uint line, bool falling);
+
+//////////////////////////////////////////////////////////////////////////////////
+// gpio_linux_read_edges()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  fd           descriptor from gpio_linux_request_edges()
+//  edgeUs       receives the kernel timestamp of the newest edge, on the
+//               time_us_64() clock; left alone if there was none
+//  retval       number of queued edges consumed, 0 if none
+
+uint32_t gpio_linux_read_edges(int fd, uint64_t *edgeUs);
+
+void gpio_linux_release(int fd);
+void gpio_linux_set_ops(const i2c_linux_ops_t *ops);
@@ -0,0 +1,368 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include "i2c_linux.h"
+
+struct i2c_inst
+{
+	bool opened;
+	int fd;
+	uint index;
+	uint baudrate;
+	bool smbus;          // adapter lacks I2C_FUNC_I2C, use I2C_SMBUS
+	int slave;           // address selected with I2C_SLAVE, SMBus only
+	uint8_t pendingAddr;
+	uint8_t pendingLen;  // held back register address write, 0 if none
+	uint8_t pending[I2C_LINUX_PENDING_MAX];
+	i2c_linux_stats_t stats;
+};
+
+static i2c_inst_t buses[I2C_LINUX_BUSES];
+
+// Handed out for bus numbers from I2C_LINUX_BUSES up: never opened, so every
+// transfer on it fails like a NACK
+static i2c_inst_t unavailable = { true, -1, I2C_LINUX_BUSES };
+
+static int sysOpen(const char *path, int flags)
+{
+	return open(path, flags);
+}
+
+static int sysIoctl(int fd, unsigned long request, void *arg)
+{
+	return ioctl(fd, request, arg);
+}
+
+static int sysClose(int fd)
+{
+	return close(fd);
+}
+
+static const i2c_linux_ops_t sysOps = { sysOpen, sysIoctl, sysClose };
+static const i2c_linux_ops_t *ops = &sysOps;
+
+//////////////////////////////////////////////////////////////////////////////
+// openBus()
+//
+// Opens /dev/i2c-N and asks the adapter what it can do. An adapter that cannot
+// open is left with fd -1, and every transfer on it fails like a NACK.
+
+static void openBus(i2c_inst_t *i2c, uint num)
+{
+	char path[32];
+	unsigned long funcs = 0;
+
+	memset(i2c, 0, sizeof(*i2c));
+	i2c->opened = true;
+	i2c->index = num;
+	i2c->baudrate = 100 * 1000;
+	i2c->slave = -1;
+
+	snprintf(path, sizeof(path), "/dev/i2c-%u", num);
+	i2c->fd = ops->open(path, O_RDWR);
+
+	if( i2c->fd < 0 )
+		return;
+
+	if( ops->ioctl(i2c->fd, I2C_FUNCS, &funcs) < 0 )
+		funcs = 0;
+
+	i2c->smbus = !(funcs & I2C_FUNC_I2C);
+}
+
+static int transferError(i2c_inst_t *i2c)
+{
+	i2c->stats.errors++;
+
+	if( errno == ETIMEDOUT )
+		return PICO_ERROR_TIMEOUT;
+
+	return PICO_ERROR_GENERIC;
+}
+
+i2c_inst_t *i2c_get_instance(uint num)
+{
+	i2c_inst_t *i2c;
+
+	if( num >= I2C_LINUX_BUSES )
+		return &unavailable;
+
+	i2c = &buses[num];
+	if( !i2c->opened )
+		openBus(i2c, num);
+
+	return i2c;
+}
+
+void i2c_linux_set_ops(const i2c_linux_ops_t *newOps)
+{
+	ops = newOps ? newOps : &sysOps;
+}
+
+bool i2c_linux_is_smbus(i2c_inst_t *i2c)
+{
+	return i2c->smbus;
+}
+
+void i2c_linux_get_stats(i2c_inst_t *i2c, i2c_linux_stats_t *stats)
+{
+	*stats = i2c->stats;
+}
+
+void i2c_linux_reset_stats(i2c_inst_t *i2c)
+{
+	memset(&i2c->stats, 0, sizeof(i2c->stats));
+}
+
+int i2c_linux_transfer(i2c_inst_t *i2c, struct i2c_msg *msgs, uint count)
+{
+	struct i2c_rdwr_ioctl_data batch;
+
+	if( i2c->fd < 0 || i2c->smbus || count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS )
+		return PICO_ERROR_GENERIC;
+
+	batch.msgs = msgs;
+	batch.nmsgs = count;
+
+	i2c->stats.ioctls++;
+	i2c->stats.messages += count;
+
+	if( ops->ioctl(i2c->fd, I2C_RDWR, &batch) < 0 )
+		return transferError(i2c);
+
+	return (int)count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// transferWithPending()
+//
+// Sends msg, preceded by the held-back register address write if there is
+// one, in a single I2C_RDWR call.
+
+static int transferWithPending(i2c_inst_t *i2c, struct i2c_msg *msg)
+{
+	struct i2c_msg msgs[2];
+	uint count = 0;
+
+	if( i2c->pendingLen )
+	{
+		msgs[count].addr = i2c->pendingAddr;
+		msgs[count].flags = 0;
+		msgs[count].len = i2c->pendingLen;
+		msgs[count].buf = i2c->pending;
+		count++;
+		i2c->pendingLen = 0;
+	}
+
+	msgs[count++] = *msg;
+
+	return i2c_linux_transfer(i2c, msgs, count);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// SMBus fallback
+//
+// i2c-stub and some SMBus-only controllers have no I2C_RDWR. A register read
+// maps onto an SMBus read byte or I2C block read, a register write onto a send
+// byte, write byte or I2C block write, each a single I2C_SMBUS call once the
+// device has been selected with I2C_SLAVE.
+
+static int smbusAccess(i2c_inst_t *i2c, uint8_t addr, char readWrite, uint8_t command,
+	int size, union i2c_smbus_data *data)
+{
+	struct i2c_smbus_ioctl_data args;
+
+	if( i2c->fd < 0 )
+		return PICO_ERROR_GENERIC;
+
+	if( i2c->slave != addr )
+	{
+		i2c->stats.ioctls++;
+		if( ops->ioctl(i2c->fd, I2C_SLAVE, (void *)(uintptr_t)addr) < 0 )
+			return transferError(i2c);
+		i2c->slave = addr;
+	}
+
+	args.read_write = readWrite;
+	args.command = command;
+	args.size = size;
+	args.data = data;
+
+	i2c->stats.ioctls++;
+	i2c->stats.messages++;
+
+	if( ops->ioctl(i2c->fd, I2C_SMBUS, &args) < 0 )
+		return transferError(i2c);
+
+	return PICO_OK;
+}
+
+static int smbusWrite(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len)
+{
+	union i2c_smbus_data data;
+	int ret;
+
+	if( len == 0 || len > I2C_SMBUS_BLOCK_MAX + 1 )
+		return PICO_ERROR_GENERIC;
+
+	if( len == 1 )
+		ret = smbusAccess(i2c, addr, I2C_SMBUS_WRITE, src[0], I2C_SMBUS_BYTE, 0);
+	else if( len == 2 )
+	{
+		data.byte = src[1];
+		ret = smbusAccess(i2c, addr, I2C_SMBUS_WRITE, src[0], I2C_SMBUS_BYTE_DATA, &data);
+	}
+	else
+	{
+		data.block[0] = (uint8_t)(len - 1);
+		memcpy(&data.block[1], &src[1], len - 1);
+		ret = smbusAccess(i2c, addr, I2C_SMBUS_WRITE, src[0], I2C_SMBUS_I2C_BLOCK_DATA, &data);
+	}
+
+	return ret < 0 ? ret : (int)len;
+}
+
+static int smbusRead(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len)
+{
+	union i2c_smbus_data data;
+	bool registerRead;
+	uint8_t reg;
+	int ret;
+
+	registerRead = i2c->pendingLen == 1 && i2c->pendingAddr == addr;
+	reg = i2c->pending[0];
+
+	if( i2c->pendingLen && !registerRead )
+		smbusWrite(i2c, i2c->pendingAddr, i2c->pending, i2c->pendingLen);
+	i2c->pendingLen = 0;
+
+	if( len == 1 )
+	{
+		if( registerRead )
+			ret = smbusAccess(i2c, addr, I2C_SMBUS_READ, reg, I2C_SMBUS_BYTE_DATA, &data);
+		else
+			ret = smbusAccess(i2c, addr, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data);
+		dst[0] = data.byte;
+	}
+	else if( registerRead && len <= I2C_SMBUS_BLOCK_MAX )
+	{
+		data.block[0] = (uint8_t)len;
+		ret = smbusAccess(i2c, addr, I2C_SMBUS_READ, reg, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+		memcpy(dst, &data.block[1], len);
+	}
+	else
+		ret = PICO_ERROR_GENERIC;
+
+	return ret < 0 ? ret : (int)len;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+	return i2c_set_baudrate(i2c, baudrate);
+}
+
+void i2c_deinit(i2c_inst_t *i2c)
+{
+	if( i2c->fd >= 0 )
+		ops->close(i2c->fd);
+
+	i2c->opened = false;
+	i2c->fd = -1;
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate)
+{
+	if( baudrate == 0 )
+		baudrate = 100 * 1000;
+
+	i2c->baudrate = baudrate;
+
+	return baudrate;
+}
+
+uint i2c_hw_index(i2c_inst_t *i2c)
+{
+	return i2c->index;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us)
+{
+	struct i2c_msg msg;
+	int ret;
+
+	(void)timeout_us;
+
+	// Two held-back writes in a row: the first goes out on its own
+	if( nostop && i2c->pendingLen )
+	{
+		msg.addr = i2c->pendingAddr;
+		msg.flags = 0;
+		msg.len = i2c->pendingLen;
+		msg.buf = i2c->pending;
+		i2c->pendingLen = 0;
+		if( i2c->smbus )
+			smbusWrite(i2c, msg.addr, msg.buf, msg.len);
+		else
+			i2c_linux_transfer(i2c, &msg, 1);
+	}
+
+	if( nostop && len > 0 && len <= I2C_LINUX_PENDING_MAX )
+	{
+		memcpy(i2c->pending, src, len);
+		i2c->pendingAddr = addr;
+		i2c->pendingLen = (uint8_t)len;
+		return (int)len;
+	}
+
+	if( i2c->smbus )
+	{
+		if( i2c->pendingLen )
+			smbusWrite(i2c, i2c->pendingAddr, i2c->pending, i2c->pendingLen);
+		i2c->pendingLen = 0;
+		return smbusWrite(i2c, addr, src, len);
+	}
+
+	msg.addr = addr;
+	msg.flags = 0;
+	msg.len = (uint16_t)len;
+	msg.buf = (uint8_t *)src;
+
+	ret = transferWithPending(i2c, &msg);
+
+	return ret < 0 ? ret : (int)len;
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us)
+{
+	struct i2c_msg msg;
+	int ret;
+
+	(void)nostop;
+	(void)timeout_us;
+
+	if( i2c->smbus )
+		return smbusRead(i2c, addr, dst, len);
+
+	msg.addr = addr;
+	msg.flags = I2C_M_RD;
+	msg.len = (uint16_t)len;
+	msg.buf = dst;
+
+	ret = transferWithPending(i2c, &msg);
+
+	return ret < 0 ? ret : (int)len;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+	return i2c_write_timeout_us(i2c, addr, src, len, nostop, 0);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+	return i2c_read_timeout_us(i2c, addr, dst, len, nostop, 0);
+}
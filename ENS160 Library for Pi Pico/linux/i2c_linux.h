@@ -0,0 +1,60 @@
+#pragma once
+#include <linux/i2c.h>
+#include "hardware/i2c.h"
+
+#define I2C_LINUX_BUSES 16
+
+// Longest register address write held back for the following read
+#define I2C_LINUX_PENDING_MAX 32
+
+// Traffic on one adapter. Every ioctl is one kernel transfer; messages counts
+// the i2c_msg segments (or SMBus transactions) it carried.
+typedef struct
+{
+	uint64_t ioctls;
+	uint64_t messages;
+	uint64_t errors;
+}	i2c_linux_stats_t;
+
+// System calls used to reach the adapters, replaceable for testing
+typedef struct
+{
+	int (*open)(const char *path, int flags);
+	int (*ioctl)(int fd, unsigned long request, void *arg);
+	int (*close)(int fd);
+}	i2c_linux_ops_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// Linux i2c-dev backend
+//
+// Implements the hardware/i2c.h stand-in on /dev/i2c-N, so the driver runs
+// unchanged on a Raspberry Pi or any other Linux board. i2c_get_instance(N)
+// opens /dev/i2c-N on first use; N of I2C_LINUX_BUSES or more gets a bus on
+// which every transfer fails like a NACK.
+//
+// A write with nostop set (the register address of a register read) is held
+// back and sent with the read that follows as one I2C_RDWR ioctl, the two
+// messages joined by a repeated start. A register read therefore costs a
+// single system call, and a failed address write is reported by the read.
+// Adapters without plain I2C support, such as the i2c-stub module, are driven
+// through the I2C_SMBUS ioctl instead: one call per register access, plus an
+// I2C_SLAVE call whenever the device addressed changes.
+//
+// The bus clock and transfer timeout belong to the kernel adapter: the baud
+// rate passed in is only recorded, and the timeout arguments are ignored.
+
+//////////////////////////////////////////////////////////////////////////////////
+// i2c_linux_transfer()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  bus          adapter to use
+//  msgs         messages, sent with repeated starts and one stop at the end
+//  count        number of messages, at most I2C_RDWR_IOCTL_MAX_MSGS
+//  retval       count on success, PICO_ERROR_* on error
+
+int i2c_linux_transfer(i2c_inst_t *bus, struct i2c_msg *msgs, uint count);
+
+bool i2c_linux_is_smbus(i2c_inst_t *bus);
+void i2c_linux_get_stats(i2c_inst_t *bus, i2c_linux_stats_t *stats);
+void i2c_linux_reset_stats(i2c_inst_t *bus);
+void i2c_linux_set_ops(const i2c_linux_ops_t *ops);
@@ -0,0 +1,372 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+#include <linux/i2c-dev.h>
+#include "i2c_linux_fake.h"
+#include "pico/time.h"
+
+#define FAKE_FD_BASE      1000
+#define FAKE_CHIP_FD_BASE 2000
+#define FAKE_ADDRESSES    128
+
+// How often the interrupt thread samples the INTn pins
+#define FAKE_INTERRUPT_TICK_US 500
+
+typedef struct
+{
+	ENS160Sim *devices[FAKE_ADDRESSES];
+	int slave;
+	pthread_mutex_t lock;
+}	fake_bus_t;
+
+typedef struct
+{
+	uint chip;
+	uint line;
+	ENS160Sim *device;
+	fake_bus_t *bus;
+	int eventFd;     // write end of the requested line, -1 until requested
+	bool asserted;
+	uint32_t seqno;
+}	fake_line_t;
+
+static fake_bus_t fakeBuses[I2C_LINUX_FAKE_BUSES];
+static bool fakeSmbusOnly;
+static fake_line_t fakeLines[I2C_LINUX_FAKE_LINES];
+static uint fakeLineCount;
+static pthread_mutex_t fakeLinesLock = PTHREAD_MUTEX_INITIALIZER;
+static bool interruptThreadStarted;
+
+static fake_bus_t *fakeBus(int fd)
+{
+	if( fd < FAKE_FD_BASE || fd >= FAKE_FD_BASE + I2C_LINUX_FAKE_BUSES )
+		return 0;
+
+	return &fakeBuses[fd - FAKE_FD_BASE];
+}
+
+static ENS160Sim *fakeDevice(fake_bus_t *bus, int addr)
+{
+	if( addr < 0 || addr >= FAKE_ADDRESSES || bus->devices[addr] == 0 )
+	{
+		errno = ENXIO;
+		return 0;
+	}
+
+	return bus->devices[addr];
+}
+
+static int fakeOpen(const char *path, int flags)
+{
+	unsigned num;
+
+	(void)flags;
+
+	if( sscanf(path, "/dev/i2c-%u", &num) != 1 || num >= I2C_LINUX_FAKE_BUSES )
+	{
+		errno = ENOENT;
+		return -1;
+	}
+
+	return FAKE_FD_BASE + num;
+}
+
+static int fakeClose(int fd)
+{
+	(void)fd;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// fakeRdwr()
+//
+// Messages are delivered in order; the first one to an absent address fails
+// the call with ENXIO, as a NACK does on a real adapter.
+
+static int fakeRdwr(fake_bus_t *bus, struct i2c_rdwr_ioctl_data *batch)
+{
+	ENS160Sim *device;
+	struct i2c_msg *msg;
+	uint32_t i;
+
+	if( fakeSmbusOnly )
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	for( i = 0; i < batch->nmsgs; i++ )
+	{
+		msg = &batch->msgs[i];
+		device = fakeDevice(bus, msg->addr);
+		if( device == 0 )
+			return -1;
+
+		if( msg->flags & I2C_M_RD )
+			device->read(msg->buf, msg->len, time_us_64());
+		else
+			device->write(msg->buf, msg->len, time_us_64());
+	}
+
+	return (int)batch->nmsgs;
+}
+
+static int fakeSmbus(fake_bus_t *bus, struct i2c_smbus_ioctl_data *args)
+{
+	ENS160Sim *device = fakeDevice(bus, bus->slave);
+	uint8_t buf[I2C_SMBUS_BLOCK_MAX + 1];
+
+	if( device == 0 )
+		return -1;
+
+	buf[0] = args->command;
+
+	switch( args->size )
+	{
+		case I2C_SMBUS_BYTE:
+			if( args->read_write == I2C_SMBUS_READ )
+				device->read(&args->data->byte, 1, time_us_64());
+			else
+				device->write(buf, 1, time_us_64());
+			return 0;
+
+		case I2C_SMBUS_BYTE_DATA:
+			if( args->read_write == I2C_SMBUS_READ )
+			{
+				device->write(buf, 1, time_us_64());
+				device->read(&args->data->byte, 1, time_us_64());
+			}
+			else
+			{
+				buf[1] = args->data->byte;
+				device->write(buf, 2, time_us_64());
+			}
+			return 0;
+
+		case I2C_SMBUS_I2C_BLOCK_DATA:
+			if( args->data->block[0] > I2C_SMBUS_BLOCK_MAX )
+				break;
+			if( args->read_write == I2C_SMBUS_READ )
+			{
+				device->write(buf, 1, time_us_64());
+				device->read(&args->data->block[1], args->data->block[0], time_us_64());
+			}
+			else
+			{
+				memcpy(&buf[1], &args->data->block[1], args->data->block[0]);
+				device->write(buf, 1 + args->data->block[0], time_us_64());
+			}
+			return 0;
+	}
+
+	errno = EOPNOTSUPP;
+	return -1;
+}
+
+static int fakeBusIoctl(fake_bus_t *bus, unsigned long request, void *arg)
+{
+	switch( request )
+	{
+		case I2C_FUNCS:
+			*(unsigned long *)arg = fakeSmbusOnly ?
+				I2C_FUNC_SMBUS_BYTE | I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_I2C_BLOCK :
+				I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL;
+			return 0;
+
+		case I2C_SLAVE:
+		case I2C_SLAVE_FORCE:
+			bus->slave = (int)(uintptr_t)arg;
+			return 0;
+
+		case I2C_RDWR:
+			return fakeRdwr(bus, (struct i2c_rdwr_ioctl_data *)arg);
+
+		case I2C_SMBUS:
+			return fakeSmbus(bus, (struct i2c_smbus_ioctl_data *)arg);
+	}
+
+	errno = ENOTTY;
+	return -1;
+}
+
+static int fakeIoctl(int fd, unsigned long request, void *arg)
+{
+	fake_bus_t *bus = fakeBus(fd);
+	int ret;
+
+	if( bus == 0 )
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	pthread_mutex_lock(&bus->lock);
+	ret = fakeBusIoctl(bus, request, arg);
+	pthread_mutex_unlock(&bus->lock);
+
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// interruptThread()
+//
+// Samples INTn of every requested line and queues a falling edge event on the
+// line when a model starts asserting it.
+
+static void *interruptThread(void *arg)
+{
+	struct gpio_v2_line_event event;
+	struct timespec now;
+	fake_line_t *line;
+	bool asserted;
+	uint i;
+
+	(void)arg;
+
+	for( ;; )
+	{
+		pthread_mutex_lock(&fakeLinesLock);
+		for( i = 0; i < fakeLineCount; i++ )
+		{
+			line = &fakeLines[i];
+			if( line->eventFd < 0 )
+				continue;
+
+			pthread_mutex_lock(&line->bus->lock);
+			asserted = line->device->interruptAsserted(time_us_64());
+			pthread_mutex_unlock(&line->bus->lock);
+
+			if( asserted && !line->asserted )
+			{
+				memset(&event, 0, sizeof(event));
+				// The kernel stamps edges on CLOCK_MONOTONIC
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				event.timestamp_ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+				event.id = GPIO_V2_LINE_EVENT_FALLING_EDGE;
+				event.offset = line->line;
+				event.seqno = ++line->seqno;
+				event.line_seqno = line->seqno;
+				// With the queue full, the edge is tried again on the next tick
+				if( write(line->eventFd, &event, sizeof(event)) < 0 )
+					continue;
+			}
+			line->asserted = asserted;
+		}
+		pthread_mutex_unlock(&fakeLinesLock);
+
+		sleep_us(FAKE_INTERRUPT_TICK_US);
+	}
+
+	return 0;
+}
+
+static int fakeChipOpen(const char *path, int flags)
+{
+	unsigned chip;
+
+	(void)flags;
+
+	if( sscanf(path, "/dev/gpiochip%u", &chip) != 1 || chip >= GPIO_LINUX_CHIPS )
+	{
+		errno = ENOENT;
+		return -1;
+	}
+
+	return FAKE_CHIP_FD_BASE + chip;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// fakeChipIoctl()
+//
+// A line request hands out the read end of a pipe; the interrupt thread 
+// writes line events into the other end. Lines nothing is connected to can be
+// requested but never see an edge.
+
+static int fakeChipIoctl(int fd, unsigned long request, void *arg)
+{
+	struct gpio_v2_line_request *lineRequest = (struct gpio_v2_line_request *)arg;
+	pthread_t thread;
+	int pipeFds[2];
+	uint i;
+
+	if( request != GPIO_V2_GET_LINE_IOCTL || lineRequest->num_lines != 1 )
+	{
+		errno = ENOTTY;
+		return -1;
+	}
+
+	if( pipe2(pipeFds, O_CLOEXEC | O_NONBLOCK) < 0 )
+		return -1;
+
+	lineRequest->fd = pipeFds[0];
+
+	pthread_mutex_lock(&fakeLinesLock);
+	for( i = 0; i < fakeLineCount; i++ )
+	{
+		if( fakeLines[i].chip == (uint)(fd - FAKE_CHIP_FD_BASE) && fakeLines[i].line == lineRequest->offsets[0] )
+		{
+			fakeLines[i].eventFd = pipeFds[1];
+			fakeLines[i].asserted = false;
+			pipeFds[1] = -1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&fakeLinesLock);
+
+	if( pipeFds[1] >= 0 )
+		close(pipeFds[1]);
+
+	if( !interruptThreadStarted && pthread_create(&thread, 0, interruptThread, 0) == 0 )
+	{
+		pthread_detach(thread);
+		interruptThreadStarted = true;
+	}
+
+	return 0;
+}
+
+static const i2c_linux_ops_t fakeOps = { fakeOpen, fakeIoctl, fakeClose };
+static const i2c_linux_ops_t fakeChipOps = { fakeChipOpen, fakeChipIoctl, fakeClose };
+
+void i2c_linux_fake_install(bool smbusOnly)
+{
+	uint i;
+
+	for( i = 0; i < I2C_LINUX_FAKE_BUSES; i++ )
+		pthread_mutex_init(&fakeBuses[i].lock, 0);
+
+	fakeSmbusOnly = smbusOnly;
+	i2c_linux_set_ops(&fakeOps);
+	gpio_linux_set_ops(&fakeChipOps);
+}
+
+void i2c_linux_fake_attach(uint num, uint8_t address, ENS160Sim *device)
+{
+	fakeBuses[num % I2C_LINUX_FAKE_BUSES].devices[address % FAKE_ADDRESSES] = device;
+	device->powerOn(time_us_64());
+}
+
+void i2c_linux_fake_connect_interrupt(uint num, uint8_t address, uint chip, uint line)
+{
+	fake_bus_t *bus = &fakeBuses[num % I2C_LINUX_FAKE_BUSES];
+	fake_line_t *fakeLine;
+
+	if( fakeLineCount >= I2C_LINUX_FAKE_LINES || bus->devices[address % FAKE_ADDRESSES] == 0 )
+		return;
+
+	pthread_mutex_lock(&fakeLinesLock);
+	fakeLine = &fakeLines[fakeLineCount++];
+	fakeLine->chip = chip;
+	fakeLine->line = line;
+	fakeLine->device = bus->devices[address % FAKE_ADDRESSES];
+	fakeLine->bus = bus;
+	fakeLine->eventFd = -1;
+	fakeLine->asserted = false;
+	fakeLine->seqno = 0;
+	pthread_mutex_unlock(&fakeLinesLock);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "i2c_linux.h"
+#include "gpio_linux.h"
+#include "ens160_sim.h"
+
+#define I2C_LINUX_FAKE_BUSES 4
+
+// GPIO lines that can be connected to INTn pins, over all chips
+#define I2C_LINUX_FAKE_LINES 512
+
+//////////////////////////////////////////////////////////////////////////////////
+// Fake i2c-dev adapters
+//
+// Replaces the system calls of the Linux backend so it can be run on any host
+// without I2C hardware or kernel modules. /dev/i2c-0 to /dev/i2c-3 open, and
+// the I2C_FUNCS, I2C_SLAVE, I2C_RDWR and I2C_SMBUS ioctls are served by the
+// ENS160Sim models attached to them. With smbusOnly the adapters offer the
+// SMBus functions of i2c-stub and no plain I2C, which exercises the fallback.
+//
+// GPIO chips are faked as well: a line connected to a simulated sensor with
+// i2c_linux_fake_connect_interrupt() can be requested through gpio_linux.h,
+// and gets a falling edge event whenever the model asserts INTn. A thread
+// started with the first line request watches the models in real time.
+//
+// Install before the first i2c_get_instance() or GPIO line request. Each bus
+// is locked while it is being accessed, so the buses may be driven from
+// different threads.
+
+void i2c_linux_fake_install(bool smbusOnly);
+void i2c_linux_fake_attach(uint num, uint8_t address, ENS160Sim *device);
+void i2c_linux_fake_connect_interrupt(uint num, uint8_t address, uint chip, uint line);
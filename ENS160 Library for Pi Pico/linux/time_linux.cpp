@@ -0,0 +1,96 @@
+#include <time.h>
+#include "pico/time.h"
+
+// pico/time.h on the host's monotonic clock, counted from the first call so
+// that 32 bit times start near zero as they do after a Pico boots
+
+static uint64_t monotonicUs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t bootUs()
+{
+	static uint64_t boot = monotonicUs();
+
+	return boot;
+}
+
+uint64_t time_us_64(void)
+{
+	uint64_t boot = bootUs();
+
+	return monotonicUs() - boot;
+}
+
+uint32_t time_us_32(void)
+{
+	return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void)
+{
+	return time_us_64();
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t)
+{
+	return (uint32_t)(t / 1000);
+}
+
+uint64_t to_us_since_boot(absolute_time_t t)
+{
+	return t;
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us)
+{
+	return time_us_64() + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+	return time_us_64() + (uint64_t)ms * 1000;
+}
+
+void sleep_us(uint64_t us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (long)(us % 1000000) * 1000;
+	while( nanosleep(&ts, &ts) != 0 )
+		;
+}
+
+void sleep_ms(uint32_t ms)
+{
+	sleep_us((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t t)
+{
+	uint64_t now = time_us_64();
+
+	if( t > now )
+		sleep_us(t - now);
+}
+
+void busy_wait_us_32(uint32_t us)
+{
+	uint64_t end = time_us_64() + us;
+
+	while( time_us_64() < end )
+		;
+}
+
+// No events to wait for, so this always sleeps out the timeout
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+	sleep_until(timeout_timestamp);
+	return true;
+}
@@ -0,0 +1,198 @@
+#include "ens160_bus_arbiter.h"
+
+ENS160BusArbiter::ENS160BusArbiter()
+{
+	this->queue = 0;
+	this->busy = false;
+	this->requests = 0;
+	this->sessions = 0;
+	this->open = 0;
+}
+
+void ENS160BusArbiter::attach(ENS160 *sensor)
+{
+	sensor->setBusTransfer(&ENS160BusArbiter::submit, this);
+}
+
+int32_t ENS160BusArbiter::submit(const ens160_bus_request_t *request, void *context)
+{
+	return ((ENS160BusArbiter *)context)->transfer(request);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// transfer()
+//
+// Queues the request behind those of the same or a higher priority. If no one
+// is serving the queue this thread serves one batch; otherwise it sleeps until
+// its request is done or it is told to serve. A left-over signal from an
+// earlier request only costs one more look at the flags.
+
+int32_t ENS160BusArbiter::transfer(const ens160_bus_request_t *request)
+{
+	Entry entry;
+	Entry **link;
+	bool serving;
+	bool done;
+
+	entry.request = request;
+	entry.result = ENS160_OK;
+	entry.done = false;
+	entry.serve = false;
+	entry.waiter = osThreadGetId();
+	entry.next = 0;
+
+	this->mutex.lock();
+	for( link = &this->queue; *link && (*link)->request->priority <= request->priority; link = &(*link)->next )
+		;
+	entry.next = *link;
+	*link = &entry;
+	entry.ticket = this->requests++;
+	serving = !this->busy;
+	this->busy = true;
+	this->mutex.unlock();
+
+	for( ;; )
+	{
+		if( serving )
+			return serve(&entry);
+
+		this->mutex.lock();
+		done = entry.done;
+		serving = entry.serve;
+		this->mutex.unlock();
+
+		if( done )
+			return entry.result;
+		if( !serving )
+			Thread::signal_wait(ENS160_BUS_SIGNAL);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// serve()
+//
+// Takes up to ENS160_BUS_BATCH_MAX requests off the queue in priority order,
+// keeping the last place for own if it is not reached before, and carries
+// them out as one session. The serving role then goes to the oldest entry
+// left, or lapses if there is none, and the threads of the batch are woken.
+// The waiters are read before done is set, as an entry goes away with its
+// thread's stack as soon as that thread sees done.
+
+int32_t ENS160BusArbiter::serve(Entry *own)
+{
+	Entry *batch[ENS160_BUS_BATCH_MAX];
+	osThreadId waiters[ENS160_BUS_BATCH_MAX];
+	osThreadId next = 0;
+	Entry **link;
+	Entry *entry;
+	Entry *oldest = 0;
+	uint8_t count = 0;
+	uint8_t i;
+	bool mine = false;
+	bool chain;
+
+	this->mutex.lock();
+	for( link = &this->queue; *link && count < ENS160_BUS_BATCH_MAX; )
+	{
+		entry = *link;
+		if( entry == own || count + (mine ? 0 : 1) < ENS160_BUS_BATCH_MAX )
+		{
+			if( entry == own )
+				mine = true;
+			batch[count++] = entry;
+			*link = entry->next;
+		}
+		else
+			link = &entry->next;
+	}
+	this->mutex.unlock();
+
+	this->sessions++;
+	for( i = 0; i < count; i++ )
+	{
+		chain = i + 1 < count && batch[i + 1]->request->run == 0;
+		batch[i]->result = execute(batch[i]->request, chain);
+	}
+
+	this->mutex.lock();
+	for( i = 0; i < count; i++ )
+	{
+		waiters[i] = batch[i]->waiter;
+		batch[i]->done = true;
+	}
+	for( entry = this->queue; entry; entry = entry->next )
+	{
+		if( !oldest || (int32_t)(entry->ticket - oldest->ticket) < 0 )
+			oldest = entry;
+	}
+	if( oldest )
+	{
+		oldest->serve = true;
+		next = oldest->waiter;
+	}
+	else
+		this->busy = false;
+	this->mutex.unlock();
+
+	for( i = 0; i < count; i++ )
+	{
+		if( batch[i] != own )
+			osSignalSet(waiters[i], ENS160_BUS_SIGNAL);
+	}
+	if( next )
+		osSignalSet(next, ENS160_BUS_SIGNAL);
+
+	return own->result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// execute()
+//
+// Carries out one request. With chain set the transfer ends without a stop,
+// so the next one in the session begins with a repeated start. A failed
+// transfer is always stopped, leaving the bus idle for whatever comes next.
+
+int32_t ENS160BusArbiter::execute(const ens160_bus_request_t *request, bool chain)
+{
+	I2C *bus = request->bus;
+	int ret;
+
+	if( request->run )
+	{
+		if( this->open )
+			this->open->stop();
+		this->open = 0;
+
+		return request->run(request->context);
+	}
+
+	if( request->rxLength )
+	{
+		ret = bus->write(request->address, request->tx, request->txLength, true);
+		if( ret == 0 )
+			ret = bus->read(request->address, request->rx, request->rxLength, chain);
+	}
+	else
+		ret = bus->write(request->address, request->tx, request->txLength, chain);
+
+	if( ret != 0 )
+	{
+		bus->stop();
+		this->open = 0;
+		return ENS160_ERR_NACK;
+	}
+
+	this->open = chain ? bus : 0;
+
+	return ENS160_OK;
+}
+
+uint32_t ENS160BusArbiter::getRequestCount()
+{
+	return this->requests;
+}
+
+uint32_t ENS160BusArbiter::getSessionCount()
+{
+	return this->sessions;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "rtos.h"
+#include "ens160_i2c.h"
+
+// Requests carried by one bus session, the serving thread's own among them
+#define ENS160_BUS_BATCH_MAX 8
+
+// Thread signal that wakes a requester once its request has been carried out,
+// or once it is its turn to serve the queue
+#define ENS160_BUS_SIGNAL 0x4000
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160BusArbiter
+//
+// Serialises the traffic of several devices and threads sharing one I2C bus.
+// Requests queue by priority, so status and data reads overtake configuration
+// writes. Whichever thread finds the bus free carries out one batch from the
+// head of the queue, with its own request always among it, wakes the threads
+// whose requests were in it and returns. Serving the next batch falls to the
+// thread that has waited longest, so each caller serves at most once and
+// waits no more than one batch per thread ahead of it, whatever the traffic.
+// The transfers of a batch are chained with repeated starts, whatever device
+// they address, and only the last one ends with a stop.
+//
+// Drivers are connected with attach(). Code for other devices on the bus calls
+// transfer(), with a run request for anything that has to drive the I2C object
+// or the pins itself; chained transfers are stopped before it runs.
+
+class ENS160BusArbiter {
+    public:
+        ENS160BusArbiter();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // attach()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  sensor       driver whose bus accesses, recovery included, go through the arbiter
+
+        void attach(ENS160 *sensor);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // transfer()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  request      work to carry out, read only until the call returns
+        //  retval       ENS160_OK, ENS160_ERR_NACK or the result of run
+
+        int32_t transfer(const ens160_bus_request_t *request);
+        static int32_t submit(const ens160_bus_request_t *request, void *context);
+
+        uint32_t getRequestCount();
+        uint32_t getSessionCount();
+
+    private:
+        // A queued request, on the stack of the thread waiting for it
+        struct Entry
+        {
+            const ens160_bus_request_t *request;
+            uint32_t ticket;  // arrival order, the oldest entry serves next
+            int32_t result;
+            bool done;
+            bool serve;       // the waiter is to serve the next batch
+            osThreadId waiter;
+            Entry *next;
+        };
+
+        Mutex mutex;      // guards everything below
+        Entry *queue;
+        bool busy;        // a thread is serving the queue, or has been told to
+        uint32_t requests;
+        uint32_t sessions;
+        I2C *open;        // bus left without a stop by the last transfer, only touched while serving
+        int32_t serve(Entry *own);
+        int32_t execute(const ens160_bus_request_t *request, bool chain);
+};
@@ -0,0 +1,124 @@
+#include "ens160_compensation.h"
+
+static float absDiff(float a, float b)
+{
+	return a > b ? a - b : b - a;
+}
+
+ENS160CompensationFeeder::ENS160CompensationFeeder(ENS160 *sensor)
+{
+    this->sensor = sensor;
+    this->tempThreshold = ENS160_COMP_TEMP_THRESHOLD;
+    this->rhThreshold = ENS160_COMP_RH_THRESHOLD;
+    this->maxAge = ENS160_COMP_MAX_AGE_MS;
+    this->alpha = ENS160_COMP_FILTER_ALPHA;
+    this->primed = false;
+    this->written = false;
+    this->tempFiltered = 0;
+    this->rhFiltered = 0;
+    this->tempWritten = 0;
+    this->rhWritten = 0;
+    this->writtenAt = 0;
+    this->samples = 0;
+    this->writes = 0;
+    this->writeErrors = 0;
+}
+
+void ENS160CompensationFeeder::setThresholds(float tempDelta, float rhDelta, uint32_t maxAgeMs)
+{
+	this->tempThreshold = tempDelta;
+	this->rhThreshold = rhDelta;
+	this->maxAge = maxAgeMs;
+}
+
+void ENS160CompensationFeeder::setFilter(float alpha)
+{
+	if( alpha <= 0 || alpha > 1 )
+		alpha = 1;
+	this->alpha = alpha;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// update()
+//
+// The first sample primes the filter and is written straight away. A failed 
+// write leaves the old reference in place, so the next sample tries again.
+
+bool ENS160CompensationFeeder::update(float tempCelsius, float humidity, uint32_t now)
+{
+	bool due;
+
+	this->samples++;
+
+	if( !this->primed )
+	{
+		this->tempFiltered = tempCelsius;
+		this->rhFiltered = humidity;
+		this->primed = true;
+	}
+	else
+	{
+		this->tempFiltered += this->alpha * (tempCelsius - this->tempFiltered);
+		this->rhFiltered += this->alpha * (humidity - this->rhFiltered);
+	}
+
+	due = !this->written
+		|| absDiff(this->tempFiltered, this->tempWritten) >= this->tempThreshold
+		|| absDiff(this->rhFiltered, this->rhWritten) >= this->rhThreshold
+		|| (uint32_t)(now - this->writtenAt) >= this->maxAge;
+
+	if( !due )
+		return false;
+
+	if( !this->sensor->setCompensation(this->tempFiltered, this->rhFiltered) )
+	{
+		this->writeErrors++;
+		return false;
+	}
+
+	this->written = true;
+	this->tempWritten = this->tempFiltered;
+	this->rhWritten = this->rhFiltered;
+	this->writtenAt = now;
+	this->writes++;
+
+	return true;
+}
+
+bool ENS160CompensationFeeder::readBack(float *tempCelsius, float *humidity)
+{
+	ens160_fields_t fields;
+
+	if( !this->sensor->readFields(ENS160_FIELD_DATA_T | ENS160_FIELD_DATA_RH, &fields) )
+		return false;
+
+	*tempCelsius = fields.dataT / 64.0f - 273.15f;
+	*humidity = fields.dataRH / 512.0f;
+
+	return true;
+}
+
+float ENS160CompensationFeeder::getFilteredTemp()
+{
+	return this->tempFiltered;
+}
+
+float ENS160CompensationFeeder::getFilteredRH()
+{
+	return this->rhFiltered;
+}
+
+uint32_t ENS160CompensationFeeder::getSampleCount()
+{
+	return this->samples;
+}
+
+uint32_t ENS160CompensationFeeder::getWriteCount()
+{
+	return this->writes;
+}
+
+uint32_t ENS160CompensationFeeder::getWriteErrorCount()
+{
+	return this->writeErrors;
+}
@@ -0,0 +1,163 @@
+#include "ens160_executive.h"
+
+static uint32_t greatestDivisor(uint32_t a, uint32_t b)
+{
+	uint32_t rest;
+
+	while( b )
+	{
+		rest = a % b;
+		a = b;
+		b = rest;
+	}
+
+	return a;
+}
+
+ENS160Executive::ENS160Executive(const ens160_task_t *tasks, uint8_t count, uint32_t minorUs, uint64_t (*clock)())
+{
+	uint32_t major = 1;
+	uint8_t i;
+
+	this->tasks = tasks;
+	this->count = count;
+	this->minor = minorUs;
+	this->clock = clock;
+	this->valid = count <= ENS160_EXECUTIVE_MAX_TASKS && minorUs > 0;
+	this->started = false;
+	this->frame = 0;
+	this->start = 0;
+	this->frames = 0;
+	this->overruns = 0;
+	this->worstFrame = 0;
+
+	for( i = 0; this->valid && i < count; i++ )
+	{
+		if( tasks[i].period == 0 || tasks[i].offset >= tasks[i].period )
+			this->valid = false;
+		else
+			major = major / greatestDivisor(major, tasks[i].period) * tasks[i].period;
+
+		if( major > 0xFFFF )
+			this->valid = false;
+	}
+
+	this->major = this->valid ? (uint16_t)major : 1;
+
+	for( i = 0; i < ENS160_EXECUTIVE_MAX_TASKS; i++ )
+	{
+		this->stats[i].runs = 0;
+		this->stats[i].overruns = 0;
+		this->stats[i].lastUs = 0;
+		this->stats[i].worstUs = 0;
+	}
+}
+
+bool ENS160Executive::isValid()
+{
+	return this->valid;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// service()
+//
+// The next frame's start is set before the tasks run, so that a task may
+// align() the grid from within the frame.
+
+bool ENS160Executive::service(uint64_t now)
+{
+	uint64_t frameStart;
+	uint64_t frameEnd;
+	uint64_t taskStart;
+	uint64_t taskEnd = now;
+	ens160_task_stats_t *task;
+	uint8_t i;
+
+	if( !this->valid )
+		return false;
+
+	if( !this->started )
+	{
+		this->start = now;
+		this->started = true;
+	}
+	else if( now < this->start )
+		return false;
+
+	frameStart = this->start;
+	frameEnd = frameStart + this->minor;
+	this->start = frameEnd;
+
+	for( i = 0; i < this->count; i++ )
+	{
+		if( this->frame % this->tasks[i].period != this->tasks[i].offset )
+			continue;
+
+		task = &this->stats[i];
+		taskStart = this->clock();
+		this->tasks[i].run(this->tasks[i].context);
+		taskEnd = this->clock();
+
+		task->runs++;
+		task->lastUs = (uint32_t)(taskEnd - taskStart);
+		if( task->lastUs > task->worstUs )
+			task->worstUs = task->lastUs;
+		if( taskEnd > frameEnd && taskStart <= frameEnd )
+			task->overruns++;
+	}
+
+	if( taskEnd - frameStart > this->worstFrame )
+		this->worstFrame = (uint32_t)(taskEnd - frameStart);
+	if( taskEnd > frameEnd )
+		this->overruns++;
+
+	this->frames++;
+	this->frame = (uint16_t)((this->frame + 1) % this->major);
+
+	return true;
+}
+
+void ENS160Executive::align(uint64_t frameStart)
+{
+	this->start = frameStart;
+}
+
+uint64_t ENS160Executive::getNextFrame()
+{
+	return this->start;
+}
+
+uint16_t ENS160Executive::getMajorFrame()
+{
+	return this->major;
+}
+
+uint16_t ENS160Executive::getFrame()
+{
+	return this->frame;
+}
+
+uint32_t ENS160Executive::getFrameCount()
+{
+	return this->frames;
+}
+
+uint32_t ENS160Executive::getOverrunCount()
+{
+	return this->overruns;
+}
+
+uint32_t ENS160Executive::getWorstFrameUs()
+{
+	return this->worstFrame;
+}
+
+bool ENS160Executive::getTaskStats(uint8_t task, ens160_task_stats_t *stats)
+{
+	if( task >= this->count )
+		return false;
+
+	*stats = this->stats[task];
+
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+
+// Tasks one executive can run
+#define ENS160_EXECUTIVE_MAX_TASKS 8
+
+typedef void (*ens160_task_fn_t)(void *context);
+
+// One row of a schedule table. A task runs in the minor frames whose number
+// within the major frame leaves offset when divided by period; giving the
+// slower tasks different offsets keeps them out of each other's frames.
+typedef struct
+{
+	const char *name;
+	ens160_task_fn_t run;
+	void *context;
+	uint16_t period;   // minor frames between runs
+	uint16_t offset;   // minor frame of the period the task runs in, below period
+}	ens160_task_t;
+
+typedef struct
+{
+	uint32_t runs;
+	uint32_t overruns; // runs that ended after their minor frame should have
+	uint32_t lastUs;
+	uint32_t worstUs;
+}	ens160_task_stats_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160Executive
+//
+// Cyclic executive for a fixed table of periodic tasks. Time is cut into minor
+// frames of equal length; the major frame, after which the pattern repeats, is
+// the least common multiple of the task periods. In every minor frame the due
+// tasks run one after another in table order, so which tasks share the bus in
+// a given second, and in what order, is known from the table alone.
+//
+// Frames are never skipped. A frame that runs past its end is counted as an
+// overrun, along with the task that was running when the end went by, and
+// the next frame starts late but keeps its place in the grid, so the schedule
+// catches up instead of drifting. align() moves the grid, e.g. to follow a
+// sensor's own clock.
+
+class ENS160Executive {
+    public:
+        //////////////////////////////////////////////////////////////////////////////////
+        // ENS160Executive()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  tasks        schedule table, read for as long as the executive is used
+        //  count        rows in tasks, up to ENS160_EXECUTIVE_MAX_TASKS
+        //  minorUs      length of a minor frame
+        //  clock        current time in us, used to time the tasks
+
+        ENS160Executive(const ens160_task_t *tasks, uint8_t count, uint32_t minorUs, uint64_t (*clock)());
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // isValid()
+        //  False if the table has too many rows, a period of 0 or an offset not
+        //  below its period, or a major frame longer than 65535 minor frames.
+        //  An invalid table never runs.
+
+        bool isValid();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // service()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  now          current time in us
+        //  retval       true if a minor frame was run; the first call runs frame 0
+
+        bool service(uint64_t now);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // align()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  frameStart   time at which the next minor frame is to start instead
+
+        void align(uint64_t frameStart);
+
+        uint64_t getNextFrame();
+        uint16_t getMajorFrame();
+        uint16_t getFrame();
+        uint32_t getFrameCount();
+        uint32_t getOverrunCount();
+        uint32_t getWorstFrameUs();
+        bool getTaskStats(uint8_t task, ens160_task_stats_t *stats);
+
+    private:
+        const ens160_task_t *tasks;
+        uint8_t count;
+        uint32_t minor;
+        uint64_t (*clock)();
+        bool valid;
+        bool started;
+        uint16_t major;   // minor frames per major frame
+        uint16_t frame;   // minor frame within the major frame that runs next
+        uint64_t start;   // time the next minor frame is due
+        uint32_t frames;
+        uint32_t overruns;
+        uint32_t worstFrame;
+        ens160_task_stats_t stats[ENS160_EXECUTIVE_MAX_TASKS];
+};
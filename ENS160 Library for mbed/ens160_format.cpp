@@ -0,0 +1,131 @@
+#include "ens160_format.h"
+
+// Two digits per division by 100 halves the divisions of the usual loop
+static const char digitPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const uint32_t powersOfTen[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+//////////////////////////////////////////////////////////////////////////////
+// writeDigits()
+//
+// Writes value backwards so that its last digit lands just before end, and
+// returns where the first digit went.
+
+static char *writeDigits(char *end, uint32_t value)
+{
+	uint32_t pair;
+
+	while( value >= 100 )
+	{
+		pair = (value % 100) * 2;
+		value /= 100;
+		*--end = digitPairs[pair + 1];
+		*--end = digitPairs[pair];
+	}
+
+	if( value >= 10 )
+	{
+		*--end = digitPairs[value * 2 + 1];
+		*--end = digitPairs[value * 2];
+	}
+	else
+		*--end = (char)('0' + value);
+
+	return end;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// place()
+//
+// Copies the text built at the end of scratch to the caller's buffer behind
+// the padding width asks for.
+
+static uint8_t place(char *buffer, const char *text, const char *end, uint8_t width)
+{
+	uint8_t length = (uint8_t)(end - text);
+	uint8_t i = 0;
+
+	if( width > ENS160_FORMAT_MAX - 1 )
+		width = ENS160_FORMAT_MAX - 1;
+
+	for( ; i + length < width; i++ )
+		buffer[i] = ' ';
+	while( text < end )
+		buffer[i++] = *text++;
+	buffer[i] = 0;
+
+	return i;
+}
+
+uint8_t ens160FormatUnsigned(char *buffer, uint32_t value, uint8_t width)
+{
+	char scratch[ENS160_FORMAT_MAX];
+	char *end = scratch + sizeof(scratch);
+
+	return place(buffer, writeDigits(end, value), end, width);
+}
+
+uint8_t ens160FormatSigned(char *buffer, int32_t value, uint8_t width)
+{
+	char scratch[ENS160_FORMAT_MAX];
+	char *end = scratch + sizeof(scratch);
+	char *text;
+
+	// Negated as unsigned so that INT32_MIN survives
+	text = writeDigits(end, value < 0 ? 0U - (uint32_t)value : (uint32_t)value);
+	if( value < 0 )
+		*--text = '-';
+
+	return place(buffer, text, end, width);
+}
+
+uint8_t ens160FormatFixed(char *buffer, int32_t value, uint8_t decimals, uint8_t width)
+{
+	char scratch[ENS160_FORMAT_MAX];
+	char *end = scratch + sizeof(scratch);
+	char *text = end;
+	uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+	uint32_t fraction;
+	uint8_t i;
+
+	if( decimals > 9 )
+		decimals = 9;
+
+	if( decimals )
+	{
+		fraction = magnitude % powersOfTen[decimals];
+		magnitude /= powersOfTen[decimals];
+		for( i = 0; i < decimals; i++ )
+		{
+			*--text = (char)('0' + fraction % 10);
+			fraction /= 10;
+		}
+		*--text = '.';
+	}
+
+	text = writeDigits(text, magnitude);
+	if( value < 0 )
+		*--text = '-';
+
+	return place(buffer, text, end, width);
+}
+
+int32_t ens160CentiCelsius(uint16_t dataT)
+{
+	return (int32_t)(((uint32_t)dataT * 100 + 32) / 64) - 27315;
+}
+
+int32_t ens160CentiPercent(uint16_t dataRH)
+{
+	return (int32_t)(((uint32_t)dataRH * 100 + 256) / 512);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////
+// Number formatting
+//
+// Integer and fixed-point to text for displays and logs, without printf. Text
+// goes into the caller's buffer, which needs room for ENS160_FORMAT_MAX bytes;
+// nothing is allocated and no locale is consulted. Numbers shorter than width
+// are padded with spaces on the left, so fields stay in place on a display; a
+// width of 0 pads nothing. Every function ends the text with a NUL and returns
+// its length without it, so calls can be chained to build a line.
+
+// Longest number plus the NUL: "-21474836.48" or "4294967295"
+#define ENS160_FORMAT_MAX 16
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160FormatUnsigned() / ens160FormatSigned()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  buffer       receives the text
+//  value        number to write
+//  width        least number of characters, up to ENS160_FORMAT_MAX - 1
+//  retval       characters written, not counting the NUL
+
+uint8_t ens160FormatUnsigned(char *buffer, uint32_t value, uint8_t width);
+uint8_t ens160FormatSigned(char *buffer, int32_t value, uint8_t width);
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160FormatFixed()
+//  Parameter    Description
+//  ---------    -----------------------------
+//  buffer       receives the text
+//  value        number scaled by 10^decimals, e.g. 2215 for 22.15 with 2 decimals
+//  decimals     digits after the point, 0 to 9
+//  width        least number of characters, up to ENS160_FORMAT_MAX - 1
+//  retval       characters written, not counting the NUL
+
+uint8_t ens160FormatFixed(char *buffer, int32_t value, uint8_t decimals, uint8_t width);
+
+//////////////////////////////////////////////////////////////////////////////////
+// ens160CentiCelsius() / ens160CentiPercent()
+//
+// DATA_T (Kelvin * 64) and DATA_RH (%RH * 512) as hundredths, rounded, ready
+// for ens160FormatFixed() with 2 decimals.
+
+int32_t ens160CentiCelsius(uint16_t dataT);
+int32_t ens160CentiPercent(uint16_t dataRH);
@@ -0,0 +1,147 @@
+#include "ens160_latency.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// bucketOf()
+//
+// Position of the highest set bit picks the octave, the next three bits the
+// bucket within it. Written without clz so it builds on any compiler.
+
+static uint16_t bucketOf(uint32_t us)
+{
+	uint8_t msb = 3;
+
+	if( us < 8 )
+		return us;
+
+	if( us >= ENS160_LATENCY_MAX_US )
+		return ENS160_LATENCY_BUCKETS - 1;
+
+	while( (us >> (msb + 1)) != 0 )
+		msb++;
+
+	return 8 + (msb - 3) * ENS160_LATENCY_SUB_BUCKETS + ((us >> (msb - 3)) & 7);
+}
+
+// Largest value that falls into a bucket
+static uint32_t bucketTop(uint16_t bucket)
+{
+	uint8_t msb;
+	uint32_t step;
+
+	if( bucket < 8 )
+		return bucket;
+
+	msb = 3 + (bucket - 8) / ENS160_LATENCY_SUB_BUCKETS;
+	step = 1UL << (msb - 3);
+
+	return (1UL << msb) + ((bucket - 8) % ENS160_LATENCY_SUB_BUCKETS + 1) * step - 1;
+}
+
+ENS160LatencyHistogram::ENS160LatencyHistogram()
+{
+	reset();
+}
+
+void ENS160LatencyHistogram::reset()
+{
+	uint16_t i;
+
+	for( i = 0; i < ENS160_LATENCY_BUCKETS; i++ )
+		this->counts[i] = 0;
+	this->total = 0;
+	this->max = 0;
+}
+
+void ENS160LatencyHistogram::add(uint32_t us)
+{
+	uint16_t bucket = bucketOf(us);
+	uint16_t i;
+
+	if( this->counts[bucket] == 0xFFFF )
+	{
+		this->total = 0;
+		for( i = 0; i < ENS160_LATENCY_BUCKETS; i++ )
+		{
+			this->counts[i] /= 2;
+			this->total += this->counts[i];
+		}
+	}
+
+	this->counts[bucket]++;
+	this->total++;
+
+	if( us > this->max )
+		this->max = us;
+}
+
+uint32_t ENS160LatencyHistogram::percentile(uint8_t pct)
+{
+	uint32_t rank;
+	uint32_t seen = 0;
+	uint32_t top;
+	uint16_t i;
+
+	if( this->total == 0 )
+		return 0;
+
+	if( pct > 100 )
+		pct = 100;
+
+	// Smallest value with at least pct % of the samples at or below it
+	rank = (this->total * pct + 99) / 100;
+	if( rank == 0 )
+		rank = 1;
+
+	for( i = 0; i < ENS160_LATENCY_BUCKETS; i++ )
+	{
+		seen += this->counts[i];
+		if( seen >= rank )
+			break;
+	}
+
+	top = bucketTop(i);
+
+	return top < this->max ? top : this->max;
+}
+
+uint32_t ENS160LatencyHistogram::getCount()
+{
+	return this->total;
+}
+
+uint32_t ENS160LatencyHistogram::getMax()
+{
+	return this->max;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// record()
+//
+// Times that run backwards (an update estimated after the read, say) count as
+// zero rather than wrapping to a huge latency.
+
+void ENS160LatencyMonitor::record(uint64_t updateUs, uint64_t readUs, uint64_t deliveredUs)
+{
+	this->histograms[ENS160_LATENCY_READ].add(readUs > updateUs ? (uint32_t)(readUs - updateUs) : 0);
+	this->histograms[ENS160_LATENCY_DELIVERY].add(deliveredUs > readUs ? (uint32_t)(deliveredUs - readUs) : 0);
+	this->histograms[ENS160_LATENCY_AGE].add(deliveredUs > updateUs ? (uint32_t)(deliveredUs - updateUs) : 0);
+}
+
+void ENS160LatencyMonitor::summarize(uint8_t interval, ens160_latency_summary_t *summary)
+{
+	ENS160LatencyHistogram *histogram = &this->histograms[interval % ENS160_LATENCY_INTERVALS];
+
+	summary->count = histogram->getCount();
+	summary->p50 = histogram->percentile(50);
+	summary->p90 = histogram->percentile(90);
+	summary->p99 = histogram->percentile(99);
+	summary->max = histogram->getMax();
+}
+
+void ENS160LatencyMonitor::reset()
+{
+	uint8_t i;
+
+	for( i = 0; i < ENS160_LATENCY_INTERVALS; i++ )
+		this->histograms[i].reset();
+}
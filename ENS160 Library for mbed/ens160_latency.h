@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+
+// Histogram layout: one bucket per microsecond below 8 us, then every power of
+// two split into 8 buckets (worst case 12.5 % wide) up to ENS160_LATENCY_MAX_US
+#define ENS160_LATENCY_SUB_BUCKETS 8
+#define ENS160_LATENCY_MAX_US      (1UL << 26)
+#define ENS160_LATENCY_BUCKETS     (8 + (26 - 3) * ENS160_LATENCY_SUB_BUCKETS)
+
+// Intervals kept by ENS160LatencyMonitor
+#define ENS160_LATENCY_READ     0 // estimated device update -> read complete
+#define ENS160_LATENCY_DELIVERY 1 // read complete -> delivered to the consumer
+#define ENS160_LATENCY_AGE      2 // estimated device update -> delivered
+#define ENS160_LATENCY_INTERVALS 3
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t max;
+}	ens160_latency_summary_t;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160LatencyHistogram
+//
+// Streaming percentiles in fixed memory and constant time per sample. Counts 
+// are 16 bit; when one would overflow every bucket is halved, so the summary
+// leans towards recent samples instead of freezing on old ones.
+
+class ENS160LatencyHistogram {
+    public:
+        ENS160LatencyHistogram();
+        void add(uint32_t us);
+        void reset();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // percentile()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  pct          percentile wanted, 0-100
+        //  retval       upper edge of the bucket holding it in us (at most the maximum seen)
+
+        uint32_t percentile(uint8_t pct);
+        uint32_t getCount();
+        uint32_t getMax();
+
+    private:
+        uint16_t counts[ENS160_LATENCY_BUCKETS];
+        uint32_t total;
+        uint32_t max;
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160LatencyMonitor
+//
+// Follows each sample from the device update that produced it, through the read
+// that fetched it, to the consumer that used it. The update time is an estimate
+// supplied by the acquisition loop; all three times share one microsecond clock.
+
+class ENS160LatencyMonitor {
+    public:
+        void record(uint64_t updateUs, uint64_t readUs, uint64_t deliveredUs);
+        void summarize(uint8_t interval, ens160_latency_summary_t *summary);
+        void reset();
+
+    private:
+        ENS160LatencyHistogram histograms[ENS160_LATENCY_INTERVALS];
+};
@@ -0,0 +1,168 @@
+#include "ens160_planner.h"
+#include "ens160_i2c_regs.h"
+
+typedef struct
+{
+	uint16_t field;
+	uint8_t reg;
+	uint8_t length;
+}	ens160_field_info_t;
+
+// Readable fields in register order
+static const ens160_field_info_t fieldTable[ENS160_FIELD_COUNT] = {
+	{ ENS160_FIELD_PART_ID,  SFE_ENS160_PART_ID,       2 },
+	{ ENS160_FIELD_OP_MODE,  SFE_ENS160_OP_MODE,       1 },
+	{ ENS160_FIELD_CONFIG,   SFE_ENS160_CONFIG,        1 },
+	{ ENS160_FIELD_TEMP_IN,  SFE_ENS160_TEMP_IN,       2 },
+	{ ENS160_FIELD_RH_IN,    SFE_ENS160_RH_IN,         2 },
+	{ ENS160_FIELD_STATUS,   SFE_ENS160_DEVICE_STATUS, 1 },
+	{ ENS160_FIELD_AQI,      SFE_ENS160_DATA_AQI,      1 },
+	{ ENS160_FIELD_TVOC,     SFE_ENS160_DATA_TVOC,     2 },
+	{ ENS160_FIELD_ECO2,     SFE_ENS160_DATA_ECO2,     2 },
+	{ ENS160_FIELD_DATA_T,   SFE_ENS160_DATA_T,        2 },
+	{ ENS160_FIELD_DATA_RH,  SFE_ENS160_DATA_RH,       2 },
+	{ ENS160_FIELD_MISR,     SFE_ENS160_DATA_MISR,     1 },
+	{ ENS160_FIELD_GPR_READ, SFE_ENS160_GPR_READ0,     8 },
+};
+
+// Reading any of DATA_AQI through DATA_ECO2 clears NEWDAT
+#define DATA_FIELDS (ENS160_FIELD_AQI | ENS160_FIELD_TVOC | ENS160_FIELD_ECO2)
+
+//////////////////////////////////////////////////////////////////////////////
+// spannable()
+//
+// Whether a read may cover reg without its field being requested: only
+// defined registers, and DATA_AQI through DATA_ECO2 only when one of them is
+// requested anyway, so that spanning never consumes a sample.
+
+static bool spannable(uint8_t reg, uint16_t fields)
+{
+	if( reg >= SFE_ENS160_DATA_AQI && reg < SFE_ENS160_DATA_ECO2 + 2 )
+		return (fields & DATA_FIELDS) != 0;
+
+	return reg < SFE_ENS160_PART_ID + 2
+		|| (reg >= SFE_ENS160_OP_MODE && reg < SFE_ENS160_RH_IN + 2)
+		|| reg == SFE_ENS160_DEVICE_STATUS
+		|| (reg >= SFE_ENS160_DATA_T && reg < SFE_ENS160_DATA_RH + 2)
+		|| reg == SFE_ENS160_DATA_MISR
+		|| (reg >= SFE_ENS160_GPR_WRITE0 && reg <= SFE_ENS160_GPR_READ7);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// ens160PlanFields()
+//
+// Each gap between two requested fields is decided on its own: spanning it 
+// costs gap * byteCost, splitting costs one more transaction. Because the 
+// decisions are independent, taking the cheaper option for every gap gives the
+// cheapest plan overall. A gap holding a register spannable() rules out is
+// never spanned, whatever the cost.
+
+void ens160PlanFields(uint16_t fields, const ens160_bus_cost_t *cost, ens160_plan_t *plan)
+{
+	ens160_segment_t *current = 0;
+	uint8_t end = 0;
+	uint8_t reg;
+	uint8_t i;
+	bool span;
+
+	plan->fields = fields;
+	plan->count = 0;
+	plan->cost = 0;
+
+	for( i = 0; i < ENS160_FIELD_COUNT; i++ )
+	{
+		const ens160_field_info_t *info = &fieldTable[i];
+
+		if( (fields & info->field) == 0 )
+			continue;
+
+		span = current != 0 && (uint32_t)(info->reg - end) * cost->byteCost <= cost->transactionCost;
+		for( reg = end; span && reg < info->reg; reg++ )
+			span = spannable(reg, fields);
+
+		if( span )
+		{
+			current->length = info->reg + info->length - current->reg;
+		}
+		else
+		{
+			current = &plan->segments[plan->count++];
+			current->reg = info->reg;
+			current->length = info->length;
+		}
+		end = current->reg + current->length;
+	}
+
+	for( i = 0; i < plan->count; i++ )
+		plan->cost += cost->transactionCost + (uint32_t)plan->segments[i].length * cost->byteCost;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// ens160DecodeSegment()
+//
+// Copies every requested field that lies inside the segment out of the burst.
+
+void ens160DecodeSegment(const ens160_plan_t *plan, uint8_t segment, const uint8_t *data, ens160_fields_t *result)
+{
+	const ens160_segment_t *seg = &plan->segments[segment];
+	uint8_t i;
+	uint8_t j;
+
+	for( i = 0; i < ENS160_FIELD_COUNT; i++ )
+	{
+		const ens160_field_info_t *info = &fieldTable[i];
+		const uint8_t *field;
+
+		if( (plan->fields & info->field) == 0 )
+			continue;
+		if( info->reg < seg->reg || info->reg + info->length > seg->reg + seg->length )
+			continue;
+
+		field = &data[info->reg - seg->reg];
+		result->fields |= info->field;
+
+		switch( info->field )
+		{
+			case ENS160_FIELD_PART_ID:
+				result->partId = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_OP_MODE:
+				result->opMode = field[0];
+				break;
+			case ENS160_FIELD_CONFIG:
+				result->config = field[0];
+				break;
+			case ENS160_FIELD_TEMP_IN:
+				result->tempIn = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_RH_IN:
+				result->rhIn = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_STATUS:
+				result->status = field[0];
+				break;
+			case ENS160_FIELD_AQI:
+				result->aqi = field[0] & 0x07;
+				break;
+			case ENS160_FIELD_TVOC:
+				result->tvoc = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_ECO2:
+				result->eco2 = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_DATA_T:
+				result->dataT = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_DATA_RH:
+				result->dataRH = ens160DecodeLE16(field);
+				break;
+			case ENS160_FIELD_MISR:
+				result->misr = field[0];
+				break;
+			case ENS160_FIELD_GPR_READ:
+				for( j = 0; j < 8; j++ )
+					result->gpr[j] = field[j];
+				break;
+		}
+	}
+}
@@ -0,0 +1,208 @@
+#include "ens160_poll.h"
+
+ENS160PollScheduler::ENS160PollScheduler()
+{
+	this->period = ENS160_POLL_PERIOD_US;
+	this->guard = ENS160_POLL_GUARD_US;
+	this->nudge = ENS160_POLL_NUDGE_US;
+	this->retry = ENS160_POLL_RETRY_US;
+	reset();
+}
+
+void ENS160PollScheduler::setTiming(uint32_t periodUs, uint32_t guardUs, uint32_t nudgeUs, uint32_t retryUs)
+{
+	this->period = periodUs;
+	this->guard = guardUs;
+	this->nudge = nudgeUs < periodUs / 4 ? nudgeUs : periodUs / 4;
+	this->retry = retryUs ? retryUs : 1;
+	reset();
+}
+
+void ENS160PollScheduler::reset()
+{
+	this->locked = false;
+	this->refined = 0;
+	this->measured = false;
+	this->missed = false;
+	this->streak = 0;
+	this->anchor = 0;
+	this->window = 0;
+	this->lastPoll = 0;
+	this->missedSince = 0;
+	this->update = 0;
+	this->polls = 0;
+	this->updates = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// anchorAt()
+//
+// The number of periods between two edges is rounded, so edges any number
+// of periods apart work as long as the estimate is within half a period over
+// the span. The period is only refined when the two edges together pin it
+// down to 1 %, and a measurement more than 10 % off the estimate is dropped as
+// a misread edge; anything that passes is good enough to move half way at once.
+
+void ENS160PollScheduler::anchorAt(uint64_t edge, uint64_t window)
+{
+	uint64_t cycles;
+	uint32_t measured;
+
+	this->measured = false;
+	if( this->locked && edge > this->anchor )
+	{
+		cycles = (edge - this->anchor + this->period / 2) / this->period;
+		if( cycles > 0 && (window + this->window) * 100 <= cycles * this->period )
+		{
+			measured = (uint32_t)((edge - this->anchor) / cycles);
+			if( measured > this->period - this->period / 10 && measured < this->period + this->period / 10 )
+			{
+				this->period = (uint32_t)((int64_t)this->period + ((int64_t)measured - this->period) / 2);
+				if( this->refined < 255 )
+					this->refined++;
+				this->measured = true;
+			}
+		}
+	}
+
+	this->locked = true;
+	this->streak = 0;
+	this->anchor = edge;
+	this->window = window;
+	this->update = edge;
+}
+
+uint32_t ENS160PollScheduler::nudgeFor(uint8_t hits)
+{
+	if( hits > 24 || (this->nudge << hits) > this->period / 4 )
+		return this->period / 4;
+	return this->nudge << hits;
+}
+
+void ENS160PollScheduler::observe(bool newData, uint64_t now)
+{
+	this->polls++;
+
+	if( !newData )
+	{
+		if( !this->missed )
+			this->missedSince = now;
+		else if( now - this->missedSince > this->period )
+			this->locked = false;
+
+		this->missed = true;
+		this->lastPoll = now;
+		return;
+	}
+
+	this->updates++;
+
+	if( this->missed )
+	{
+		// The update came after the previous poll: take the midpoint
+		anchorAt(now - (now - this->lastPoll) / 2, now - this->lastPoll);
+	}
+	else if( this->locked && now > this->anchor )
+	{
+		this->update = this->anchor + (now - this->anchor) / this->period * this->period;
+
+		// A hit on the very next update says the poll could have come earlier;
+		// one that still comes after the largest nudge means the phase is lost
+		if( now - this->lastPoll <= this->period + this->period / 2 )
+		{
+			if( nudgeFor(this->streak) >= this->period / 4 )
+				this->locked = false;
+			else
+				this->streak++;
+		}
+	}
+	else
+		this->update = now;
+
+	this->missed = false;
+	this->lastPoll = now;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// getNextPoll()
+//
+// The poll for the k-th update after the anchor comes guard after it, less
+// half the anchor's uncertainty and a nudge that doubles with every hit since
+// the last edge, up to a quarter period. Doubling finds the update again
+// within a few periods even when the sensor runs fast and every poll still
+// sees new data, which a fixed step could not catch up with.
+//
+// Skipped updates leave no edge to measure, so notBefore only takes effect
+// once the period has been measured ENS160_POLL_SKIP_AFTER times, the last
+// time at the current anchor, and is ignored again when the anchor is more
+// than ENS160_POLL_RELOCK_PERIODS old, until an edge has renewed it.
+
+uint64_t ENS160PollScheduler::getNextPoll(uint64_t notBefore)
+{
+	uint64_t from = this->lastPoll;
+	uint64_t k, last, lead, poll, step;
+
+	if( notBefore > from && this->measured && this->refined >= ENS160_POLL_SKIP_AFTER &&
+		from - this->anchor < ENS160_POLL_RELOCK_PERIODS * (uint64_t)this->period )
+		from = notBefore;
+
+	if( !this->locked )
+		return this->lastPoll + ENS160_POLL_SEARCH_US;
+
+	// The further off the update has turned out to be, the coarser the search
+	if( this->missed )
+	{
+		step = (this->lastPoll - this->missedSince) / 4;
+		return this->lastPoll + (step > this->retry ? step : this->retry);
+	}
+
+	last = this->lastPoll > this->anchor ? (this->lastPoll - this->anchor + this->period / 2) / this->period : 0;
+	k = from > this->anchor ? (from - this->anchor) / this->period : 0;
+	if( k == 0 )
+		k = 1;
+
+	for( ;; )
+	{
+		// Skipping updates: NEWDAT will be set whenever the poll comes, so
+		// there is no edge to look for. The poll aims after the update by
+		// guard and by a margin for the period error, which grows with every
+		// update since the anchor.
+		poll = this->anchor + k * this->period + this->guard;
+		if( k > last + 1 )
+			poll += k * (this->period >> ENS160_POLL_MARGIN_SHIFT);
+		else
+		{
+			lead = this->window / 2 + nudgeFor(this->streak);
+			poll = poll > lead ? poll - lead : 0;
+		}
+
+		if( poll > from )
+			return poll;
+		k++;
+	}
+}
+
+uint64_t ENS160PollScheduler::getUpdateTime()
+{
+	return this->update;
+}
+
+uint32_t ENS160PollScheduler::getPeriod()
+{
+	return this->period;
+}
+
+bool ENS160PollScheduler::isLocked()
+{
+	return this->locked;
+}
+
+uint32_t ENS160PollScheduler::getPollCount()
+{
+	return this->polls;
+}
+
+uint32_t ENS160PollScheduler::getUpdateCount()
+{
+	return this->updates;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+
+// Defaults: one result per second in STANDARD mode. Polls aim ENS160_POLL_GUARD_US
+// after the expected update, less a nudge that starts at ENS160_POLL_NUDGE_US
+// and doubles for every update since the phase was last measured, so that a
+// poll soon comes too early and the phase is measured again; the update is
+// then looked for every ENS160_POLL_RETRY_US. Before the phase is known, and
+// after losing it, the sensor is polled every ENS160_POLL_SEARCH_US. When taking
+// fewer samples, which is only done once the period has been measured
+// ENS160_POLL_SKIP_AFTER times, the phase is measured again after
+// ENS160_POLL_RELOCK_PERIODS.
+#define ENS160_POLL_PERIOD_US 1000000UL
+#define ENS160_POLL_GUARD_US  2000UL
+#define ENS160_POLL_NUDGE_US  50UL
+#define ENS160_POLL_RETRY_US  1000UL
+#define ENS160_POLL_SEARCH_US 100000UL
+#define ENS160_POLL_SKIP_AFTER      6
+#define ENS160_POLL_MARGIN_SHIFT    11 // skipping polls come period / 2^11 later per update since the anchor
+#define ENS160_POLL_RELOCK_PERIODS 30
+
+//////////////////////////////////////////////////////////////////////////////////
+// ENS160PollScheduler
+//
+// Polling schedule for a sensor without a wired INT pin. The first read that
+// sees NEWDAT after one that did not places the update between the two; such
+// edges give the phase, and the time between two of them, over however many
+// periods, refines the period, so the schedule follows the sensor's own clock
+// and its drift. Between edges each poll lands just after the predicted update,
+// which takes about one status read per sample. A poll that finds no new data
+// starts a dense window of retries that ends with the next edge, or after a
+// whole period without one, when the phase is taken as lost.
+//
+// A read that sees NEWDAT without a miss before it only says the update came
+// earlier than the poll, and brings the next poll forward. Gated status-only
+// reads leave NEWDAT set, so a sensor still warming up looks like one whose
+// phase is lost, and is searched for until it starts delivering data.
+
+class ENS160PollScheduler {
+    public:
+        ENS160PollScheduler();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // setTiming()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  periodUs     nominal update period, the starting estimate
+        //  guardUs      delay after the predicted update for the first poll
+        //  nudgeUs      advance per update since the last edge
+        //  retryUs      poll interval while looking for an update
+
+        void setTiming(uint32_t periodUs, uint32_t guardUs, uint32_t nudgeUs, uint32_t retryUs);
+        void reset();
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // observe()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  newData      NEWDAT was set at this poll
+        //  now          time the poll completed in us
+
+        void observe(bool newData, uint64_t now);
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // getNextPoll()
+        //  Parameter    Description
+        //  ---------    -----------------------------
+        //  notBefore    earliest update worth waking for, to take fewer samples
+        //  retval       time of the next poll in us; retries are not held back by notBefore
+
+        uint64_t getNextPoll(uint64_t notBefore = 0);
+
+        uint64_t getUpdateTime();
+        uint32_t getPeriod();
+        bool isLocked();
+        uint32_t getPollCount();
+        uint32_t getUpdateCount();
+
+    private:
+        uint32_t period;
+        uint32_t guard;
+        uint32_t nudge;
+        uint32_t retry;
+        bool locked;      // anchor holds a measured update time
+        uint8_t refined;  // times the period has been measured
+        bool measured;    // the edge at the anchor measured the period
+        bool missed;      // the last poll found no new data
+        uint64_t anchor;  // time of the last measured update
+        uint64_t window;  // uncertainty of the anchor, the gap between the polls around it
+        uint64_t lastPoll;
+        uint64_t missedSince;
+        uint64_t update;  // estimated time of the last update seen
+        uint8_t streak;   // polls on consecutive updates that all saw new data
+        uint32_t polls;
+        uint32_t updates;
+        void anchorAt(uint64_t edge, uint64_t window);
+        uint32_t nudgeFor(uint8_t hits);
+};
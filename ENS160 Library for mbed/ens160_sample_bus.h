@@ -0,0 +1,168 @@
+#pragma once
+#include "mbed.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+// SampleBus
+//
+// Fan-out of samples from one producer to several subscribers without copies
+// or heap allocation. The producer writes each sample once, straight into a 
+// preallocated slot; subscribers read it in place through a const pointer and
+// each keeps its own cursor. The producer never waits: a subscriber that falls
+// more than N - 1 samples behind skips ahead and has the skipped samples 
+// counted as overruns, so a slow consumer shows up in its statistics instead 
+// of stalling acquisition.
+//
+// Every slot carries a sequence number, odd while the slot is being written.
+// release() checks it again, so a subscriber that held a slot so long that
+// the producer came round and rewrote it is told the data it used was torn.
+//
+// Subscribe before the producer starts; after that the producer only writes
+// the head and slots, and each subscriber only its own cursor and count, so
+// word-sized loads and stores with barriers are all that is needed.
+//
+//  Parameter    Description
+//  ---------    -----------------------------
+//  T            Sample type, written in place by the producer.
+//  N            Number of slots, at least 2.
+//  S            Maximum number of subscribers.
+
+template <typename T, uint32_t N, uint8_t S>
+class SampleBus {
+    public:
+        SampleBus() : head(0), subscribers(0)
+        {
+            for( uint32_t i = 0; i < N; i++ )
+                slots[i].sequence = 0;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // Producer side: claim() a slot, fill it in, publish() it
+        T *claim()
+        {
+            Slot *slot = &slots[head % N];
+
+            slot->sequence = 2 * head + 1;
+            __DMB();
+            return &slot->value;
+        }
+
+        void publish()
+        {
+            Slot *slot = &slots[head % N];
+
+            __DMB();
+            slot->sequence = 2 * head + 2;
+            __DMB();
+            head = head + 1;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // subscribe()
+        //  retval       subscriber id, or -1 if all S are taken. New subscribers
+        //               only see samples published after they joined.
+
+        int8_t subscribe()
+        {
+            if( subscribers >= S )
+                return -1;
+
+            cursors[subscribers] = head;
+            overruns[subscribers] = 0;
+            return subscribers++;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // peek()
+        //  retval       oldest sample not yet released by this subscriber, NULL if
+        //               it is up to date. Valid until release().
+
+        const T *peek(uint8_t id)
+        {
+            for( ;; )
+            {
+                uint32_t h = head;
+                uint32_t c = cursors[id];
+
+                __DMB();
+                if( c == h )
+                    return NULL;
+
+                // Keep clear of the slot the producer fills next
+                if( h - c > N - 1 )
+                {
+                    overruns[id] += h - c - (N - 1);
+                    c = h - (N - 1);
+                    cursors[id] = c;
+                }
+
+                if( slots[c % N].sequence == 2 * c + 2 )
+                    return &slots[c % N].value;
+
+                // Rewritten between the two checks: skip it and look again
+                overruns[id]++;
+                cursors[id] = c + 1;
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // peekLatest()
+        //  Like peek(), but jumps to the newest sample. For consumers that only
+        //  want the current value; the samples passed over are not overruns.
+
+        const T *peekLatest(uint8_t id)
+        {
+            uint32_t h = head;
+
+            __DMB();
+            if( h - cursors[id] > 1 )
+                cursors[id] = h - 1;
+
+            return peek(id);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////
+        // release()
+        //  Finishes with the sample returned by peek().
+        //  retval       false if the producer rewrote it meanwhile (counted as an overrun)
+
+        bool release(uint8_t id)
+        {
+            uint32_t c = cursors[id];
+            bool intact;
+
+            __DMB();
+            intact = (slots[c % N].sequence == 2 * c + 2);
+            cursors[id] = c + 1;
+            if( !intact )
+                overruns[id]++;
+            return intact;
+        }
+
+        // Samples published but not yet released by this subscriber
+        uint32_t getLag(uint8_t id)
+        {
+            return head - cursors[id];
+        }
+
+        uint32_t getOverruns(uint8_t id)
+        {
+            return overruns[id];
+        }
+
+        uint32_t getPublished()
+        {
+            return head;
+        }
+
+    private:
+        struct Slot
+        {
+            volatile uint32_t sequence;
+            T value;
+        };
+        Slot slots[N];
+        volatile uint32_t head;
+        volatile uint32_t cursors[S];
+        volatile uint32_t overruns[S];
+        uint8_t subscribers;
+};
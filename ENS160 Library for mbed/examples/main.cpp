@@ -1,57 +1,100 @@
-#include "mbed.h"
-#include "ens160_i2c.h"
- 
-ENS160 myENS(p9, p10, ENS160_ADDRESS_HIGH);
-Serial pc(USBTX, USBRX);
- 
-bool printedCompensation = false; 
-int ensStatus;
- 
-int main()
-{
-    if (!myENS.init())
-    {
-        pc.printf("Hello, ENS160! Reading raw data from registers...\n");
-        while(1);
-    }
-    if( myENS.setOperatingMode(SFE_ENS160_RESET) )
-        pc.printf("Ready.\n");
-    wait(0.1);
-    myENS.setOperatingMode(SFE_ENS160_IDLE);
-    wait(0.5);
-    myENS.setOperatingMode(SFE_ENS160_STANDARD);
-    ensStatus = myENS.getFlags();
-    pc.printf("Gas Sensor Status Flag: ");
-    pc.printf("%d\n", ensStatus);
-    while (1)
-    {
-        if( myENS.checkDataStatus() )
-        {
-            if( printedCompensation == false)
-            {
-                pc.printf("---------------------------\n");
-                pc.printf("Compensation Temperature: ");
-                pc.printf("%f\n", myENS.getTempCelsius());
-                pc.printf("---------------------------");
-                pc.printf("Compensation Relative Humidity: ");
-                pc.printf("%f\n", myENS.getRH());
-                pc.printf("---------------------------\n");
-                printedCompensation = true;
-                wait(0.5);
-            }
- 
-            pc.printf("Air Quality Index (1-5) : ");
-            pc.printf("%d\n", myENS.getAQI());
- 
-            pc.printf("Total Volatile Organic Compounds: ");
-            pc.printf("%d", myENS.getTVOC());
-            pc.printf("ppb\n");
- 
-            pc.printf("CO2 concentration: ");
-            pc.printf("%d", myENS.getECO2());
-            pc.printf("ppm\n");
- 
-        }
-        wait(0.1);
-        }
+#include "mbed.h"
+#include "ens160_i2c.h"
+#include "ens160_poll.h"
+#include "ens160_format.h"
+ 
+ENS160 myENS(p9, p10, ENS160_ADDRESS_HIGH);
+Serial pc(USBTX, USBRX);
+Timer pollClock;               // time base for the poll scheduler
+ENS160PollScheduler scheduler; // polls just after each expected update
+ 
+bool printedCompensation = false; 
+int ensStatus;
+ens160_frame_t frame;
+
+// Timer::read_us() wraps after ~71 minutes; extend it to 64 bits
+uint64_t clockUs()
+{
+    static uint32_t last = 0;
+    static uint64_t total = 0;
+    uint32_t now = (uint32_t)pollClock.read_us();
+    total += now - last;
+    last = now;
+    return total;
+}
+ 
+// Per-sample output is formatted with ens160_format.h rather than printf
+void printNumber(const char *label, uint32_t value, const char *unit)
+{
+    char number[ENS160_FORMAT_MAX];
+
+    ens160FormatUnsigned(number, value, 0);
+    pc.puts(label);
+    pc.puts(number);
+    pc.puts(unit);
+}
+ 
+int main()
+{
+    uint64_t next, now;
+
+    if (!myENS.init())
+    {
+        pc.printf("Hello, ENS160! Reading raw data from registers...\n");
+        while(1);
+    }
+    if( myENS.setOperatingMode(SFE_ENS160_RESET) )
+        pc.printf("Ready.\n");
+    wait(0.1);
+    myENS.setOperatingMode(SFE_ENS160_IDLE);
+    wait(0.5);
+    myENS.setOperatingMode(SFE_ENS160_STANDARD);
+    ensStatus = myENS.getFlags();
+    pc.printf("Gas Sensor Status Flag: ");
+    pc.printf("%d\n", ensStatus);
+    myENS.setValidOnly();
+    myENS.setAutoRestore(); // put the configuration back if the sensor resets
+    pollClock.start();
+    while (1)
+    {
+        bool delivered = myENS.readFrame(&frame);
+        scheduler.observe(frame.newData, clockUs());
+        if( !delivered )
+        {
+            // Gated frames leave NEWDAT set, so only report changes of the flag
+            if( frame.newData && frame.validity != ensStatus )
+            {
+                ensStatus = frame.validity;
+                pc.printf("Gas Sensor Status Flag: ");
+                pc.printf("%d", frame.validity);
+                if( myENS.getTimeToValid() != ENS160_TIME_UNKNOWN )
+                    pc.printf(", valid in about %lu s", myENS.getTimeToValid() / 1000);
+                pc.printf("\n");
+            }
+        }
+        else if( frame.newData )
+        {
+            if( printedCompensation == false)
+            {
+                pc.printf("---------------------------\n");
+                pc.printf("Compensation Temperature: ");
+                pc.printf("%f\n", myENS.getTempCelsius());
+                pc.printf("---------------------------");
+                pc.printf("Compensation Relative Humidity: ");
+                pc.printf("%f\n", myENS.getRH());
+                pc.printf("---------------------------\n");
+                printedCompensation = true;
+                wait(0.5);
+            }
+ 
+            printNumber("Air Quality Index (1-5) : ", frame.aqi, "\n");
+            printNumber("Total Volatile Organic Compounds: ", frame.tvoc, "ppb\n");
+            printNumber("CO2 concentration: ", frame.eco2, "ppm\n");
+ 
+        }
+        next = scheduler.getNextPoll();
+        now = clockUs();
+        if( next > now )
+            wait_us((int)(next - now));
+        }
 }
\ No newline at end of file
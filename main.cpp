@@ -1,132 +1,447 @@
-#include "mbed.h" 
-#include "rtos.h"
-#include "uLCD_4DGL.h"
-#include "PinDetect.h"
-#include "ens160_i2c.h"
-
-ENS160 myENS(p9, p10, ENS160_ADDRESS_HIGH);
-uLCD_4DGL uLCD(p28,p27,p30); // serial tx, serial rx, reset pin;
-PinDetect pb(p8);
-Mutex mutex;
-
-uint8_t volatile aqi;
-uint32_t volatile co2,tvoc;
-uint8_t volatile current_screen = 0;
-
-void redrawBG()
-{
-    mutex.lock();
-    uLCD.color(WHITE);
-    uLCD.circle(64,64,64,WHITE);
-    uLCD.filled_circle(64,64,60,BLUE);   
-    mutex.unlock();
-}
-
-void getData(void const *args)
-{
-    while(1)
-    {
-        aqi = myENS.getAQI();
-        co2 = myENS.getECO2();
-        tvoc = myENS.getTVOC();
-        Thread::wait(100);
-    }
-}
-
-void allScreens()
-{
-    uLCD.text_width(1.75); //4X size text
-    uLCD.text_height(1.75);
-    uLCD.locate(6,4);
-    uLCD.printf("AQI:");
-    uLCD.printf("%d",aqi);
-    uLCD.locate(4,7);
-    uLCD.printf("C02:");
-    uLCD.printf("%d", co2);
-    uLCD.printf("ppm");
-    uLCD.locate(4,10);
-    uLCD.printf("TVOC:");
-    uLCD.printf("%d",tvoc);
-    uLCD.printf("ppb");
-}
-
-void AQI()
-{
-    uLCD.text_width(2); //4X size text
-    uLCD.text_height(2);
-    uLCD.locate(3,3);
-    uLCD.printf("AQI\n");
-    uLCD.locate(4,4);
-    uLCD.printf("%d",aqi);
-}
-
-void CO2()
-{
-    uLCD.text_width(2); //4X size text
-    uLCD.text_height(2);
-    uLCD.locate(3,3);
-    uLCD.printf("C02\n");
-    uLCD.locate(1,4);
-    uLCD.printf("%d", co2);
-    uLCD.printf("ppm");
-}
-
-void TVOC()
-{
-    uLCD.text_width(2); //4X size text
-    uLCD.text_height(2);
-    uLCD.locate(3,3);
-    uLCD.printf("TVOC\n");
-    uLCD.locate(2,4);
-    uLCD.printf("%d",tvoc);
-    uLCD.printf("ppb");
-}
-
-void updateScreen()
-{
-    mutex.lock();
-    switch (current_screen)
-    {
-        case 0:
-            allScreens();
-            break;
-        case 1:
-            AQI();
-            break;
-        case 2:
-            TVOC();
-            break;
-        case 3:
-            CO2();
-            break;
-    }
-    mutex.unlock();
-}
-
-void pb_hit_callback()
-{
-    current_screen = current_screen + 1;
-    if (current_screen > 3)
-        current_screen = 0;
-}
-
-int main()
-{
-    pb.mode(PullUp);
-    wait(.001);
-    pb.attach_deasserted(&pb_hit_callback);
-    pb.setSampleFrequency();
-    Thread t1(getData);
-    redrawBG();
-    uint8_t oldScreen = current_screen;
-    while(1)
-    {
-        if (oldScreen != current_screen)
-        {
-            oldScreen = current_screen;
-            redrawBG();
-        }
-        updateScreen();
-        Thread::wait(1000);
-    }
+#include "mbed.h" 
+#include "rtos.h"
+#include "uLCD_4DGL.h"
+#include "PinDetect.h"
+#include "ens160_i2c.h"
+#include "ens160_bus_arbiter.h"
+#include "ens160_executive.h"
+#include "ens160_format.h"
+#include "ens160_latency.h"
+#include "ens160_poll.h"
+#include "ens160_sample_bus.h"
+
+ENS160 myENS(p9, p10, ENS160_ADDRESS_HIGH);
+ENS160BusArbiter busArbiter; // every device on p9/p10 goes through this, see main()
+uLCD_4DGL uLCD(p28,p27,p30); // serial tx, serial rx, reset pin;
+PinDetect pb(p8);
+Mutex mutex;
+LocalFileSystem local("local"); // calibrated I2C clock is kept on the mbed drive
+Serial pc(USBTX, USBRX);        // sample log
+
+// The sensor publishes a result every second in standard mode. The poll
+// scheduler learns its period and phase from the NEWDAT edges it sees and
+// wakes the sampler just after each expected update, see ens160_poll.h.
+ENS160PollScheduler scheduler;
+
+Timer sampleClock; // microsecond time base for sample timestamps
+Mutex clockMutex;  // guards the clock extension, see sampleClockUs()
+
+// Every new frame, valid or not, is published once on the sample bus; the
+// display and the logger each read it in place through their own cursor
+typedef struct
+{
+    ens160_frame_t frame;
+    uint64_t readUs;   // sampleClock time of the read
+    uint64_t updateUs; // estimated sampleClock time the sensor produced it
+} sample_t;
+
+#define SAMPLE_SLOTS       8
+#define SAMPLE_SUBSCRIBERS 4
+SampleBus<sample_t, SAMPLE_SLOTS, SAMPLE_SUBSCRIBERS> samples;
+int8_t displaySub, loggerSub;
+
+// Last valid reading, owned by the display
+uint8_t aqi;
+uint32_t co2,tvoc;
+uint8_t volatile current_screen = 0;
+
+// Sample latencies as seen by the display, which is the consumer here
+ENS160LatencyMonitor latency;
+
+void redrawBG()
+{
+    mutex.lock();
+    uLCD.color(WHITE);
+    uLCD.circle(64,64,64,WHITE);
+    uLCD.filled_circle(64,64,60,BLUE);   
+    mutex.unlock();
+}
+
+// Timer::read_us() wraps after ~71 minutes; extend it to 64 bits. The sample
+// task calls this at least once a second.
+uint64_t sampleClockUs()
+{
+    static uint32_t last = 0;
+    static uint64_t total = 0;
+    clockMutex.lock();
+    uint32_t now = (uint32_t)sampleClock.read_us();
+    total += now - last;
+    last = now;
+    uint64_t result = total;
+    clockMutex.unlock();
+    return result;
+}
+
+// Everything runs from main()'s thread on a static schedule with one minor
+// frame per sensor period, see tasks[] below. The frame grid follows the poll
+// scheduler: each frame opens FRAME_LEAD_US before the predicted update, and
+// the sample task takes the first slot.
+#define FRAME_LEAD_US  2000
+#define SAMPLE_SLOT_US 100000 // longest the sample task looks for new data once locked
+#define SEARCH_SLOT_US 700000 // same while the phase is still searched for
+bool sampleHit; // the last sample task got new data
+
+// Reads at the scheduler's poll times until a frame with new data is in. Once
+// the phase is locked the first read usually finds it; before that the
+// scheduler's search polls go on for most of the frame.
+void sampleTask(void *context)
+{
+    uint64_t slotEnd = sampleClockUs() + (scheduler.isLocked() ? SAMPLE_SLOT_US : SEARCH_SLOT_US);
+    sample_t *sample;
+    uint64_t next;
+    uint64_t now;
+
+    sampleHit = false;
+    while (!sampleHit)
+    {
+        next = scheduler.getNextPoll();
+        now = sampleClockUs();
+        if (next >= slotEnd)
+            break;
+        if (next > now)
+            Thread::wait((uint32_t)((next - now + 999) / 1000));
+
+        // Full frames even during warm-up: the data read clears NEWDAT, which the
+        // phase tracking relies on. The frame is read straight into the next slot;
+        // it only becomes visible to subscribers once published.
+        sample = samples.claim();
+        bool delivered = myENS.readFrame(&sample->frame);
+        now = sampleClockUs();
+
+        // A bus error counts as a poll that came too early
+        scheduler.observe(delivered && sample->frame.newData, now);
+        if (delivered && sample->frame.newData)
+        {
+            sample->readUs = now;
+            sample->updateUs = scheduler.getUpdateTime();
+            samples.publish();
+            sampleHit = true;
+        }
+    }
+}
+
+// Writes the new samples to the USB serial port as CSV: read time in ms,
+// validity, AQI, TVOC, eCO2. Reports when it has fallen behind.
+uint32_t loggerOverruns = 0;
+
+void logTask(void *context)
+{
+    const sample_t *sample;
+    char line[5 * ENS160_FORMAT_MAX];
+    char *end;
+
+    while ((sample = samples.peek(loggerSub)) != NULL)
+    {
+        end = line + ens160FormatUnsigned(line, (uint32_t)(sample->readUs / 1000), 0);
+        *end++ = ',';
+        end += ens160FormatUnsigned(end, sample->frame.validity, 0);
+        *end++ = ',';
+        end += ens160FormatUnsigned(end, sample->frame.aqi, 0);
+        *end++ = ',';
+        end += ens160FormatUnsigned(end, sample->frame.tvoc, 0);
+        *end++ = ',';
+        end += ens160FormatUnsigned(end, sample->frame.eco2, 0);
+        *end++ = '\r';
+        *end++ = '\n';
+        *end = 0;
+        pc.puts(line);
+        samples.release(loggerSub);
+    }
+    if (samples.getOverruns(loggerSub) != loggerOverruns)
+    {
+        loggerOverruns = samples.getOverruns(loggerSub);
+        pc.printf("# logger too slow, %lu samples lost\r\n", (unsigned long)loggerOverruns);
+    }
+}
+
+// Writes value at the cursor, right-aligned in width characters. Numbers are
+// formatted with ens160_format.h, so a refresh does not go through printf.
+void lcdNumber(uint32_t value, uint8_t width)
+{
+    char text[ENS160_FORMAT_MAX];
+
+    ens160FormatUnsigned(text, value, width);
+    uLCD.puts(text);
+}
+
+void allScreens()
+{
+    uLCD.text_width(1.75); //4X size text
+    uLCD.text_height(1.75);
+    uLCD.locate(6,4);
+    uLCD.puts("AQI:");
+    lcdNumber(aqi, 0);
+    uLCD.locate(4,7);
+    uLCD.puts("C02:");
+    lcdNumber(co2, 0);
+    uLCD.puts("ppm");
+    uLCD.locate(4,10);
+    uLCD.puts("TVOC:");
+    lcdNumber(tvoc, 0);
+    uLCD.puts("ppb");
+}
+
+void AQI()
+{
+    uLCD.text_width(2); //4X size text
+    uLCD.text_height(2);
+    uLCD.locate(3,3);
+    uLCD.puts("AQI\n");
+    uLCD.locate(4,4);
+    lcdNumber(aqi, 0);
+}
+
+void CO2()
+{
+    uLCD.text_width(2); //4X size text
+    uLCD.text_height(2);
+    uLCD.locate(3,3);
+    uLCD.puts("C02\n");
+    uLCD.locate(1,4);
+    lcdNumber(co2, 0);
+    uLCD.puts("ppm");
+}
+
+void TVOC()
+{
+    uLCD.text_width(2); //4X size text
+    uLCD.text_height(2);
+    uLCD.locate(3,3);
+    uLCD.puts("TVOC\n");
+    uLCD.locate(2,4);
+    lcdNumber(tvoc, 0);
+    uLCD.puts("ppb");
+}
+
+void LAT()
+{
+    ens160_latency_summary_t read, age;
+    latency.summarize(ENS160_LATENCY_READ, &read);
+    latency.summarize(ENS160_LATENCY_AGE, &age);
+    uLCD.text_width(1);
+    uLCD.text_height(1);
+    uLCD.locate(3,4);
+    uLCD.puts("Latency  ms");
+    uLCD.locate(3,6);
+    uLCD.puts("read 50% ");
+    lcdNumber(read.p50 / 1000, 3);
+    uLCD.locate(3,7);
+    uLCD.puts("read 99% ");
+    lcdNumber(read.p99 / 1000, 3);
+    uLCD.locate(3,9);
+    uLCD.puts("age  50% ");
+    lcdNumber(age.p50 / 1000, 3);
+    uLCD.locate(3,10);
+    uLCD.puts("age  99% ");
+    lcdNumber(age.p99 / 1000, 3);
+}
+
+// Takes the newest sample off the bus. Keeps showing the last valid reading
+// while the sensor warms up, and records the latencies of the valid ones.
+void takeSample()
+{
+    const sample_t *sample = samples.peekLatest(displaySub);
+    if (sample == NULL)
+        return;
+    if (sample->frame.valid)
+    {
+        aqi = sample->frame.aqi;
+        co2 = sample->frame.eco2;
+        tvoc = sample->frame.tvoc;
+        latency.record(sample->updateUs, sample->readUs, sampleClockUs());
+    }
+    samples.release(displaySub);
+}
+
+void updateScreen()
+{
+    mutex.lock();
+    switch (current_screen)
+    {
+        case 0:
+            allScreens();
+            break;
+        case 1:
+            AQI();
+            break;
+        case 2:
+            TVOC();
+            break;
+        case 3:
+            CO2();
+            break;
+        case 4:
+            LAT();
+            break;
+    }
+    mutex.unlock();
+}
+
+uint8_t shownScreen = 0;
+
+void displayTask(void *context)
+{
+    if (shownScreen != current_screen)
+    {
+        shownScreen = current_screen;
+        redrawBG();
+    }
+    takeSample();
+    updateScreen();
+}
+
+// Status and operating mode in one burst. A sensor found out of its mode is
+// put back by the driver's auto-restore on this same read.
+ens160_fields_t health;
+uint32_t healthFailures = 0;
+
+void healthTask(void *context)
+{
+    if (!myENS.readFields(ENS160_FIELD_OP_MODE | ENS160_FIELD_STATUS, &health))
+        healthFailures++;
+}
+
+// There is no temperature or humidity sensor on this board, so this slot only
+// reads back the values the ENS160 compensates with. A board with one would
+// call setCompensation() here instead.
+ens160_fields_t compensation;
+
+void compensationTask(void *context)
+{
+    myENS.readFields(ENS160_FIELD_DATA_T | ENS160_FIELD_DATA_RH, &compensation);
+}
+
+void statsTask(void *context);
+
+// The schedule. Minor frames are one sensor period long and the major frame
+// is 60 of them; the slow tasks never share a frame: health runs in frame 3
+// of every 10, compensation in frame 7 of every 30, the statistics in frame
+// 15 of every 60.
+const ens160_task_t tasks[] =
+{
+    { "sample",       sampleTask,       NULL, 1,  0 },
+    { "log",          logTask,          NULL, 1,  0 },
+    { "display",      displayTask,      NULL, 1,  0 },
+    { "health",       healthTask,       NULL, 10, 3 },
+    { "compensation", compensationTask, NULL, 30, 7 },
+    { "stats",        statsTask,        NULL, 60, 15 },
+};
+
+ENS160Executive executive(tasks, sizeof(tasks) / sizeof(tasks[0]), ENS160_POLL_PERIOD_US, sampleClockUs);
+
+// Writes label and value to the log
+void logStat(const char *label, uint32_t value)
+{
+    char text[ENS160_FORMAT_MAX];
+
+    ens160FormatUnsigned(text, value, 0);
+    pc.puts(label);
+    pc.puts(text);
+}
+
+// One comment line per minute with the bus and schedule health, and the
+// worst time each task has taken
+void statsTask(void *context)
+{
+    ens160_task_stats_t stats;
+    char text[ENS160_FORMAT_MAX];
+    uint8_t i;
+
+    pc.puts("# stats");
+    logStat(" bus_errors ", myENS.getBusErrorCount());
+    logStat(" recoveries ", myENS.getRecoveryCount());
+    logStat(" restores ", myENS.getRestoreCount());
+    logStat(" health_failures ", healthFailures);
+    logStat(" frame_overruns ", executive.getOverrunCount());
+    logStat(" worst_frame_ms ", executive.getWorstFrameUs() / 1000);
+    if (compensation.fields & ENS160_FIELD_DATA_T)
+    {
+        ens160FormatFixed(text, ens160CentiCelsius(compensation.dataT), 2, 0);
+        pc.puts(" temp_c ");
+        pc.puts(text);
+        ens160FormatFixed(text, ens160CentiPercent(compensation.dataRH), 2, 0);
+        pc.puts(" rh ");
+        pc.puts(text);
+    }
+    for (i = 0; executive.getTaskStats(i, &stats); i++)
+    {
+        pc.puts(" ");
+        pc.puts(tasks[i].name);
+        logStat("_worst_ms ", stats.worstUs / 1000);
+        if (stats.overruns)
+            logStat(" overruns ", stats.overruns);
+    }
+    pc.puts("\r\n");
+}
+
+uint32_t loadBusSpeed()
+{
+    unsigned long frequency = 0;
+    FILE *fp = fopen("/local/I2CCLK.TXT", "r");
+    if (fp == NULL)
+        return 0;
+    if (fscanf(fp, "%lu", &frequency) != 1)
+        frequency = 0;
+    fclose(fp);
+    return frequency;
+}
+
+void saveBusSpeed(uint32_t frequency)
+{
+    FILE *fp = fopen("/local/I2CCLK.TXT", "w");
+    if (fp == NULL)
+        return;
+    fprintf(fp, "%lu\n", (unsigned long)frequency);
+    fclose(fp);
+}
+
+void pb_hit_callback()
+{
+    current_screen = current_screen + 1;
+    if (current_screen > 4)
+        current_screen = 0;
+}
+
+int main()
+{
+    pb.mode(PullUp);
+    wait(.001);
+    pb.attach_deasserted(&pb_hit_callback);
+    pb.setSampleFrequency();
+    busArbiter.attach(&myENS);
+    // Reuse the stored bus clock while it still checks out, otherwise find the fastest reliable one
+    uint32_t busSpeed = loadBusSpeed();
+    if (busSpeed == 0 || myENS.setBusSpeed(busSpeed) == 0 || !myENS.verifyBus(ENS160_CALIBRATION_READS))
+    {
+        busSpeed = myENS.calibrateBusSpeed();
+        if (busSpeed != 0)
+            saveBusSpeed(busSpeed);
+    }
+    // The sensor powers up in DEEP_SLEEP and the sampler only follows NEWDAT,
+    // so bring it into STANDARD, as the library example does
+    myENS.setOperatingMode(SFE_ENS160_RESET);
+    wait(0.1);
+    myENS.setOperatingMode(SFE_ENS160_IDLE);
+    wait(0.5);
+    myENS.setOperatingMode(SFE_ENS160_STANDARD);
+    // A sensor that resets or browns out gets its mode and configuration back
+    // in one burst from the sampler's next read
+    myENS.setAutoRestore();
+    displaySub = samples.subscribe();
+    loggerSub = samples.subscribe();
+    pc.puts("ms,validity,aqi,tvoc,eco2\r\n");
+    redrawBG();
+    sampleClock.start();
+    uint64_t next, now;
+    while(1)
+    {
+        // Keep the frames on the sensor's clock while the scheduler knows it
+        if (executive.service(sampleClockUs()) && sampleHit && scheduler.isLocked())
+            executive.align(scheduler.getNextPoll() - FRAME_LEAD_US);
+
+        next = executive.getNextFrame();
+        now = sampleClockUs();
+        if (next > now)
+            Thread::wait((uint32_t)((next - now + 999) / 1000));
+    }
 }
\ No newline at end of file